@@ -1,5 +1,3 @@
-#include <thread>
-#include <chrono>
 #include <iostream>
 #include <optional>
 #include <filesystem>
@@ -64,32 +62,40 @@ std::optional<fs::path> findPointCloud(const fs::path& datasetPath) {
 }
 
 template <class T>
-void loop(T& studio) {
+void loop(T& studio, bool printFrameStats) {
   while (studio.update()) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  if (printFrameStats) {
+    studio.frameLatency.print(std::cout);
+    studio.viewController.getAutosave().print(std::cout);
   }
 }
 
 int main(int argc, char* argv[]) {
   cxxopts::Options options("Studio", "Annotate the world in 3D.");
   options.add_options()("dataset", "That path to folder of the dataset to annotate.",
-                        cxxopts::value<std::vector<std::string>>());
+                        cxxopts::value<std::vector<std::string>>())(
+      "quantize-positions", "Store point cloud positions as 16 bit integers, for very large clouds.")(
+      "frame-stats", "Print the number of rendered frames and the input latency on exit.");
   options.parse_positional({"dataset"});
   cxxopts::ParseResult flags = options.parse(argc, argv);
   validateFlags(flags);
   std::string dataset = flags["dataset"].as<std::vector<std::string>>()[0];
   fs::path scenePath(dataset);
+  model::PointCloudDatasetOptions datasetOptions;
+  datasetOptions.quantizePositions = flags.count("quantize-positions") > 0;
+  bool printFrameStats = flags.count("frame-stats") > 0;
   if (isStudioScene(scenePath)) {
     Studio<StudioViewController> studio(dataset);
-    loop(studio);
+    loop(studio, printFrameStats);
   } else if (isPointCloud(scenePath)) {
-    Studio<PointCloudViewController> pcStudio(dataset);
-    loop(pcStudio);
+    Studio<PointCloudViewController> pcStudio(dataset, datasetOptions);
+    loop(pcStudio, printFrameStats);
   } else if (isPointCloudDirectory(scenePath)) {
     auto pc = findPointCloud(scenePath);
     if (pc.has_value()) {
-      Studio<PointCloudViewController> pcStudio(pc.value());
-      loop(pcStudio);
+      Studio<PointCloudViewController> pcStudio(pc.value(), datasetOptions);
+      loop(pcStudio, printFrameStats);
     } else {
       std::cout << "The path " << scenePath.string() << " does not look like a point cloud (.ply) or a Stray Scene." << std::endl;
       return 1;
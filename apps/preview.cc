@@ -10,7 +10,8 @@
 #include "views/annotation_view.h"
 #include "scene_model.h"
 #include "camera.h"
-#include "utils/dataset.h"
+#include "model/dataset_index.h"
+#include "model/frame_prefetcher.h"
 #include "3rdparty/json.hpp"
 #include "camera.h"
 
@@ -40,11 +41,12 @@ class PreviewApp : public GLFWApp {
 private:
   const fs::path datasetPath;
   SceneModel scene;
-  SceneCamera sceneCamera;
+  std::shared_ptr<const model::DatasetIndex> dataset;
+  // Decodes the frames ahead of playback.
+  model::FramePrefetcher frames;
+  const SceneCamera& sceneCamera;
   ViewContext3D viewContext;
   views::AnnotationView annotationView;
-  std::vector<fs::path> colorImages;
-  std::vector<Matrix4f> cameraPoses;
   std::unique_ptr<views::ImagePane> imageView;
   int currentFrame = 0;
   bool paused = false;
@@ -53,13 +55,14 @@ public:
   PreviewApp(const std::string& folder) : GLFWApp("Stray Preview"),
                                           datasetPath(folder),
                                           scene(std::nullopt),
-                                          sceneCamera(datasetPath / "camera_intrinsics.json"),
+                                          dataset(std::make_shared<model::DatasetIndex>(datasetPath)),
+                                          frames(dataset),
+                                          sceneCamera(dataset->getCamera()),
                                           viewContext(sceneCamera),
                                           annotationView(scene, 1) {
-    colorImages = utils::dataset::getDatasetImagePaths(datasetPath / "color");
     scene.load(datasetPath / "annotations.json");
-    cameraPoses = utils::dataset::getDatasetCameraTrajectory(datasetPath / "scene" / "trajectory.log");
-    imageView = std::make_unique<views::ImagePane>(colorImages[0], 0);
+    imageView = std::make_unique<views::ImagePane>(0, sceneCamera.imageWidth, sceneCamera.imageHeight);
+    if (!dataset->empty()) imageView->setImage(frames.seek(0).get());
 
     bgfx::setViewClear(imageView->viewId, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x303030ff, 1.0f);
     bgfx::setViewClear(annotationView.viewId, BGFX_CLEAR_DEPTH, 1.0f);
@@ -91,9 +94,9 @@ public:
   void advance() {
     if (paused) return;
     currentFrame++;
-    if (currentFrame < int(colorImages.size())) {
-      imageView->setImage(colorImages[currentFrame]);
-      Matrix4f T_C = cameraPoses[currentFrame];
+    if (currentFrame < int(dataset->size())) {
+      imageView->setImage(frames.seek(currentFrame).get());
+      const Matrix4f& T_C = dataset->cameraPose(currentFrame);
       Vector3f p_C = T_C.block<3, 1>(0, 3);
       Quaternionf R_C(T_C.block<3, 3>(0, 0));
       auto R_WC = AngleAxisf(M_PI, Vector3f::UnitX());
@@ -102,8 +105,8 @@ public:
     }
   }
 
-  bool update() const override {
-    if (currentFrame >= int(colorImages.size())) return false;
+  bool update() override {
+    if (currentFrame >= int(dataset->size())) return false;
     bgfx::setViewRect(imageView->viewId, 0, 0, width, height);
     imageView->render();
     bgfx::setViewRect(annotationView.viewId, 0, 0, width, height);
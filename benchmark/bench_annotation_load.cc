@@ -0,0 +1,80 @@
+#include <random>
+#include <fstream>
+#include <filesystem>
+#include "scene_model.h"
+#include "timeline.h"
+#include "utils/annotation_file.h"
+#include "3rdparty/json.hpp"
+#include "benchmark.h"
+
+namespace fs = std::filesystem;
+
+const int SyntheticAnnotationCount = 50000;
+
+fs::path writeSyntheticAnnotations(int count) {
+  // As many keypoints as boxes and rectangles together, spread over a room.
+  SceneModel scene;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+  for (int i = 0; i < count; i++) {
+    Vector3f position(coordinate(rng), coordinate(rng), coordinate(rng));
+    if (i % 2 == 0) {
+      scene.addKeypoint(Keypoint(-1, i % 10, position));
+    } else if (i % 4 == 1) {
+      BBox bbox = {.id = -1, .classId = i % 10, .position = position};
+      scene.addBoundingBox(bbox);
+    } else {
+      Rectangle rectangle(-1, i % 10, position, Quaternionf::UnitRandom(), Vector2f::Ones());
+      scene.addRectangle(rectangle);
+    }
+  }
+  fs::path path = fs::temp_directory_path() / "bench_annotation_load.json";
+  scene.save(path);
+  return path;
+}
+
+int main(int argc, char* argv[]) {
+  // Usage: bench_annotation_load [annotations.json]
+  fs::path path = argc > 1 ? fs::path(argv[1]) : writeSyntheticAnnotations(SyntheticAnnotationCount);
+  std::cout << "Annotations: " << path.string() << " (" << fs::file_size(path) / 1000 << " kB)" << std::endl;
+
+  const double megabytes = double(fs::file_size(path)) / 1e6;
+  auto throughput = [&](double ms) {
+    std::cout << "  " << megabytes / (ms / 1000.0) << " MB/s" << std::endl;
+  };
+
+  size_t loaded = 0;
+  benchmark::measure("load into the timeline", 5, [&]() {
+    SceneModel scene;
+    Timeline timeline(scene);
+    timeline.load(path);
+    loaded = scene.getKeypoints().size() + scene.getBoundingBoxes().size() + scene.getRectangles().size();
+  });
+  std::cout << "Loaded " << loaded << " annotations." << std::endl;
+
+  SceneModel scene;
+  scene.load(path);
+  throughput(benchmark::measure("parse", 5, [&]() {
+    utils::annotation_file::Annotations annotations;
+    utils::annotation_file::read(path, annotations);
+  }));
+  fs::path savePath = fs::temp_directory_path() / "bench_annotation_save.json";
+  throughput(benchmark::measure("save", 5, [&]() {
+    utils::annotation_file::write(savePath, scene.getKeypoints(), scene.getBoundingBoxes(), scene.getRectangles(), scene.getNextIds());
+  }));
+
+  // Building a whole document first, for comparison.
+  throughput(benchmark::measure("parse into a JSON document", 5, [&]() {
+    std::ifstream file(path);
+    nlohmann::json json;
+    file >> json;
+  }));
+  nlohmann::json json;
+  std::ifstream file(path);
+  file >> json;
+  throughput(benchmark::measure("save through a JSON document", 5, [&]() {
+    std::ofstream out(savePath);
+    out << json.dump(4);
+  }));
+  return 0;
+}
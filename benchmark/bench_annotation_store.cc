@@ -0,0 +1,53 @@
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "scene_model.h"
+#include "benchmark.h"
+
+const int Lookups = 100000;
+
+int main() {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+  for (int count : {1000, 10000, 100000}) {
+    std::cout << count << " keypoints" << std::endl;
+    SceneModel scene;
+    std::vector<int> ids;
+    benchmark::measure("  add", 1, [&]() {
+      for (int i = 0; i < count; i++) {
+        ids.push_back(scene.addKeypoint(Vector3f(coordinate(rng), coordinate(rng), coordinate(rng))).id);
+      }
+    });
+
+    std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+    std::vector<int> lookups(Lookups);
+    std::generate(lookups.begin(), lookups.end(), [&]() { return ids[pick(rng)]; });
+
+    float sum = 0.0f;
+    benchmark::measure("  " + std::to_string(Lookups) + " lookups", 5, [&]() {
+      for (int id : lookups) {
+        sum += scene.getKeypoint(id)->position[0];
+      }
+    });
+    benchmark::measure("  " + std::to_string(Lookups) + " updates", 5, [&]() {
+      for (int id : lookups) {
+        scene.updateKeypoint(id, Keypoint(id, 1, Vector3f::Zero()));
+      }
+    });
+    benchmark::measure("  iterate 100 times", 5, [&]() {
+      for (int i = 0; i < 100; i++) {
+        for (const Keypoint& keypoint : scene.getKeypoints()) {
+          sum += keypoint.position[2];
+        }
+      }
+    });
+    std::shuffle(ids.begin(), ids.end(), rng);
+    benchmark::measure("  remove all", 1, [&]() {
+      for (int id : ids) {
+        scene.removeKeypoint(Keypoint(id));
+      }
+    });
+    if (sum == 42.0f) std::cout << sum << std::endl;
+  }
+  return 0;
+}
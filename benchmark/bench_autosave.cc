@@ -0,0 +1,60 @@
+#include <random>
+#include <thread>
+#include <filesystem>
+#include "scene_model.h"
+#include "utils/autosave.h"
+#include "utils/journal.h"
+#include "benchmark.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+const int AnnotationCount = 50000;
+const int Frames = 600;
+
+int main() {
+  SceneModel scene;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+  for (int i = 0; i < AnnotationCount; i++) {
+    Vector3f position(coordinate(rng), coordinate(rng), coordinate(rng));
+    if (i % 2 == 0) {
+      scene.addKeypoint(Keypoint(-1, i % 10, position));
+    } else {
+      BBox bbox = {.id = -1, .classId = i % 10, .position = position};
+      scene.addBoundingBox(bbox);
+    }
+  }
+  fs::path path = fs::temp_directory_path() / "bench_autosave.json";
+
+  benchmark::measure("save on the UI thread", 5, [&]() {
+    scene.save(path);
+  });
+  // What saving a single edit costs instead, synced to disk like the file.
+  fs::path journalPath = utils::journal::pathFor(path);
+  fs::remove(journalPath);
+  Keypoint edited = scene.getKeypoints()[0];
+  benchmark::measure("append an edit to the journal", 100, [&]() {
+    utils::journal::append(journalPath, {{AnnotationEdit::SetKeypoint, 0, edited.id, edited}});
+  });
+  fs::remove(journalPath);
+
+  // Dragging a keypoint around for 10 seconds at 60 frames per second, with
+  // a short delay so that saves are written while editing continues.
+  utils::Autosave autosave({.delay = 50ms, .maxDelay = 200ms});
+  autosave.restore(scene, path);
+  Keypoint keypoint = scene.getKeypoints()[0];
+  double worstFrame = 0.0;
+  for (int frame = 0; frame < Frames; frame++) {
+    auto start = std::chrono::steady_clock::now();
+    keypoint.position[0] += 0.001f;
+    scene.setKeypoint(keypoint);
+    autosave.update(scene, path);
+    worstFrame = std::max(worstFrame, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    std::this_thread::sleep_until(start + 16ms);
+  }
+  autosave.flush();
+  std::cout << "Edit and autosave on the UI thread: at most " << worstFrame << " ms per frame." << std::endl;
+  autosave.print(std::cout);
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include <random>
+#include <bgfx/bgfx.h>
+#include "scene_model.h"
+#include "view_context_3d.h"
+#include "views/annotation_view.h"
+#include "benchmark.h"
+
+const int Frames = 100;
+
+int main() {
+  bgfx::Init init;
+  init.type = bgfx::RendererType::Noop;
+  bgfx::init(init);
+  {
+    ViewContext3D context;
+    context.width = 1920;
+    context.height = 1080;
+    context.camera.reset(Vector3f::Zero(), Vector3f(0.0f, 0.0f, 3.0f));
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    for (int keypointCount : {100, 1000, 10000, 100000}) {
+      SceneModel scene;
+      for (int i = 0; i < keypointCount; i++) {
+        scene.addKeypoint(Keypoint(i, i % 10, Vector3f(coordinate(rng), coordinate(rng), coordinate(rng))));
+      }
+      views::AnnotationView view(scene, 0);
+
+      uint32_t drawCalls = 0;
+      std::string name = std::to_string(keypointCount) + " keypoints, " + std::to_string(Frames) + " frames";
+      benchmark::measure(name, 5, [&]() {
+        drawCalls = 0;
+        for (int frame = 0; frame < Frames; frame++) {
+          view.render(context);
+          drawCalls += view.getKeypointView().getLastDrawCalls();
+          bgfx::frame();
+        }
+      });
+      std::cout << "  " << drawCalls / Frames << " keypoint draw calls per frame, " << bgfx::getStats()->numDraw
+                << " draws submitted to bgfx in the last frame." << std::endl;
+    }
+  }
+  bgfx::shutdown();
+  return 0;
+}
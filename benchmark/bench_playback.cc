@@ -0,0 +1,114 @@
+#include <random>
+#include <vector>
+#include <filesystem>
+#include <bgfx/bgfx.h>
+#include <bx/file.h>
+#include <bimg/bimg.h>
+#include "model/dataset_index.h"
+#include "model/frame_prefetcher.h"
+#include "model/thumbnail_cache.h"
+#include "texture_utils.h"
+#include "benchmark.h"
+
+namespace fs = std::filesystem;
+
+const int Frames = 120;
+const uint32_t Width = 1920;
+const uint32_t Height = 1440;
+
+// The fixture dataset with noisy PNG frames, which are about as slow to decode as camera images.
+fs::path makeDataset(const fs::path& fixture) {
+  fs::path path = fs::temp_directory_path() / "bench_playback";
+  fs::remove_all(path);
+  fs::create_directories(path / "color");
+  fs::create_directories(path / "scene");
+  fs::copy_file(fixture / "camera_intrinsics.json", path / "camera_intrinsics.json");
+  fs::copy_file(fixture / "scene" / "trajectory.log", path / "scene" / "trajectory.log");
+  std::mt19937 rng(0);
+  std::vector<uint8_t> pixels(Width * Height * 4);
+  for (int i = 0; i < Frames; i++) {
+    for (uint8_t& value : pixels) value = uint8_t(rng() & 0x3f);
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06d.png", i);
+    bx::FileWriter writer;
+    bx::Error error;
+    if (bx::open(&writer, (path / "color" / name).c_str(), false, &error)) {
+      bimg::imageWritePng(&writer, Width, Height, Width * 4, pixels.data(), bimg::TextureFormat::RGBA8, false, &error);
+      bx::close(&writer);
+    }
+  }
+  return path;
+}
+
+int main(int argc, char* argv[]) {
+  fs::path datasetPath = argc > 1 ? fs::path(argv[1]) : makeDataset("test/fixtures/dataset");
+  auto dataset = std::make_shared<model::DatasetIndex>(datasetPath);
+  size_t frames = std::min(dataset->size(), size_t(Frames));
+  if (frames == 0) {
+    std::cout << "No frames in " << datasetPath.string() << std::endl;
+    return 1;
+  }
+
+  bgfx::Init init;
+  init.type = bgfx::RendererType::Noop;
+  bgfx::init(init);
+  {
+    auto play = [&](auto image) {
+      for (size_t frame = 0; frame < frames; frame++) {
+        bgfx::TextureHandle texture = texture_utils::createTexture(image(frame));
+        bgfx::frame();
+        bgfx::destroy(texture);
+      }
+    };
+    double decoding = benchmark::measure("decode on the UI thread", 1, [&]() {
+      play([&](size_t frame) { return texture_utils::decodeImage(dataset->imagePath(frame).string()); });
+    });
+    std::cout << "  " << double(frames) / decoding * 1000.0 << " frames per second." << std::endl;
+
+    for (int workers : {1, 2, 4}) {
+      model::FramePrefetcher prefetcher(dataset, {.workers = workers});
+      double prefetched = benchmark::measure("prefetched with " + std::to_string(workers) + " workers", 1, [&]() {
+        play([&](size_t frame) { return prefetcher.seek(frame).get(); });
+      });
+      std::cout << "  " << double(frames) / prefetched * 1000.0 << " frames per second." << std::endl;
+    }
+
+    // As above, but uploaded into the same few textures instead of a new one per frame.
+    model::FramePrefetcher prefetcher(dataset, {.workers = 2});
+    texture_utils::StreamingTexture texture;
+    texture.reserve(dataset->getCamera().imageWidth, dataset->getCamera().imageHeight);
+    double streamed = benchmark::measure("prefetched into reused textures", 1, [&]() {
+      for (size_t frame = 0; frame < frames; frame++) {
+        texture.update(prefetcher.seek(frame).get());
+        bgfx::frame();
+      }
+    });
+    std::cout << "  " << double(frames) / streamed * 1000.0 << " frames per second, "
+              << texture.allocationCount() << " textures created." << std::endl;
+
+    fs::path thumbnailPath = fs::temp_directory_path() / "bench_playback_thumbnails.bin";
+    benchmark::measure("generate thumbnails", 1, [&]() {
+      model::ThumbnailCache::generate(*dataset, thumbnailPath);
+    });
+    auto thumbnails = model::ThumbnailCache::open(thumbnailPath, *dataset);
+    if (thumbnails != nullptr) {
+      std::cout << "  " << fs::file_size(thumbnailPath) / frames / 1000 << " kB per frame." << std::endl;
+      // Scrubbing shows thumbnails, and the full image once it stops, so both sizes take turns.
+      double scrubbed = benchmark::measure("thumbnails into reused textures", 1, [&]() {
+        for (size_t frame = 0; frame < frames; frame++) {
+          texture.update(thumbnails->image(frame));
+          bgfx::frame();
+          if (frame % 10 == 9) {
+            texture.update(prefetcher.seek(frame).get());
+            bgfx::frame();
+          }
+        }
+      });
+      std::cout << "  " << double(frames) / scrubbed * 1000.0 << " frames per second, "
+                << texture.allocationCount() << " textures created." << std::endl;
+    }
+    fs::remove(thumbnailPath);
+  }
+  bgfx::shutdown();
+  return 0;
+}
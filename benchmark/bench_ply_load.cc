@@ -0,0 +1,70 @@
+#include <random>
+#include <filesystem>
+#include "3rdparty/happly.h"
+#include "geometry/point_cloud.h"
+#include "geometry/mesh.h"
+#include "benchmark.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+const size_t SyntheticPointCount = 10000000;
+
+fs::path writeSyntheticCloud(size_t pointCount) {
+  fs::path path = fs::temp_directory_path() / "bench_ply_load.ply";
+  test_helpers::PlyWriter writer(path, {.vertices = pointCount, .colors = true});
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+  for (size_t i = 0; i < pointCount; i++) {
+    Eigen::Vector3f p(distribution(rng), distribution(rng), distribution(rng));
+    writer.vertex(p, Eigen::Vector3f(float(i % 256), float((i / 256) % 256), 255.0f) / 255.0f);
+  }
+  return path;
+}
+
+// The loading path used before the memory mapped reader, kept for comparison.
+size_t loadWithHapply(const fs::path& path) {
+  happly::PLYData plyIn(path.string());
+  const auto& vertices = plyIn.getVertexPositions();
+  const auto& vertexColors = plyIn.getVertexColors();
+  geometry::RowMatrixf points(vertices.size(), 3);
+  geometry::RowMatrixu8 colors(vertexColors.size(), 3);
+  for (unsigned int i = 0; i < vertices.size(); i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      points(i, j) = vertices[i][j];
+      colors(i, j) = vertexColors[i][j];
+    }
+  }
+  return points.rows();
+}
+
+int main(int argc, char* argv[]) {
+  // Usage: bench_ply_load [point cloud .ply] [mesh .ply]
+  fs::path cloudPath = argc > 1 ? fs::path(argv[1]) : writeSyntheticCloud(SyntheticPointCount);
+  std::cout << "Point cloud: " << cloudPath.string() << " (" << fs::file_size(cloudPath) / (1024 * 1024) << " MB)" << std::endl;
+
+  size_t points = 0;
+  size_t bytes = 0;
+  size_t quantizedBytes = 0;
+  benchmark::measure("happly point cloud", 3, [&]() {
+    points = loadWithHapply(cloudPath);
+  });
+  benchmark::measure("mapped point cloud", 3, [&]() {
+    geometry::PointCloud cloud(cloudPath.string());
+    points = cloud.points.rows();
+    bytes = cloud.sizeInBytes();
+  });
+  benchmark::measure("mapped point cloud, quantized positions", 3, [&]() {
+    geometry::PointCloud cloud(cloudPath.string(), true);
+    quantizedBytes = cloud.sizeInBytes();
+  });
+  std::cout << "Loaded " << points << " points, " << bytes / (1024 * 1024) << " MB resident, "
+            << quantizedBytes / (1024 * 1024) << " MB with quantized positions." << std::endl;
+
+  if (argc > 2) {
+    benchmark::measure("mesh", 3, [&]() {
+      geometry::Mesh mesh(argv[2]);
+    });
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include <random>
+#include <filesystem>
+#include <bgfx/bgfx.h>
+#include "scene_model.h"
+#include "view_context_3d.h"
+#include "views/point_cloud_view.h"
+#include "geometry/point_cloud_octree.h"
+#include "benchmark.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+const size_t SyntheticPointCount = 10000000;
+const int OrbitFrames = 120;
+
+fs::path writeSyntheticRoom(size_t pointCount) {
+  // Points on the floor and walls of a 20 x 20 x 3 meter room, like a scan would have.
+  fs::path path = fs::temp_directory_path() / "bench_point_cloud_lod.ply";
+  test_helpers::PlyWriter writer(path, {.vertices = pointCount, .colors = true});
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> side(-10.0f, 10.0f);
+  std::uniform_real_distribution<float> height(0.0f, 3.0f);
+  for (size_t i = 0; i < pointCount; i++) {
+    Eigen::Vector3f p;
+    switch (i % 3) {
+    case 0:
+      p = {side(rng), side(rng), 0.0f};
+      break;
+    case 1:
+      p = {i % 2 == 0 ? -10.0f : 10.0f, side(rng), height(rng)};
+      break;
+    default:
+      p = {side(rng), i % 2 == 0 ? -10.0f : 10.0f, height(rng)};
+    }
+    writer.vertex(p, Eigen::Vector3f(float(i % 256), float((i / 256) % 256), 255.0f) / 255.0f);
+  }
+  return path;
+}
+
+void orbit(ViewContext3D& context, const Vector3f& center, float radius, int frame) {
+  float angle = 2.0f * M_PI * float(frame) / float(OrbitFrames);
+  Vector3f position = center + radius * Vector3f(std::cos(angle), std::sin(angle), 0.3f);
+  context.camera.reset(center, position);
+}
+
+int main(int argc, char* argv[]) {
+  // Usage: bench_point_cloud_lod [point cloud .ply]
+  fs::path cloudPath = argc > 1 ? fs::path(argv[1]) : writeSyntheticRoom(SyntheticPointCount);
+  auto cloud = std::make_shared<geometry::PointCloud>(cloudPath.string());
+  std::cout << "Point cloud: " << cloudPath.string() << " (" << cloud->size() << " points)" << std::endl;
+
+  std::shared_ptr<geometry::PointCloudOctree> octree;
+  benchmark::measure("octree build", 3, [&]() {
+    octree = std::make_shared<geometry::PointCloudOctree>(*cloud);
+  });
+  std::cout << octree->getNodes().size() << " nodes, largest has " << octree->maxNodeSize() << " points." << std::endl;
+
+  bgfx::Init init;
+  init.type = bgfx::RendererType::Noop;
+  bgfx::init(init);
+  {
+    SceneModel scene;
+    // An unbuilt ray tracer, so that no BVH is built in the background while measuring.
+    scene.setPointCloud(cloud, std::make_shared<geometry::RayTraceCloud>(cloud), octree);
+    views::PointCloudView view(scene, 0);
+    view.loadPointCloud();
+
+    ViewContext3D context;
+    context.width = 1920;
+    context.height = 1080;
+    const Vector3f center = cloud->getMean().transpose();
+    const float radius = 3.0f * cloud->getStd().norm();
+
+    size_t selectedPoints = 0;
+    benchmark::measure("node selection, orbit", 5, [&]() {
+      selectedPoints = 0;
+      for (int frame = 0; frame < OrbitFrames; frame++) {
+        orbit(context, center, radius, frame);
+        geometry::LODQuery query;
+        query.viewProjection = view.getProjection(context) * context.camera.getViewMatrix().matrix();
+        query.eye = context.camera.getPosition();
+        query.pixelsPerUnit = float(context.height) / (2.0f * std::tan(context.camera.fov * 0.5f * M_PI / 180.0f));
+        for (uint32_t node : octree->select(query)) {
+          selectedPoints += octree->getNodes()[node].count;
+        }
+      }
+    });
+    std::cout << "Selected " << selectedPoints / OrbitFrames << " points per frame on average." << std::endl;
+
+    // Upload everything the orbit needs first, so that the measurement below is submission only.
+    for (int frame = 0; frame < OrbitFrames; frame++) {
+      orbit(context, center, radius, frame);
+      do {
+        view.render(context);
+        bgfx::frame();
+      } while (view.getLastFrameStats().uploadedPoints > 0);
+    }
+
+    size_t drawCalls = 0;
+    benchmark::measure("render with the Noop renderer, orbit", 5, [&]() {
+      drawCalls = 0;
+      for (int frame = 0; frame < OrbitFrames; frame++) {
+        orbit(context, center, radius, frame);
+        view.render(context);
+        bgfx::frame();
+        drawCalls += view.getLastFrameStats().nodes;
+      }
+    });
+    std::cout << drawCalls / OrbitFrames << " draw calls per frame on average." << std::endl;
+  }
+  bgfx::shutdown();
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include <memory>
+#include "scene_model.h"
+#include "timeline.h"
+#include "benchmark.h"
+
+const int BoxCount = 1000;
+const int Drags = 200000;
+
+int main() {
+  SceneModel scene;
+  for (int i = 0; i < BoxCount; i++) {
+    BBox bbox = {.id = -1, .classId = i % 10, .position = Vector3f::Zero()};
+    scene.addBoundingBox(bbox);
+  }
+  const std::vector<BBox> boxes = scene.getBoundingBoxes();
+
+  // A long session of dragging boxes around one after another, so that no
+  // drags are merged and the history fills up.
+  Timeline timeline(scene, {.mergeWindow = std::chrono::milliseconds(0)});
+  benchmark::measure("push drags", 1, [&]() {
+    for (int i = 0; i < Drags; i++) {
+      const BBox& bbox = boxes[i % BoxCount];
+      Vector3f position = bbox.position + Vector3f::Constant(0.001f * float(i));
+      timeline.pushCommand(std::make_unique<MoveBBoxCommand>(bbox, position, bbox.orientation));
+    }
+  });
+  std::cout << "History: " << timeline.size() << " commands taking " << timeline.memoryUsage() / 1024
+            << " KiB, " << commands::CommandPool::instance().reservedBytes() / 1024 << " KiB reserved by the pool."
+            << std::endl;
+
+  benchmark::measure("undo and redo everything", 1, [&]() {
+    while (timeline.size() > 0) timeline.undoCommand();
+    while (timeline.redoSize() > 0) timeline.redoCommand();
+  });
+
+  // Dragging the same box again and again is a single edit.
+  Timeline merging(scene);
+  benchmark::measure("push drags of one box", 1, [&]() {
+    for (int i = 0; i < Drags; i++) {
+      Vector3f position = Vector3f::Constant(0.001f * float(i));
+      merging.pushCommand(std::make_unique<MoveBBoxCommand>(boxes[0], position, boxes[0].orientation));
+    }
+  });
+  std::cout << "History: " << merging.size() << " commands." << std::endl;
+  return 0;
+}
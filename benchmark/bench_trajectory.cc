@@ -0,0 +1,80 @@
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <eigen3/Eigen/Geometry>
+#include "utils/dataset.h"
+#include "benchmark.h"
+
+namespace fs = std::filesystem;
+
+// About an hour of capture at 60 frames per second.
+const int SyntheticPoseCount = 200000;
+
+fs::path writeSyntheticTrajectory(int count) {
+  fs::path path = fs::temp_directory_path() / "bench_trajectory" / "trajectory.log";
+  fs::create_directories(path.parent_path());
+  std::ofstream out(path);
+  out << std::fixed;
+  out.precision(8);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+  for (int i = 0; i < count; i++) {
+    Eigen::Matrix4f pose = Eigen::Matrix4f::Identity();
+    pose.block<3, 3>(0, 0) = Eigen::Quaternionf::UnitRandom().toRotationMatrix();
+    pose.block<3, 1>(0, 3) = Eigen::Vector3f(coordinate(rng), coordinate(rng), coordinate(rng));
+    out << i << " " << i << " " << i + 1 << "\n";
+    for (int row = 0; row < 4; row++) {
+      out << pose(row, 0) << " " << pose(row, 1) << " " << pose(row, 2) << " " << pose(row, 3) << "\n";
+    }
+  }
+  return path;
+}
+
+// How the trajectory used to be read, for comparison.
+std::vector<Eigen::Matrix4f> readWithStreams(const fs::path& path) {
+  std::fstream in(path.string(), std::ios::in);
+  std::string line;
+  Eigen::Vector4f row;
+  std::vector<Eigen::Matrix4f> out;
+  while (std::getline(in, line)) {
+    Eigen::Matrix4f pose;
+    for (int i = 0; i < 4; i++) {
+      std::getline(in, line);
+      std::stringstream lineStream(line);
+      for (int j = 0; j < 4; j++) {
+        lineStream >> row[j];
+      }
+      pose.row(i) = row;
+    }
+    out.push_back(pose);
+  }
+  return out;
+}
+
+int main(int argc, char* argv[]) {
+  // Usage: bench_trajectory [trajectory.log]
+  fs::path path = argc > 1 ? fs::path(argv[1]) : writeSyntheticTrajectory(SyntheticPoseCount);
+  fs::path cachePath = path.parent_path() / ("." + path.filename().string() + ".bin");
+  std::cout << "Trajectory: " << path.string() << " (" << fs::file_size(path) / 1000 << " kB)" << std::endl;
+
+  size_t poses = 0;
+  benchmark::measure("getline and stringstream", 3, [&]() {
+    poses = readWithStreams(path).size();
+  });
+  std::cout << "Read " << poses << " poses." << std::endl;
+  benchmark::measure("from_chars in parallel", 5, [&]() {
+    utils::dataset::getDatasetCameraTrajectory(path, false);
+  });
+
+  std::error_code error;
+  fs::remove(cachePath, error);
+  benchmark::measure("parse and write the sidecar", 1, [&]() {
+    utils::dataset::getDatasetCameraTrajectory(path);
+  });
+  benchmark::measure("read the sidecar", 5, [&]() {
+    utils::dataset::getDatasetCameraTrajectory(path);
+  });
+  if (argc <= 1) fs::remove_all(path.parent_path());
+  return 0;
+}
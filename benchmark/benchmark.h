@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <functional>
+
+namespace benchmark {
+
+/*
+ * Runs fn a number of times and prints the best and mean wall clock time.
+ * Returns the best time in milliseconds.
+ */
+inline double measure(const std::string& name, int repetitions, const std::function<void()>& fn) {
+  double best = 1e30;
+  double total = 0.0;
+  for (int i = 0; i < repetitions; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    best = std::min(best, ms);
+    total += ms;
+  }
+  std::cout << name << ": best " << best << " ms, mean " << total / repetitions << " ms over "
+            << repetitions << " runs" << std::endl;
+  return best;
+}
+
+} // namespace benchmark
@@ -730,6 +730,19 @@ class BVHAccel {
   bool Load(FILE *fp);
 #endif
 
+  ///
+  /// Load a BVH from flattened nodes and primitive indices, as returned by
+  /// `GetNodes()` and `GetIndices()` (e.g. from a memory mapped file).
+  /// Not part of upstream nanort.
+  ///
+  bool Load(const BVHNode<T> *nodes, size_t numNodes,
+            const unsigned int *indices, size_t numIndices) {
+    if (numNodes == 0) return false;
+    nodes_.assign(nodes, nodes + numNodes);
+    indices_.assign(indices, indices + numIndices);
+    return true;
+  }
+
   void Debug();
 
   ///
@@ -12,11 +12,19 @@ namespace particle_tracing {
 
 typedef nanort::real3<float> float3;
 
+// Sphere centers stored as packed xyz floats. The classes below read centers
+// through operator[], so that other storage formats can be plugged in.
+struct FloatPoints {
+  const float *vertices;
+  float3 operator[](unsigned int i) const { return float3(&vertices[3 * i]); }
+};
+
 // Predefined SAH predicator for sphere.
+template <class Points = FloatPoints>
 class SpherePred {
  public:
-  SpherePred(const float *vertices)
-      : axis_(0), pos_(0.0f), vertices_(vertices) {}
+  SpherePred(const Points &points)
+      : axis_(0), pos_(0.0f), vertices_(points) {}
 
   void Set(int axis, float pos) const {
     axis_ = axis;
@@ -27,7 +35,7 @@ class SpherePred {
     int axis = axis_;
     float pos = pos_;
 
-    float3 p0(&vertices_[3 * i]);
+    float3 p0 = vertices_[i];
 
     float center = p0[axis];
 
@@ -37,28 +45,30 @@ class SpherePred {
  private:
   mutable int axis_;
   mutable float pos_;
-  const float *vertices_;
+  const Points vertices_;
 };
 
 // -----------------------------------------------------
 
+template <class Points = FloatPoints>
 class SphereGeometry {
  public:
-  SphereGeometry(const float *vertices, const float radius)
-      : vertices_(vertices), radius_(radius) {}
+  SphereGeometry(const Points &points, const float radius)
+      : vertices_(points), radius_(radius) {}
 
   /// Compute bounding box for `prim_index`th sphere.
   /// This function is called for each primitive in BVH build.
   void BoundingBox(float3 *bmin, float3 *bmax, unsigned int prim_index) const {
-    (*bmin)[0] = vertices_[3 * prim_index + 0] - radius_;
-    (*bmin)[1] = vertices_[3 * prim_index + 1] - radius_;
-    (*bmin)[2] = vertices_[3 * prim_index + 2] - radius_;
-    (*bmax)[0] = vertices_[3 * prim_index + 0] + radius_;
-    (*bmax)[1] = vertices_[3 * prim_index + 1] + radius_;
-    (*bmax)[2] = vertices_[3 * prim_index + 2] + radius_;
+    const float3 center = vertices_[prim_index];
+    (*bmin)[0] = center[0] - radius_;
+    (*bmin)[1] = center[1] - radius_;
+    (*bmin)[2] = center[2] - radius_;
+    (*bmax)[0] = center[0] + radius_;
+    (*bmax)[1] = center[1] + radius_;
+    (*bmax)[2] = center[2] + radius_;
   }
 
-  const float *vertices_;
+  const Points vertices_;
   const float radius_;
   mutable float3 ray_org_;
   mutable float3 ray_dir_;
@@ -77,11 +87,11 @@ class SphereIntersection {
   unsigned int prim_id;
 };
 
-template <class I>
+template <class I, class Points = FloatPoints>
 class SphereIntersector {
  public:
-  SphereIntersector(const float *vertices, const float radius)
-      : vertices_(vertices), radius_(radius) {}
+  SphereIntersector(const Points &points, const float radius)
+      : vertices_(points), radius_(radius) {}
 
   /// Do ray interesection stuff for `prim_index` th primitive and return hit
   /// distance `t`,
@@ -95,7 +105,7 @@ class SphereIntersector {
 
     // http://wiki.cgsociety.org/index.php/Ray_Sphere_Intersection
 
-    const float3 center(&vertices_[3 * prim_index]);
+    const float3 center = vertices_[prim_index];
     const float radius = radius_;
 
     float3 oc = ray_org_ - center;
@@ -187,7 +197,7 @@ class SphereIntersector {
                      SphereIntersection *isect) const {
     if (hit) {
       float3 hitP = ray_org_ + t_ * ray_dir_;
-      float3 center = float3(&vertices_[3 * prim_id_]);
+      float3 center = vertices_[prim_id_];
       float3 n = vnormalize(hitP - center);
 
       isect->t = t_;
@@ -197,7 +207,7 @@ class SphereIntersector {
     }
   }
 
-  const float *vertices_;
+  const Points vertices_;
   const float radius_;
   mutable float3 ray_org_;
   mutable float3 ray_dir_;
@@ -31,9 +31,9 @@ class MoveBBoxCommand : public Command {
 private:
   BBox bbox;
   const Vector3f oldPosition;
-  const Vector3f newPosition;
+  Vector3f newPosition;
   const Quaternionf oldOrientation;
-  const Quaternionf newOrientation;
+  Quaternionf newOrientation;
 
 public:
   MoveBBoxCommand(const BBox& box, const Vector3f& position, const Quaternionf& orientation) :
@@ -59,15 +59,22 @@ public:
       sceneModel.activeBBox = bboxes.back().id;
     }
   };
+  bool merge(const Command& next) override {
+    auto move = dynamic_cast<const MoveBBoxCommand*>(&next);
+    if (move == nullptr || move->bbox.id != bbox.id) return false;
+    newPosition = move->newPosition;
+    newOrientation = move->newOrientation;
+    return true;
+  }
 };
 
 class ResizeBBoxCommand : public Command {
 private:
   BBox bbox;
   const Vector3f oldDimensions;
-  const Vector3f newDimensions;
+  Vector3f newDimensions;
   const Vector3f oldPosition;
-  const Vector3f newPosition;
+  Vector3f newPosition;
 
 public:
   ResizeBBoxCommand(const BBox& box, const Vector3f& dimensions, const Vector3f& position) : bbox(box), oldDimensions(bbox.dimensions), newDimensions(dimensions), oldPosition(bbox.position),
@@ -84,6 +91,13 @@ public:
     sceneModel.updateBoundingBox(bbox);
     sceneModel.activeBBox = bbox.id;
   };
+  bool merge(const Command& next) override {
+    auto resize = dynamic_cast<const ResizeBBoxCommand*>(&next);
+    if (resize == nullptr || resize->bbox.id != bbox.id) return false;
+    newDimensions = resize->newDimensions;
+    newPosition = resize->newPosition;
+    return true;
+  }
 };
 
 class ChangeBBoxClassIdCommand : public Command {
@@ -92,7 +106,7 @@ private:
   const int newClassId;
 
 public:
-  ChangeBBoxClassIdCommand(const BBox bbox, const int newClassId) : newClassId(newClassId){};
+  ChangeBBoxClassIdCommand(const BBox bbox, const int newClassId) : bbox(bbox), newClassId(newClassId){};
   void execute(SceneModel& model) {
     BBox updated = bbox;
     updated.classId = newClassId;
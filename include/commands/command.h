@@ -1,5 +1,7 @@
 #pragma once
+#include <cstddef>
 #include "scene_model.h"
+#include "commands/command_pool.h"
 
 class StudioViewController;
 
@@ -10,11 +12,27 @@ class Command {
    * A command that changes the state of the scene model.
    * Has to implement both an execute and undo method. The undo method should restore
    * the state of the scene model back to where it was prior to executing the command.
+   * Executing it again after undoing it has to redo it.
+   *
+   * Commands are allocated from the CommandPool.
    **/
 public:
   virtual ~Command(){};
   virtual void execute(SceneModel& sceneModel) = 0;
   virtual void undo(SceneModel& sceneModel) = 0;
+  /*
+   * Takes over the command executed right after this one if it continues the
+   * same edit, e.g. another drag of the same annotation, so that both are
+   * undone at once. Returns whether it did.
+   */
+  virtual bool merge([[maybe_unused]] const Command& next) { return false; }
+  /*
+   * Undoing stops at commands that can not be undone, e.g. loading annotations.
+   */
+  virtual bool undoable() const { return true; }
+
+  static void* operator new(size_t size) { return CommandPool::instance().allocate(size); }
+  static void operator delete(void* pointer) { CommandPool::instance().deallocate(pointer); }
 };
 
 } // namespace commands
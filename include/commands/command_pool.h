@@ -0,0 +1,44 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+namespace commands {
+
+class CommandPool {
+  /*
+   * Memory for commands, handed out in slots of a few fixed sizes that are
+   * carved from larger blocks. A freed slot is reused by the next command of
+   * the same size class, so pushing commands and dropping old ones from the
+   * history does not go to the heap each time. Blocks are never released.
+   *
+   * Each slot starts with a small header holding the size of the command,
+   * so that the timeline can tell how much memory its history takes.
+   */
+private:
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+  std::mutex mutex;
+  std::vector<FreeSlot*> freeSlots;
+  std::vector<void*> blocks;
+  size_t reserved = 0;
+
+  void refill(size_t sizeClass);
+
+public:
+  static CommandPool& instance();
+  CommandPool();
+  CommandPool(const CommandPool&) = delete;
+  CommandPool& operator=(const CommandPool&) = delete;
+  ~CommandPool();
+
+  void* allocate(size_t size);
+  void deallocate(void* pointer);
+  // The size of what was allocated at the pointer, as passed to allocate.
+  static size_t allocationSize(const void* pointer);
+  // Bytes taken from the heap for blocks.
+  size_t reservedBytes();
+};
+
+} // namespace commands
@@ -0,0 +1,30 @@
+#pragma once
+#include <filesystem>
+#include "commands/command.h"
+#include "scene_model.h"
+
+namespace commands {
+
+namespace fs = std::filesystem;
+class LoadAnnotationsCommand : public Command {
+  /*
+   * Loads every annotation in a file in one go, recorded in the timeline as a
+   * single checkpoint instead of one command per annotation. The loaded
+   * annotations are where editing starts, so undoing stops here.
+   */
+private:
+  const fs::path annotationPath;
+  bool loaded = false;
+
+public:
+  LoadAnnotationsCommand(const fs::path& path) : annotationPath(path) {}
+  void execute(SceneModel& sceneModel) override {
+    loaded = sceneModel.load(annotationPath);
+  }
+  // Whether the file could be read when executed.
+  bool succeeded() const { return loaded; }
+  void undo(SceneModel&) override {}
+  bool undoable() const override { return false; }
+};
+
+} // namespace commands
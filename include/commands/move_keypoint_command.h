@@ -15,5 +15,6 @@ public:
 
   void execute(SceneModel& sceneModel) override;
   void undo(SceneModel& sceneModel) override;
+  bool merge(const Command& next) override;
 };
 } // namespace commands
@@ -31,7 +31,7 @@ public:
 class EditRectangleCommand : public Command {
 private:
   const Rectangle oldRectangle;
-  const Rectangle newRectangle;
+  Rectangle newRectangle;
 public:
   EditRectangleCommand(Rectangle rectangle, Rectangle newRectangle) :
     oldRectangle(rectangle), newRectangle(newRectangle) {
@@ -46,5 +46,12 @@ public:
     sceneModel.updateRectangle(oldRectangle);
   }
 
+  bool merge(const Command& next) override {
+    auto edit = dynamic_cast<const EditRectangleCommand*>(&next);
+    if (edit == nullptr || edit->newRectangle.id != newRectangle.id) return false;
+    newRectangle = edit->newRectangle;
+    return true;
+  }
+
 };
 } // namespace commands
@@ -16,6 +16,8 @@ protected:
    */
   std::list<std::shared_ptr<Controller>> subControllers;
   void addSubController(std::shared_ptr<Controller> controller) { subControllers.push_back(controller); };
+  // Cleared when rendering.
+  mutable bool displayNeeded = true;
 
 public:
   virtual ~Controller(){};
@@ -43,6 +45,13 @@ public:
     return false;
   };
   virtual void resize(const views::Rect& r) { setRect(r); };
+  /*
+   * Frames are only rendered when something on screen has changed. Anything
+   * that changes what is drawn, other than the annotations in the scene
+   * model, should call setNeedsDisplay.
+   */
+  void setNeedsDisplay() { displayNeeded = true; };
+  virtual bool needsDisplay() const { return displayNeeded; };
 };
 
 class Controller3D : public Controller {
@@ -25,6 +25,7 @@
 #include "utils/serialize.h"
 #include "views/controls/lookat.h"
 #include "camera/camera_controls.h"
+#include "utils/autosave.h"
 #include "model/point_cloud_dataset.h"
 
 using namespace commands;
@@ -56,12 +57,16 @@ private:
   views::StatusBarView statusBarView;
 
   camera::CameraControls cameraControls;
+  // Display revision of the scene model when last rendered.
+  mutable uint64_t renderedRevision = 0;
+  utils::Autosave autosave;
 
 public:
-  PointCloudViewController(fs::path folder);
+  PointCloudViewController(fs::path folder, model::PointCloudDatasetOptions datasetOptions = {});
   void viewWillAppear(const views::Rect& r) override;
 
   void render() const;
+  bool needsDisplay() const override;
   void refresh();
 
   bool leftButtonDown(double x, double y, InputModifier mod);
@@ -73,13 +78,21 @@ public:
 
   const std::filesystem::path datasetFolder;
 
-  void save() const;
+  void save();
   void load();
   void undo();
+  void redo();
+  // Saves changed annotations in the background.
+  void updateAutosave();
+  // Picks up what finished on background threads since the last frame.
+  void updateBackgroundWork();
+  utils::Autosave& getAutosave() { return autosave; }
 
 private:
   views::View3D& getActiveToolView();
   views::Rect statusBarRect() const;
   void updateViewContext(double x, double y, InputModifier mod);
   void nextPointCloud();
+  void previousPointCloud();
+  void showPointCloud(int index);
 };
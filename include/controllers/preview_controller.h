@@ -1,34 +1,62 @@
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <optional>
 #include "controllers/controller.h"
 #include "views/image_pane.h"
 #include "views/annotation_view.h"
 #include "view_context_3d.h"
 #include "scene_model.h"
+#include "model/dataset_index.h"
+#include "model/frame_prefetcher.h"
+#include "model/thumbnail_cache.h"
 #include <filesystem>
 
 namespace controllers {
 class PreviewController : public controllers::Controller3D {
 private:
   int viewId;
-  fs::path datasetPath;
-  const SceneCamera sceneCamera;
+  std::shared_ptr<const model::DatasetIndex> dataset;
+  model::FramePrefetcher frames;
   const SceneModel& model;
   ViewContext3D viewContext;
 
   std::unique_ptr<views::ImagePane> imageView;
   std::unique_ptr<views::AnnotationView> annotationView;
 
+  std::optional<size_t> currentFrame;
+  bool showingThumbnail = false;
+  // The full image of the current frame while a thumbnail is shown in its place.
+  model::FrameFuture pendingImage;
+  std::unique_ptr<model::ThumbnailCache> thumbnails;
+  // Set by thumbnailGenerator once the cache is written.
+  std::atomic<bool> thumbnailsGenerated = false;
+  std::jthread thumbnailGenerator;
+
 public:
-  PreviewController(const SceneModel& model, fs::path datasetPath, int viewId);
+  PreviewController(const SceneModel& model, std::shared_ptr<const model::DatasetIndex> dataset, int viewId);
   void viewWillAppear(const views::Rect& rect) override;
   bool leftButtonUp(const ViewContext3D& viewContext) override;
   bool leftButtonDown(const ViewContext3D& viewContext) override;
   bool keypress(char keypress, const InputModifier mod) override;
   void render() const;
+  /*
+   * Opens the thumbnails once generated and shows full images once decoded,
+   * returns true if the image shown changed.
+   */
+  bool updateImage();
 
 private:
   void setRandomImage();
   void setImage(float t);
-  void setImage(int i);
+  void setImage(size_t frame);
+  void showImage(size_t frame);
+  // Nullptr if there is none, or the GPU can't sample its format.
+  std::unique_ptr<model::ThumbnailCache> openThumbnails() const;
+  /*
+   * Thumbnails are shown instead of full images while they are at least as
+   * large as the pane, else only until the full image is decoded.
+   */
+  bool useThumbnail(size_t frame) const;
 };
 } // namespace controllers
@@ -16,6 +16,8 @@
 #include "views/add_rectangle_view.h"
 #include "views/controls/lookat.h"
 #include "camera/camera_controls.h"
+#include "utils/autosave.h"
+#include "model/dataset_index.h"
 #include <filesystem>
 
 namespace fs = std::filesystem;
@@ -24,6 +26,7 @@ class StudioViewController : public controllers::Controller {
 private:
   int viewId;
   SceneModel sceneModel;
+  std::shared_ptr<const model::DatasetIndex> datasetIndex;
   SceneCamera sceneCamera;
   fs::path datasetPath;
   fs::path pointCloudPath;
@@ -49,11 +52,15 @@ private:
   std::shared_ptr<controllers::PreviewController> preview;
 
   camera::CameraControls cameraControls;
+  // Display revision of the scene model when last rendered.
+  mutable uint64_t renderedRevision = 0;
+  utils::Autosave autosave;
 public:
   StudioViewController(fs::path datasetPath);
   void viewWillAppear(const views::Rect& r) override;
 
   void render() const;
+  bool needsDisplay() const override;
   void refresh();
 
   bool leftButtonDown(double x, double y, InputModifier mod);
@@ -63,9 +70,15 @@ public:
   bool keypress(char character, const InputModifier mod) override;
   void resize(const views::Rect& r) override;
 
-  void save() const;
+  void save();
   void load();
   void undo();
+  void redo();
+  // Saves changed annotations in the background.
+  void updateAutosave();
+  // Picks up what finished on background threads since the last frame.
+  void updateBackgroundWork();
+  utils::Autosave& getAutosave() { return autosave; }
 
 private:
   views::View3D& getActiveToolView();
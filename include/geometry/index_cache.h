@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+#include <filesystem>
+#include "utils/mapped_file.h"
+
+namespace geometry {
+
+enum class IndexKind : uint32_t {
+  TriangleMesh = 1,
+  PointCloud = 2,
+  // Bounds are computed from the decoded positions, which differ slightly.
+  QuantizedPointCloud = 3
+};
+
+enum class IndexSection : uint32_t {
+  BVHNodes = 1,
+  BVHIndices = 2,
+  // 3 was used for a serialized KD-tree up to version 1.
+  PointNormals = 4
+};
+
+class IndexCache {
+  /*
+   * Versioned sidecar file holding the acceleration structures built for a
+   * .ply file, stored next to it as .<name>.ply.bvh. It is keyed by the size,
+   * modification time and a hash of the header of the .ply file and is
+   * ignored as soon as any of them change, in which case the caller rebuilds
+   * and saves. The body is never read, so opening a cache stays cheap
+   * however large the file.
+   *
+   * Loaded sections point straight into the memory mapped cache file and are
+   * valid for as long as the IndexCache is alive.
+   */
+public:
+  // Bump whenever the file layout or the layout of any section changes.
+  static const uint32_t Version = 3;
+
+private:
+  std::filesystem::path sourceFile;
+  IndexKind kind;
+  std::unique_ptr<utils::MappedFile> mapped;
+  std::vector<std::pair<IndexSection, std::span<const uint8_t>>> sections;
+  mutable std::optional<uint64_t> headerHash;
+
+public:
+  IndexCache(const std::filesystem::path& sourceFile, IndexKind kind);
+  std::filesystem::path path() const;
+
+  // Maps the cache file. Returns false if it is missing, corrupt or stale.
+  bool load();
+  std::span<const uint8_t> getSection(IndexSection section) const;
+  template <typename T>
+  std::span<const T> getArray(IndexSection section) const {
+    std::span<const uint8_t> bytes = getSection(section);
+    if (bytes.size() % sizeof(T) != 0) return {};
+    return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+  }
+
+  // The data is not copied and has to stay alive until save() is called.
+  void setSection(IndexSection section, const void* data, size_t size);
+  template <typename T>
+  void setArray(IndexSection section, const std::vector<T>& values) {
+    setSection(section, values.data(), values.size() * sizeof(T));
+  }
+  // Writes to a temporary file which is then moved in place. Returns false on failure.
+  bool save() const;
+
+private:
+  bool loadMapped(std::unique_ptr<utils::MappedFile> file);
+  uint64_t getHeaderHash() const;
+};
+
+} // namespace geometry
@@ -56,5 +56,9 @@ class Mesh : public TriangleMesh {
 public:
   Mesh(const std::string& meshFile, const Matrix4f& T = Matrix4f::Identity(), float scale = 1.0);
   ~Mesh();
+
+private:
+  bool loadBinary(const std::string& meshFile, float scale);
+  void loadWithHapply(const std::string& meshFile, float scale);
 };
 } // namespace geometry
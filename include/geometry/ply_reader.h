@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <eigen3/Eigen/Core>
+#include "utils/mapped_file.h"
+
+namespace geometry {
+
+namespace fs = std::filesystem;
+
+class PlyReader {
+  /*
+   * Reads binary little endian .ply files straight out of a memory mapping.
+   * The header is parsed once on construction and property columns are then
+   * decoded into Eigen matrices in parallel, without intermediate copies.
+   * Other encodings are left to happly, see isBinaryLittleEndian().
+   */
+public:
+  enum class Type { Int8,
+                    UInt8,
+                    Int16,
+                    UInt16,
+                    Int32,
+                    UInt32,
+                    Float32,
+                    Float64 };
+
+  struct Property {
+    std::string name;
+    Type type; // Item type for list properties.
+    bool isList = false;
+    Type countType = Type::UInt8;
+    size_t offset = 0; // Byte offset within a record, only valid for fixed size records.
+  };
+
+  struct Element {
+    std::string name;
+    size_t count = 0;
+    std::vector<Property> properties;
+    size_t stride = 0; // Record size in bytes, 0 if the element has list properties.
+  };
+
+private:
+  utils::MappedFile file;
+  std::string format;
+  std::vector<Element> elements;
+  size_t dataOffset = 0;
+
+public:
+  PlyReader(const fs::path& path);
+  bool isBinaryLittleEndian() const;
+  const Element* getElement(const std::string& name) const;
+  const Property* getProperty(const std::string& element, const std::string& property) const;
+  bool hasProperty(const std::string& element, const std::string& property) const;
+
+  /*
+   * Reads three scalar properties of an element into the columns of out.
+   * Values are multiplied by scale on the way.
+   */
+  template <typename Scalar>
+  void readColumns(const std::string& element, const std::array<std::string, 3>& properties,
+                   Eigen::Matrix<Scalar, Eigen::Dynamic, 3, Eigen::RowMajor>& out, float scale = 1.0f) const;
+  /*
+   * Reads red, green and blue vertex colors. Floating point colors are
+   * expected to be in [0, 1] and are rescaled to [0, 255].
+   */
+  template <typename Scalar>
+  void readColors(Eigen::Matrix<Scalar, Eigen::Dynamic, 3, Eigen::RowMajor>& out) const;
+  /*
+   * Reads the face element into out. Returns false if some face is not a triangle,
+   * in which case out is left in an unspecified state.
+   */
+  bool readTriangles(Eigen::Matrix<uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>& out) const;
+
+private:
+  void parseHeader();
+  size_t elementOffset(const Element& element) const;
+  size_t elementSize(const Element& element, size_t offset) const;
+};
+
+} // namespace geometry
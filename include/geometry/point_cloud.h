@@ -4,14 +4,69 @@
 namespace geometry {
 
 using RowMatrixf = Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>;
-using RowMatrixu8 = Eigen::Matrix<uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>;
+using RowMatrixu8 = Eigen::Matrix<uint8_t, Eigen::Dynamic, 3, Eigen::RowMajor>;
+using RowMatrixi16 = Eigen::Matrix<int16_t, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+/*
+ * Maps 16 bit integer positions onto the bounding box of a cloud. A stored
+ * value q stands for center + scale * q, with q in [-Range, Range].
+ */
+struct PositionQuantization {
+  static constexpr float Range = 32767.0f;
+  Eigen::Vector3f center = Eigen::Vector3f::Zero();
+  Eigen::Vector3f scale = Eigen::Vector3f::Ones();
+
+  Eigen::Vector3f decode(const int16_t* q) const {
+    return center + scale.cwiseProduct(Eigen::Vector3f(q[0], q[1], q[2]));
+  }
+};
 
 class PointCloud {
 public:
+  /*
+   * Positions are kept either as floats in points or, when loaded with
+   * quantizePositions, as 16 bit integers in quantizedPoints relative to the
+   * bounding box of the cloud, in which case points is empty. The error is at
+   * most half a step, 1/65534th of the extent of the cloud along each axis.
+   * Use size() and point() where either storage will do.
+   */
   RowMatrixf points;
+  RowMatrixi16 quantizedPoints;
+  PositionQuantization quantization;
   RowMatrixu8 colors;
-  PointCloud(const std::string& filepath);
+  /*
+   * Unit normals, one per point. Read from the nx, ny and nz properties if the
+   * file has them, otherwise empty until estimateNormals() has been called.
+   * Normals from the file are normalized, those of about zero length are left
+   * at zero until estimated. Their sign is arbitrary.
+   */
+  RowMatrixf normals;
+  PointCloud(const std::string& filepath, bool quantizePositions = false);
   Eigen::RowVector3f getMean() const;
   Eigen::RowVector3f getStd() const;
+  size_t sizeInBytes() const;
+  bool isQuantized() const { return quantizedPoints.rows() > 0; }
+  size_t size() const { return isQuantized() ? quantizedPoints.rows() : points.rows(); }
+  Eigen::Vector3f point(size_t i) const {
+    if (isQuantized()) return quantization.decode(quantizedPoints.row(i).data());
+    return points.row(i).transpose();
+  }
+  // Whether every point has a unit normal.
+  bool hasNormals() const { return size_t(normals.rows()) == size() && size() > 0 && missingNormals == 0; }
+  /*
+   * Fits a plane to the nearest neighbours of every point, in parallel, and
+   * takes its normal. Only normals missing from the file are replaced. Slow
+   * for large clouds, RayTraceCloud caches the result.
+   */
+  void estimateNormals();
+  // Normals estimated before, one unit normal per point.
+  void setNormals(RowMatrixf estimated);
+
+private:
+  // Normals in the file that were too short to normalize.
+  size_t missingNormals = 0;
+
+  void quantize();
+  void normalizeNormals();
 };
 } // namespace geometry
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+#include <eigen3/Eigen/Core>
+#include "geometry/point_cloud.h"
+
+namespace geometry {
+
+struct OctreeNode {
+  Eigen::Vector3f center;
+  float halfSize;
+  // Rough distance between neighbouring points of the node, assuming they lie on a surface.
+  float spacing;
+  // Range of PointCloudOctree::getOrder() holding the points of this node.
+  uint32_t begin;
+  uint32_t count;
+  std::array<int32_t, 8> children; // -1 where there is no child.
+  uint8_t depth;
+};
+
+struct OctreeOptions {
+  // Points kept in each inner node, leaves may hold more once maxDepth is reached.
+  size_t nodeCapacity = 20000;
+  int maxDepth = 20;
+};
+
+/*
+ * What the camera sees, for picking the nodes to draw.
+ */
+struct LODQuery {
+  // World to clip space, column vectors.
+  Eigen::Matrix4f viewProjection;
+  Eigen::Vector3f eye;
+  // Viewport height over 2 tan(fov / 2), converts a size at unit distance to pixels.
+  float pixelsPerUnit;
+  size_t pointBudget = 3000000;
+  // Nodes whose point spacing covers fewer pixels than this are not refined further.
+  float maxScreenSpaceError = 1.5f;
+};
+
+class PointCloudOctree {
+  /*
+   * Level of detail hierarchy over a point cloud. Every point belongs to
+   * exactly one node: inner nodes keep an evenly strided subset of the points
+   * inside them and pass the rest on to their children, so drawing a node
+   * together with its ancestors gives a uniformly thinned out version of the
+   * cloud, which is complete at the leaves.
+   *
+   * The points of a node are a contiguous range of getOrder(), so they can be
+   * packed and uploaded, or paged in from disk, one node at a time.
+   */
+private:
+  std::vector<OctreeNode> nodes;
+  std::vector<uint32_t> order;
+  OctreeOptions options;
+  size_t largestNode = 0;
+
+public:
+  PointCloudOctree(const PointCloud& pointCloud, OctreeOptions options = {});
+  const std::vector<OctreeNode>& getNodes() const { return nodes; }
+  const std::vector<uint32_t>& getOrder() const { return order; }
+  std::span<const uint32_t> nodePoints(uint32_t node) const;
+  size_t maxNodeSize() const { return largestNode; }
+  size_t sizeInBytes() const;
+
+  /*
+   * Picks the nodes to draw for a view, coarsest on screen first. A node is
+   * only picked if it intersects the view frustum and its parent was picked,
+   * and is refined while its spacing projects to more than
+   * maxScreenSpaceError pixels. Stops once the point budget is used up.
+   */
+  std::vector<uint32_t> select(const LODQuery& query) const;
+  float screenSpaceError(const OctreeNode& node, const LODQuery& query) const;
+
+private:
+  void build(const PointCloud& pointCloud, uint32_t nodeIndex);
+};
+
+} // namespace geometry
@@ -1,49 +1,61 @@
+#pragma once
 #include <memory>
+#include <atomic>
 #include <optional>
-#include <nanoflann.hpp>
+#include <limits>
+#include <span>
+#include <vector>
 #define NANORT_ENABLE_PARALLEL_BUILD 1
 #include "3rdparty/nanort.h"
 #include "3rdparty/particle_tracing.h"
 #include "geometry/ray_trace_mesh.h"
 #include "geometry/point_cloud.h"
+#include "geometry/index_cache.h"
 
 #include <iostream>
 namespace geometry {
 
 using RowMatrixf = Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>;
 
-template <typename T>
-struct PCAdaptor {
-  const RowMatrixf& pointCloud;
-  PCAdaptor(const RowMatrixf& pc) : pointCloud(pc) {}
-
-  using coord_t = T;
-  inline uint32_t kdtree_get_point_count() const { return pointCloud.rows(); };
-  inline T kdtree_get_pt(const uint32_t idx, const uint32_t dim) const {
-    RowVector3f vec = pointCloud.row(idx);
-    if (dim == 0) return vec[0];
-    else if(dim == 1) return vec[1];
-    else return vec[2];
-  }
-  template <class BBOX>
-  bool kdtree_get_bbox(BBOX& ) const { return false; }
-};
-
-using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
-  nanoflann::L2_Simple_Adaptor<float, PCAdaptor<float>, float>,
-  PCAdaptor<float>, 3>;
-
+/*
+ * Ray tracing against a point cloud, with points treated as small spheres.
+ * Constructing is cheap. The BVH is built and the point normals are estimated,
+ * unless the cloud came with them, by build(), which is meant to run on a
+ * background thread. Until it has finished, queries fall back to testing
+ * every point and return the ray direction as the normal. If the BVH cannot
+ * be built, build() throws std::runtime_error and queries keep falling back.
+ *
+ * If the file the cloud was loaded from is given, build() loads the BVH and
+ * normals from its sidecar cache when it is up to date, and writes the cache
+ * otherwise.
+ *
+ * Queries keep no state between calls and can be made from several threads at
+ * once, also while build() is running.
+ */
 class RayTraceCloud {
 private:
   std::shared_ptr<PointCloud> pointCloud;
+  std::filesystem::path sourceFile;
   nanort::BVHAccel<float> bvh;
-  float& pointSize;
-  PCAdaptor<float> adaptor;
-  KDTree index;
+  bool normalsEstimated = false;
+  std::atomic<bool> ready = false;
+
 public:
-  RayTraceCloud(std::shared_ptr<geometry::PointCloud> pc, float& pointCloudPointSize);
-  std::optional<Vector3f> traceRay(const Vector3f& origin, const Vector3f& direction) const;
-  Intersection traceRayIntersection(const Vector3f& origin, const Vector3f& direction) const;
+  RayTraceCloud(std::shared_ptr<geometry::PointCloud> pc, const std::filesystem::path& sourceFile = {});
+  void build();
+  bool isReady() const { return ready.load(std::memory_order_acquire); }
+  size_t sizeInBytes() const;
+  std::optional<Vector3f> traceRay(const Vector3f& origin, const Vector3f& direction, float pointSize) const;
+  Intersection traceRayIntersection(const Vector3f& origin, const Vector3f& direction, float pointSize) const;
+  // Traces all rays in parallel. Either all or none of them use the BVH.
+  std::vector<Intersection> traceRays(std::span<const Ray> rays, float pointSize) const;
+
+private:
+  void buildIndices();
+  bool loadIndices(const IndexCache& cache);
+  void saveIndices(IndexCache& cache) const;
+  std::optional<uint32_t> closestHit(const Vector3f& origin, const Vector3f& direction, float pointSize, bool built) const;
+  Intersection intersect(const Vector3f& origin, const Vector3f& direction, float pointSize, bool built) const;
 };
 }
 
@@ -2,6 +2,7 @@
 #include <optional>
 #include <memory>
 #include "geometry/mesh.h"
+#include "geometry/index_cache.h"
 #define NANORT_ENABLE_PARALLEL_BUILD 1
 #include "3rdparty/nanort.h"
 
@@ -14,6 +15,11 @@ struct Intersection {
   Vector3f normal;
 };
 
+struct Ray {
+  Vector3f origin;
+  Vector3f direction;
+};
+
 class RayTraceMesh {
 private:
   // Geometry.
@@ -22,7 +28,11 @@ private:
   nanort::BVHAccel<float> bvh;
 
 public:
-  RayTraceMesh(std::shared_ptr<geometry::TriangleMesh> mesh);
+  /*
+   * If the file the mesh was loaded from is given, the BVH is loaded from its
+   * sidecar cache when it is up to date, and the cache is written otherwise.
+   */
+  RayTraceMesh(std::shared_ptr<geometry::TriangleMesh> mesh, const std::filesystem::path& sourceFile = {});
   std::optional<Vector3f> traceRay(const Vector3f& origin, const Vector3f& direction) const;
   Intersection traceRayIntersection(const Vector3f& origin, const Vector3f& direction) const;
 };
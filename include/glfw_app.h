@@ -24,5 +24,5 @@ public:
   virtual ~GLFWApp();
   virtual void resize(int newWidth, int newHeight);
   void setView(std::shared_ptr<views::View> v);
-  virtual bool update() const = 0;
+  virtual bool update() = 0;
 };
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace model {
+
+template <typename T>
+class AnnotationStore {
+  /*
+   * Annotations of one kind, kept contiguous so that views can iterate over
+   * them in one pass, with an index from id to position for constant time
+   * lookup, update and removal. Removing moves the last annotation into the
+   * gap, so the order of annotations is not preserved.
+   *
+   * Snapshots share the annotations with the store until the store is
+   * changed, which copies them first.
+   */
+private:
+  std::shared_ptr<std::vector<T>> annotations = std::make_shared<std::vector<T>>();
+  std::unordered_map<int, size_t> positions;
+  // Ids are never handed out twice, even after the annotation is removed.
+  int nextFreeId = 1;
+
+  std::vector<T>& writable() {
+    if (annotations.use_count() > 1) {
+      annotations = std::make_shared<std::vector<T>>(*annotations);
+    }
+    return *annotations;
+  }
+
+public:
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  /*
+   * Returns an id that is not used by any annotation in the store.
+   */
+  int nextId() { return nextFreeId++; }
+  /*
+   * The id nextId will return. Saved with the annotations, so that ids are
+   * not reused after loading them again. Setting it never lowers it.
+   */
+  int getNextId() const { return nextFreeId; }
+  void setNextId(int id) { nextFreeId = std::max(nextFreeId, id); }
+
+  /*
+   * The id of the annotation has to be unique within the store.
+   */
+  void add(const T& annotation) {
+    assert(!contains(annotation.id) && "Annotation ids have to be unique.");
+    std::vector<T>& all = writable();
+    positions[annotation.id] = all.size();
+    all.push_back(annotation);
+    if (annotation.id >= nextFreeId) nextFreeId = annotation.id + 1;
+  }
+
+  bool remove(int id) {
+    auto position = positions.find(id);
+    if (position == positions.end()) return false;
+    std::vector<T>& all = writable();
+    size_t index = position->second;
+    positions.erase(position);
+    if (index != all.size() - 1) {
+      all[index] = std::move(all.back());
+      positions[all[index].id] = index;
+    }
+    all.pop_back();
+    return true;
+  }
+
+  /*
+   * Replaces the annotation with the same id. Returns false if there is none.
+   */
+  bool update(const T& annotation) {
+    T* existing = find(annotation.id);
+    if (existing == nullptr) return false;
+    *existing = annotation;
+    return true;
+  }
+
+  const T* find(int id) const {
+    auto position = positions.find(id);
+    return position == positions.end() ? nullptr : &(*annotations)[position->second];
+  }
+  T* find(int id) {
+    auto position = positions.find(id);
+    return position == positions.end() ? nullptr : &writable()[position->second];
+  }
+  bool contains(int id) const { return positions.count(id) > 0; }
+
+  void clear() {
+    annotations = std::make_shared<std::vector<T>>();
+    positions.clear();
+    nextFreeId = 1;
+  }
+  void reserve(size_t count) {
+    writable().reserve(count);
+    positions.reserve(count);
+  }
+
+  size_t size() const { return annotations->size(); }
+  bool empty() const { return annotations->empty(); }
+  const_iterator begin() const { return annotations->begin(); }
+  const_iterator end() const { return annotations->end(); }
+  const T& operator[](size_t index) const { return (*annotations)[index]; }
+  const std::vector<T>& all() const { return *annotations; }
+  /*
+   * For changing annotations in place without going through update. Ids must
+   * not be changed.
+   */
+  std::vector<T>& all() { return writable(); }
+  /*
+   * The annotations as they are now, unaffected by later changes. Safe to
+   * read from another thread.
+   */
+  std::shared_ptr<const std::vector<T>> snapshot() const { return annotations; }
+};
+
+} // namespace model
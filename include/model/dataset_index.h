@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <eigen3/Eigen/Dense>
+#include "camera.h"
+
+namespace fs = std::filesystem;
+
+namespace model {
+
+class DatasetIndex {
+  /*
+   * The frames of a dataset: the color images in order, the camera pose of
+   * each and the camera intrinsics. Built once when the dataset is opened and
+   * shared by everything showing its frames, so that looking up a frame
+   * never touches the disk.
+   *
+   * A frame needs both an image and a pose, extra images or poses at the end
+   * are ignored.
+   */
+private:
+  fs::path path;
+  SceneCamera camera;
+  std::vector<fs::path> imagePaths;
+  std::vector<Eigen::Matrix4f> cameraPoses;
+
+public:
+  DatasetIndex(const fs::path& datasetPath);
+  DatasetIndex(const DatasetIndex&) = delete;
+  DatasetIndex& operator=(const DatasetIndex&) = delete;
+
+  const fs::path& getPath() const { return path; }
+  const SceneCamera& getCamera() const { return camera; }
+  size_t size() const { return std::min(imagePaths.size(), cameraPoses.size()); }
+  bool empty() const { return size() == 0; }
+  const fs::path& imagePath(size_t frame) const { return imagePaths[frame]; }
+  // Camera to world transform of the frame.
+  const Eigen::Matrix4f& cameraPose(size_t frame) const { return cameraPoses[frame]; }
+  // The frame at t in [0, 1] of the way through the dataset, e.g. along a scrub bar.
+  size_t frameAt(float t) const;
+};
+
+} // namespace model
@@ -0,0 +1,73 @@
+#pragma once
+#include <map>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <future>
+#include <thread>
+#include <condition_variable>
+#include "model/dataset_index.h"
+#include "texture_utils.h"
+
+namespace model {
+
+using FrameFuture = std::shared_future<texture_utils::ImagePtr>;
+
+struct FramePrefetcherOptions {
+  // Frames after the current one to decode ahead of time.
+  int lookAhead = 8;
+  int workers = 2;
+};
+
+/*
+ * Decodes the color images of a dataset on a pool of worker threads, the
+ * current frame first, then the frames after it in order. At most the
+ * current frame and the look-ahead window are held, so memory stays bounded
+ * during playback. Frames left behind are dropped, as are queued decodes the
+ * window moved away from.
+ *
+ * Decoded images are ready to be uploaded as they are, so the UI thread only
+ * creates textures from them, see texture_utils::createTexture.
+ */
+class FramePrefetcher {
+private:
+  struct Entry {
+    std::shared_ptr<std::promise<texture_utils::ImagePtr>> promise;
+    FrameFuture future;
+  };
+
+  std::shared_ptr<const DatasetIndex> dataset;
+  FramePrefetcherOptions options;
+  size_t currentFrame = 0;
+
+  mutable std::mutex mutex;
+  std::condition_variable jobAvailable;
+  std::map<size_t, Entry> frames;
+  std::deque<size_t> jobs;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+
+public:
+  FramePrefetcher(std::shared_ptr<const DatasetIndex> dataset, FramePrefetcherOptions options = {});
+  FramePrefetcher(const FramePrefetcher&) = delete;
+  FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+  ~FramePrefetcher();
+
+  /*
+   * Makes the frame the current one and starts decoding the frames after
+   * it. The image is nullptr if the frame could not be decoded. The dataset
+   * must not be empty.
+   */
+  FrameFuture seek(size_t frame);
+  // Whether the frame is decoded and held.
+  bool isReady(size_t frame) const;
+  // Frames held or being decoded.
+  size_t size() const;
+
+private:
+  void scheduleWindow();
+  void run();
+};
+
+} // namespace model
@@ -1,32 +1,103 @@
+#pragma once
 #include <filesystem>
 #include <vector>
+#include <map>
+#include <deque>
 #include <memory>
 #include <future>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "geometry/point_cloud.h"
+#include "geometry/ray_trace_cloud.h"
+#include "geometry/point_cloud_octree.h"
 
 namespace fs = std::filesystem;
 
 namespace model {
 using PointCloudPtr = std::shared_ptr<geometry::PointCloud>;
 
+struct DatasetPointCloud {
+  PointCloudPtr pointCloud;
+  std::shared_ptr<const geometry::PointCloudOctree> octree;
+  // Becomes ready once its acceleration structures have been built in the background.
+  std::shared_ptr<geometry::RayTraceCloud> rayTraceCloud;
+};
+using DatasetPointCloudFuture = std::shared_future<DatasetPointCloud>;
+
+struct PointCloudDatasetOptions {
+  // Number of clouds after and before the current one to keep loaded.
+  int lookAhead = 2;
+  int lookBehind = 1;
+  // Decoded clouds outside of the window are kept around until this is exceeded.
+  size_t memoryBudget = size_t(2) << 30;
+  // Store positions as 16 bit integers, see geometry::PointCloud.
+  bool quantizePositions = false;
+};
+
+/*
+ * Walks through the .ply files in a directory. Clouds are decoded on a
+ * background thread, together with their level of detail octree: the current
+ * cloud first, then the clouds inside the look-ahead/look-behind window,
+ * nearest first. The ray tracing structures of
+ * a cloud are built on the same thread right after it is decoded.
+ * Decoded clouds are kept in an LRU cache bounded by the memory budget, so
+ * moving back and forth is instant. Loads that are still queued when the
+ * window moves away from them are dropped.
+ *
+ * If a cloud can not be loaded, its future holds the exception. The failure
+ * is not cached, the cloud is loaded again the next time it is in the window.
+ * The current index has moved to it all the same, seek back to the cloud
+ * that is still shown.
+ */
 class PointCloudDataset {
 private:
+  struct CacheEntry {
+    std::shared_ptr<std::promise<DatasetPointCloud>> promise;
+    DatasetPointCloudFuture future;
+    bool loaded = false;
+    // Loading threw, the future holds the exception.
+    bool failed = false;
+    size_t bytes = 0;
+    uint64_t lastUsed = 0;
+  };
+
   fs::path path;
-  fs::path currentPointCloud;
-  std::shared_future<PointCloudPtr> currentCloud, nextCloud;
   std::vector<fs::path> pointClouds;
   int currentIndex = -1;
+  PointCloudDatasetOptions options;
+
+  mutable std::mutex mutex;
+  std::condition_variable jobAvailable;
+  std::map<int, CacheEntry> cache;
+  std::deque<int> jobs;
+  size_t cachedBytes = 0;
+  uint64_t useCounter = 0;
+  bool stopping = false;
+  std::thread worker;
 
 public:
-  PointCloudDataset(fs::path current);
-  const std::shared_future<PointCloudPtr>& getCurrentCloud() const;
+  PointCloudDataset(fs::path current, PointCloudDatasetOptions options = {});
+  ~PointCloudDataset();
+  DatasetPointCloudFuture getCurrentCloud() const;
+  int getCurrentIndex() const { return currentIndex; }
   fs::path currentPath() const;
   fs::path nextPath() const;
-  std::shared_future<PointCloudPtr> next();
+  fs::path previousPath() const;
+  DatasetPointCloudFuture next();
+  DatasetPointCloudFuture previous();
+  DatasetPointCloudFuture seek(int index);
+  size_t size() const;
+  // Whether the cloud at index is loaded, with its ray tracing structures built, and held in the cache.
+  bool isCached(int index) const;
+  size_t cacheSizeInBytes() const;
 
 private:
   void indexPointClouds();
-  std::shared_future<PointCloudPtr> fetchPointCloud(fs::path pcPath);
+  int wrap(int index) const;
+  std::vector<int> window() const;
+  void scheduleWindow();
+  void evict();
+  void run();
 };
 } // namespace model
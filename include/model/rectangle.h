@@ -10,7 +10,6 @@ struct Rectangle {
   // Rotation from canonical world coordinates to local coordinates.
   Quaternionf orientation;
   Vector2f size; // width, height.
-  bool rotateControl = false;
 
   Rectangle();
   Rectangle(const Rectangle& rectangle);
@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <stop_token>
+#include <filesystem>
+#include "model/dataset_index.h"
+#include "utils/mapped_file.h"
+#include "texture_utils.h"
+
+namespace model {
+
+struct ThumbnailOptions {
+  /*
+   * Images are shrunk by a power of two until they are at most this wide.
+   * Wide enough to fill the preview, a quarter of the window, in windows up
+   * to about 1920 pixels wide, so that it only decodes full images when larger.
+   */
+  int maxWidth = 480;
+  // Whether to store thumbnails in BC1 rather than RGBA8, see texture_utils::compressImage.
+  bool compress = true;
+  // Threads decoding images, few enough to leave the others to the studio.
+  int threads = 2;
+};
+
+class ThumbnailCache {
+  /*
+   * Downscaled copies of the color images of a dataset, packed into a single
+   * file as BC1 or RGBA8 pixels, ready to be uploaded. The file starts with a
+   * header and a table with the offset and size of each frame, and is mapped
+   * into memory, so showing a frame only copies its pixels and never decodes.
+   *
+   * The cache belongs to the frames of the dataset at the time it was
+   * generated. Each entry keeps the size and modification time of the image
+   * it was made from, the cache is not used if the number of frames or any of
+   * them changed since. Caches are kept in the cache directory of the user,
+   * not in the dataset.
+   */
+public:
+  struct Header {
+    char magic[8];
+    uint32_t frames;
+    // A bgfx::TextureFormat, the same for all frames.
+    uint32_t format;
+  };
+  struct Entry {
+    uint64_t offset;
+    // Zero if the image of the frame could not be read.
+    uint32_t size;
+    uint16_t width;
+    uint16_t height;
+    // Of the image the thumbnail was made from, both zero if there was none.
+    uint64_t imageSize;
+    int64_t imageTime;
+  };
+
+private:
+  utils::MappedFile file;
+  const Entry* entries = nullptr;
+  size_t frames = 0;
+  bgfx::TextureFormat::Enum format = bgfx::TextureFormat::RGBA8;
+
+public:
+  ThumbnailCache(const fs::path& path);
+  ThumbnailCache(const ThumbnailCache&) = delete;
+  ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+  /*
+   * Where the cache of the dataset is kept, under $XDG_CACHE_HOME or else
+   * ~/.cache, in a file named after the absolute path of the dataset.
+   */
+  static fs::path pathFor(const DatasetIndex& dataset);
+  /*
+   * Returns nullptr if there is no cache at the path, or it is not one for
+   * the frames of the dataset. Looks up every image of the dataset, but does
+   * not read them.
+   */
+  static std::unique_ptr<ThumbnailCache> open(const fs::path& path, const DatasetIndex& dataset);
+  /*
+   * Decodes and shrinks the images of the dataset on a few threads and
+   * writes them to the path, creating its directory if needed. The file is
+   * written to a temporary file first, which then replaces it. Returns false
+   * and prints why if writing failed, or if stopped early.
+   */
+  static bool generate(const DatasetIndex& dataset, const fs::path& path, ThumbnailOptions options = {},
+                       std::stop_token stop = {});
+
+  size_t size() const { return frames; }
+  bgfx::TextureFormat::Enum textureFormat() const { return format; }
+  bool contains(size_t frame) const { return frame < frames && entries[frame].size > 0; }
+  uint16_t width(size_t frame) const { return entries[frame].width; }
+  uint16_t height(size_t frame) const { return entries[frame].height; }
+  // A copy of the thumbnail, nullptr if the frame has none.
+  texture_utils::ImagePtr image(size_t frame) const;
+};
+
+} // namespace model
@@ -2,13 +2,19 @@
 #define H_SCENE_MODEL
 #include <memory>
 #include <optional>
+#include <atomic>
+#include <thread>
+#include <functional>
 #include <filesystem>
 #include <map>
+#include <variant>
 #include "model/rectangle.h"
+#include "model/annotation_store.h"
 #include "geometry/mesh.h"
 #include "geometry/point_cloud.h"
 #include "geometry/ray_trace_mesh.h"
 #include "geometry/ray_trace_cloud.h"
+#include "geometry/point_cloud_octree.h"
 #include "camera.h"
 
 struct Keypoint {
@@ -29,6 +35,40 @@ struct BBox {
   Vector3f dimensions = Vector3f::Ones() * 0.2;
 };
 
+// The next id of each annotation type.
+struct AnnotationIds {
+  int keypoints = 1;
+  int boundingBoxes = 1;
+  int rectangles = 1;
+};
+
+// The annotations of a scene at one point in time.
+struct AnnotationSnapshot {
+  std::shared_ptr<const std::vector<Keypoint>> keypoints;
+  std::shared_ptr<const std::vector<BBox>> boundingBoxes;
+  std::shared_ptr<const std::vector<Rectangle>> rectangles;
+  AnnotationIds nextIds;
+  uint64_t revision;
+};
+
+// An annotation added, changed or removed, as written to the edit journal.
+struct AnnotationEdit {
+  enum Kind : uint8_t {
+    SetKeypoint,
+    SetBoundingBox,
+    SetRectangle,
+    RemoveKeypoint,
+    RemoveBoundingBox,
+    RemoveRectangle
+  };
+  Kind kind;
+  // The annotation revision right after the edit.
+  uint64_t revision;
+  int id;
+  // The annotation after the edit, for the Set kinds.
+  std::variant<std::monostate, Keypoint, BBox, Rectangle> annotation;
+};
+
 struct InstanceMetadata {
   std::string name = "";
   Vector3f size = Vector3f::Ones() * 0.2;
@@ -59,10 +99,54 @@ class SceneModel {
 private:
   std::shared_ptr<geometry::TriangleMesh> mesh;
   std::shared_ptr<geometry::PointCloud> pointCloud;
+  std::shared_ptr<const geometry::PointCloudOctree> pointCloudOctree;
   std::optional<geometry::RayTraceMesh> rtMesh;
-  std::optional<geometry::RayTraceCloud> rtPointCloud;
+  std::shared_ptr<geometry::RayTraceCloud> rtPointCloud;
   std::optional<std::string> meshPath;
   std::optional<std::string> pointCloudPath;
+  uint64_t annotationRevision = 0;
+  int hoveredRectangle = -1;
+  uint64_t hoverRevision = 0;
+
+  // The last ray traced, several views ask about the same cursor position.
+  struct TracedRay {
+    Vector3f origin;
+    Vector3f direction;
+    active_view::ActiveView view;
+    float pointSize;
+    uint64_t geometryRevision;
+    bool built;
+    geometry::Intersection intersection;
+  };
+  std::optional<TracedRay> lastTrace;
+  // Incremented when the mesh or the point cloud is replaced, or builds for them finish.
+  uint64_t geometryRevision = 0;
+
+  // Acceleration structures being built in the background.
+  struct GeometryBuild {
+    std::atomic<bool> finished = false;
+    // Set before finished, if the build threw.
+    std::string error;
+    // Run on the main thread once the build succeeded.
+    std::function<void()> done;
+    std::jthread thread;
+  };
+  /*
+   * Builds for point clouds that have been replaced since are left to finish
+   * on their own, so that replacing a cloud never waits for one.
+   */
+  std::vector<std::unique_ptr<GeometryBuild>> geometryBuilds;
+
+  void startBuild(std::function<void()> build, std::function<void()> done = {});
+
+  // Annotations.
+  model::AnnotationStore<Keypoint> keypoints;
+  model::AnnotationStore<BBox> boundingBoxes;
+  model::AnnotationStore<Rectangle> rectangles;
+  bool recordingEdits = false;
+  std::vector<AnnotationEdit> edits;
+
+  void record(AnnotationEdit edit);
 
 public:
   int activeKeypoint = -1;
@@ -72,17 +156,36 @@ public:
   active_view::ActiveView activeView = active_view::MeshView;
   ActiveTool activeToolId = AddKeypointToolId;
 
-  // Annotations.
-  std::vector<Keypoint> keypoints;
-  std::vector<BBox> boundingBoxes;
-  std::vector<Rectangle> rectangles;
-
   SceneModel(std::optional<std::string> meshPath = std::nullopt); // Could be aligned with how point clouds are handled i.e. set the path and load the mesh after initialization, needs small refactoring in mesh_view
 
-  void setPointCloud(std::shared_ptr<geometry::PointCloud> pc);
+  /*
+   * Without a ray tracer, one is created and its acceleration structures are
+   * built on a background thread. Picking falls back to brute force meanwhile.
+   * Without an octree, one is built on a background thread as well, and
+   * getPointCloudOctree returns nullptr until updateGeometryBuilds picks it up.
+   */
+  void setPointCloud(std::shared_ptr<geometry::PointCloud> pc, std::shared_ptr<geometry::RayTraceCloud> rayTraceCloud = nullptr,
+                     std::shared_ptr<const geometry::PointCloudOctree> octree = nullptr);
+  /*
+   * Loads the point cloud, its acceleration structures come from the
+   * sidecar cache next to it when up to date.
+   */
+  void loadPointCloud(const fs::path& path);
 
   std::shared_ptr<geometry::TriangleMesh> getMesh();
   std::shared_ptr<geometry::PointCloud> getPointCloud();
+  std::shared_ptr<const geometry::PointCloudOctree> getPointCloudOctree() const { return pointCloudOctree; }
+  /*
+   * Called from the main thread. Hands over what builds that finished since
+   * the last call produced, prints why they failed otherwise, and returns
+   * whether any finished. Rays traced before then are traced again.
+   */
+  bool updateGeometryBuilds();
+  bool buildingGeometry() const { return !geometryBuilds.empty(); }
+  /*
+   * Traces against the mesh or the point cloud, whichever is shown. Tracing
+   * the same ray again returns the previous result.
+   */
   std::optional<Vector3f> traceRay(const Vector3f& origin, const Vector3f& direction);
   geometry::Intersection traceRayIntersection(const Vector3f& origin, const Vector3f& direction);
 
@@ -90,8 +193,47 @@ public:
    * Called when changing the scene.
    */
   void reset();
+  /*
+   * Incremented whenever an annotation is added, removed or changed, so
+   * that views can tell when what they uploaded is out of date.
+   */
+  uint64_t getAnnotationRevision() const { return annotationRevision; }
+  /*
+   * The rectangle under the cursor, which shows its rotate control, -1 for
+   * none. Changing it is not a change to the annotations.
+   */
+  int getHoveredRectangle() const { return hoveredRectangle; }
+  void setHoveredRectangle(int id);
+  /*
+   * Changes whenever the annotations or how they are drawn do, e.g. the
+   * hovered rectangle.
+   */
+  uint64_t getDisplayRevision() const { return annotationRevision + hoverRevision; }
+  /*
+   * Ids are unique per annotation type within a scene and never reused.
+   * Added annotations keep their id unless they have none yet (id <= 0) or it
+   * is already taken, in which case they are given a new one.
+   */
+  AnnotationIds getNextIds() const;
+  void setNextIds(const AnnotationIds& ids);
+  /*
+   * Cheap, the annotations are only copied when the scene changes while the
+   * snapshot is still around.
+   */
+  AnnotationSnapshot snapshot() const;
+  /*
+   * Once enabled, changes to annotations through the methods below are
+   * recorded until they are taken. Loading and resetting are not recorded.
+   */
+  void recordEdits(bool enabled) { recordingEdits = enabled; }
+  std::vector<AnnotationEdit> takeEdits();
+  /*
+   * Applies an edit read back from the journal, without recording it.
+   * Setting an annotation adds it if there is none with its id.
+   */
+  void applyEdit(const AnnotationEdit& edit);
   // Keypoints
-  const std::vector<Keypoint>& getKeypoints() const { return keypoints; };
+  const std::vector<Keypoint>& getKeypoints() const { return keypoints.all(); };
   Keypoint addKeypoint(const Vector3f& kp);
   Keypoint addKeypoint(const Keypoint& kp);
   void removeKeypoint(const Keypoint& keypoint);
@@ -105,17 +247,22 @@ public:
   void addBoundingBox(BBox& bbox);
   void removeBoundingBox(int id);
   void updateBoundingBox(const BBox& bbox);
-  const std::vector<BBox>& getBoundingBoxes() const { return boundingBoxes; };
+  const std::vector<BBox>& getBoundingBoxes() const { return boundingBoxes.all(); };
 
   // Rectangle.
-  std::vector<Rectangle>& getRectangles() { return rectangles; };
-  const std::vector<Rectangle>& getRectangles() const { return rectangles; };
+  const std::vector<Rectangle>& getRectangles() const { return rectangles.all(); };
+  // For rectangles that need an id before they are added.
+  int newRectangleId() { return rectangles.nextId(); }
   void addRectangle(Rectangle& rectangle);
   void removeRectangle(int id);
   void updateRectangle(const Rectangle& rectangle);
 
   void save(fs::path annotationPath) const;
-  void load(fs::path annotationPath);
+  /*
+   * Adds all annotations in the file to the scene directly, without
+   * creating a command for each of them. Returns whether the file was read.
+   */
+  bool load(fs::path annotationPath);
 
   void loadMesh();
 };
@@ -3,6 +3,7 @@
 #include "glfw_app.h"
 #include "scene_model.h"
 #include <memory>
+#include <optional>
 #include <filesystem>
 #include <fstream>
 #include <bgfx/bgfx.h>
@@ -11,6 +12,7 @@
 #include "commands/bounding_box.h"
 #include "commands/rectangle.h"
 #include "utils/serialize.h"
+#include "utils/frame_latency.h"
 #include "timeline.h"
 
 using namespace commands;
@@ -19,8 +21,22 @@ class Studio : public GLFWApp {
 public:
   ViewController viewController;
   InputModifier inputModifier = ModNone;
+  utils::FrameLatency frameLatency;
 
-  Studio(const std::string& folder) : GLFWApp("Stray 3D Annotation Tool", 1200, 800), viewController(folder) {
+private:
+  struct MouseMove {
+    double x;
+    double y;
+    // Of the first move since the last one handled.
+    utils::FrameLatency::Clock::time_point time;
+  };
+  std::optional<MouseMove> pendingMouseMove;
+
+public:
+
+  template <typename... Args>
+  Studio(const std::string& folder, Args&&... args) : GLFWApp("Stray 3D Annotation Tool", 1200, 800),
+                                                      viewController(folder, std::forward<Args>(args)...) {
     glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
       double x, y;
       glfwGetCursorPos(window, &x, &y);
@@ -34,7 +50,7 @@ public:
 
     glfwSetCursorPosCallback(window, [](GLFWwindow* window, double xpos, double ypos) {
       Studio* w = (Studio*)glfwGetWindowUserPointer(window);
-      w->mouseMoved(xpos, ypos);
+      w->queueMouseMove(xpos, ypos);
     });
 
     glfwSetScrollCallback(window, [](GLFWwindow* window, double xoffset, double yoffset) {
@@ -45,19 +61,27 @@ public:
       Studio* w = (Studio*)glfwGetWindowUserPointer(window);
       w->resize(width, height);
     });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow* window) {
+      Studio* w = (Studio*)glfwGetWindowUserPointer(window);
+      w->viewController.setNeedsDisplay();
+    });
 
     glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
       Studio* w = (Studio*)glfwGetWindowUserPointer(window);
+      w->flushMouseMove();
       w->setInputModifier(key);
       if (action == GLFW_PRESS) {
         if ((CommandModifier == mods) && (GLFW_KEY_S == key)) {
           w->viewController.save();
         } else if ((CommandModifier == mods) && (GLFW_KEY_Z == key)) {
           w->undo();
+        } else if (((CommandModifier | ShiftModifier) == mods) && (GLFW_KEY_Z == key)) {
+          w->redo();
         } else {
           char characterPressed = key;
           w->viewController.keypress(characterPressed, w->inputModifier);
         }
+        w->inputReceived();
       }
     });
 
@@ -67,7 +91,9 @@ public:
   }
 
   void leftButtonDown(double x, double y) {
+    flushMouseMove();
     viewController.leftButtonDown(x, y, inputModifier);
+    inputReceived();
   }
   void setInputModifier(int key) {
     if (key == GLFW_KEY_LEFT_CONTROL || key == GLFW_KEY_LEFT_SUPER) {
@@ -84,25 +110,63 @@ public:
     }
   }
   void leftButtonUp(double x, double y) {
+    flushMouseMove();
     viewController.leftButtonUp(x, y, inputModifier);
+    inputReceived();
+  }
+  /*
+   * Mouse moves are coalesced, only the latest cursor position before a
+   * frame or another event is handled, which traces one ray.
+   */
+  void queueMouseMove(double x, double y) {
+    if (!pendingMouseMove.has_value()) {
+      pendingMouseMove = {x, y, utils::FrameLatency::Clock::now()};
+    } else {
+      pendingMouseMove->x = x;
+      pendingMouseMove->y = y;
+    }
   }
-  void mouseMoved(double x, double y) {
-    viewController.mouseMoved(x, y, inputModifier);
+  void flushMouseMove() {
+    if (!pendingMouseMove.has_value()) return;
+    MouseMove move = pendingMouseMove.value();
+    pendingMouseMove.reset();
+    viewController.mouseMoved(move.x, move.y, inputModifier);
+    inputReceived(move.time);
   }
   void scroll(double xoffset, double yoffset) {
+    flushMouseMove();
     viewController.scroll(xoffset, yoffset, inputModifier);
+    inputReceived();
+  }
+  void inputReceived(utils::FrameLatency::Clock::time_point time = utils::FrameLatency::Clock::now()) {
+    // Input that changes nothing on screen does not wait for a frame.
+    if (viewController.needsDisplay()) frameLatency.eventReceived(time);
   }
   void resize(int newWidth, int newHeight) {
     GLFWApp::resize(newWidth, newHeight);
     views::Rect rect = {0.0f, 0.0f, float(newWidth), float(newHeight)};
     viewController.resize(rect);
   }
-  bool update() const {
-    viewController.render();
-
-    bgfx::frame();
+  bool update() override {
+    flushMouseMove();
+    viewController.updateBackgroundWork();
+    if (viewController.needsDisplay()) {
+      viewController.render();
+      bgfx::frame();
+      frameLatency.frameRendered();
+    }
 
-    glfwWaitEventsTimeout(0.16);
+    // Sleeps until there is input or background work finished, see
+    // utils::main_loop, unless the next frame is already due, e.g. while the
+    // point cloud is still being uploaded.
+    if (viewController.needsDisplay()) {
+      glfwPollEvents();
+    } else {
+      frameLatency.idleWait();
+      glfwWaitEvents();
+    }
+    // Right after handling input, so that nothing is lost when the window closes.
+    viewController.updateAutosave();
 
     return !glfwWindowShouldClose(window);
   }
@@ -110,4 +174,8 @@ public:
   void undo() {
     viewController.undo();
   }
+
+  void redo() {
+    viewController.redo();
+  }
 };
@@ -1,6 +1,107 @@
+#pragma once
+#include <array>
+#include <memory>
 #include <string>
 #include <bgfx/bgfx.h>
 
+namespace bimg {
+struct ImageContainer;
+}
+
 namespace texture_utils {
+
+// An image decoded into RGBA8, which bgfx can upload as is.
+struct Image {
+  bimg::ImageContainer* container;
+  Image(bimg::ImageContainer* container) : container(container) {}
+  Image(const Image&) = delete;
+  Image& operator=(const Image&) = delete;
+  ~Image();
+};
+using ImagePtr = std::shared_ptr<const Image>;
+
+/*
+ * Reads and decodes an image file into RGBA8, whatever the format of the file,
+ * so that images from JPEG and PNG files can share textures. Does not touch
+ * bgfx, so it can be called from any thread. Returns nullptr and prints why if
+ * the file could not be read.
+ */
+ImagePtr decodeImage(const std::string& filePath);
+/*
+ * The image in RGBA8, shrunk by a whole factor in each direction by
+ * averaging blocks of factor by factor pixels. Pixels left over at the right
+ * and bottom edges are dropped. Does not touch bgfx either.
+ */
+ImagePtr shrinkImage(const Image& image, int factor);
+/*
+ * The RGBA8 image compressed to BC1, at an eighth of the size. Alpha is
+ * dropped. Good enough for previews and uploaded as is, but not every GPU
+ * can sample it, see bgfx::getCaps.
+ */
+ImagePtr compressImage(const Image& image);
+// An image with a copy of the pixels, as many bytes as the format takes for the size.
+ImagePtr copyImage(uint16_t width, uint16_t height, const uint8_t* pixels,
+                   bgfx::TextureFormat::Enum format = bgfx::TextureFormat::RGBA8);
+/*
+ * Uploads a decoded image, on the thread bgfx is used from. The image is
+ * kept alive until bgfx is done with it.
+ */
+bgfx::TextureHandle createTexture(ImagePtr image);
+// Returns an invalid handle if the file could not be read.
 bgfx::TextureHandle loadTexture(const std::string& filePath);
+
+class StreamingTexture {
+  /*
+   * For showing a stream of images, e.g. the frames of a dataset. Images are
+   * uploaded into textures that are kept around, taking turns between a few
+   * of them so that an upload never has to wait for the GPU to be done with
+   * the texture being shown.
+   *
+   * Textures are kept for the two sizes used last, so that going back and
+   * forth between thumbnails and full images does not create any. Textures
+   * are only created again when a third size or another format comes along.
+   *
+   * Images need to have a single mip and layer, as decoded from JPEG or PNG.
+   */
+public:
+  static const size_t RingSize = 2;
+  static const size_t Sizes = 2;
+
+private:
+  struct Ring {
+    std::array<bgfx::TextureHandle, RingSize> textures;
+    size_t current = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    bgfx::TextureFormat::Enum format = bgfx::TextureFormat::Count;
+    // When the ring was last asked for, to know which one to replace.
+    uint64_t used = 0;
+  };
+  std::array<Ring, Sizes> rings;
+  // The ring with the texture being shown.
+  size_t shown = 0;
+  // Whether the texture being shown holds an image, the others might not yet.
+  bool hasImage = false;
+  uint64_t uses = 0;
+  size_t allocations = 0;
+
+  // The ring for images of this size and format, creating its textures if there is none yet.
+  Ring& ringFor(uint16_t width, uint16_t height, bgfx::TextureFormat::Enum format);
+  void release(Ring& ring);
+
+public:
+  StreamingTexture();
+  StreamingTexture(const StreamingTexture&) = delete;
+  StreamingTexture& operator=(const StreamingTexture&) = delete;
+  ~StreamingTexture();
+
+  // Creates the textures up front, for images of this size as returned by decodeImage.
+  void reserve(uint16_t width, uint16_t height);
+  // Shows the image from now on, nothing if it is nullptr.
+  void update(ImagePtr image);
+  // Invalid while there is no image to show.
+  bgfx::TextureHandle handle() const;
+  // Textures created so far, stays the same while images keep to two sizes.
+  size_t allocationCount() const { return allocations; }
+};
 }
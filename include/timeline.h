@@ -1,5 +1,6 @@
 #pragma once
-#include <list>
+#include <deque>
+#include <chrono>
 #include <memory>
 #include "commands/command.h"
 #include <iostream>
@@ -9,23 +10,57 @@
 #include "commands/keypoints.h"
 #include "commands/bounding_box.h"
 #include "commands/rectangle.h"
+#include "commands/load_annotations.h"
 
 using CommandPtr = std::unique_ptr<commands::Command>;
-using CommandStack = std::list<std::unique_ptr<commands::Command>>;
+using CommandStack = std::deque<std::unique_ptr<commands::Command>>;
 
 using namespace commands;
 
 namespace fs = std::filesystem;
+
+struct TimelineOptions {
+  // The oldest commands are forgotten when there are more than this many, undone ones included.
+  size_t maxCommands = 10000;
+  // Or when they take more memory than this.
+  size_t maxBytes = 16 * 1024 * 1024;
+  // Consecutive drags of the same annotation closer together than this are undone as one.
+  std::chrono::milliseconds mergeWindow = std::chrono::milliseconds(1000);
+};
+
 class Timeline {
+  /*
+   * The history of commands for undo and redo. Pushing a command forgets
+   * the undone ones.
+   */
+public:
+  using Clock = std::chrono::steady_clock;
+
 private:
   SceneModel& sceneModel;
+  TimelineOptions options;
   CommandStack commandStack;
+  CommandStack redoStack;
+  size_t bytes = 0;
+  Clock::time_point lastPush;
+
+  void forget(CommandStack& stack);
+  void limitHistory();
 
 public:
-  Timeline(SceneModel& model);
+  Timeline(SceneModel& model, TimelineOptions options = {});
   Timeline(Timeline const& other) = delete;
-  void load(fs::path annotationPath);
+  /*
+   * Clears the history and loads the annotations as a single checkpoint.
+   * Returns false if the file exists but could not be read.
+   */
+  bool load(fs::path annotationPath);
   void pushCommand(CommandPtr command);
   void undoCommand();
+  void redoCommand();
+  // Commands that can be undone and redone.
   int size() const;
+  int redoSize() const;
+  // Taken by the commands in the history.
+  size_t memoryUsage() const { return bytes; }
 };
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include "scene_model.h"
+
+namespace utils::annotation_file {
+
+struct Annotations {
+  std::vector<Keypoint> keypoints;
+  std::vector<BBox> boundingBoxes;
+  std::vector<Rectangle> rectangles;
+  std::optional<AnnotationIds> nextIds;
+};
+
+/*
+ * Writes the annotations straight to the file as they are formatted,
+ * without building a JSON document first. The output is byte for byte what
+ * nlohmann::json::dump(4) gives for the same annotations.
+ *
+ * The annotations are written to a temporary file next to it, which then
+ * replaces the file, so that a crash while saving never leaves a partially
+ * written file behind. Returns false and prints why if writing failed, the
+ * previous file is then left as it was.
+ */
+bool write(const std::filesystem::path& path, const std::vector<Keypoint>& keypoints,
+           const std::vector<BBox>& boundingBoxes, const std::vector<Rectangle>& rectangles,
+           const AnnotationIds& nextIds);
+
+/*
+ * Parses the file as a stream of SAX events into the annotations, without
+ * building a JSON document first. Annotations without an id get id -1.
+ * Returns false and prints why if the file is not valid JSON.
+ */
+bool read(const std::filesystem::path& path, Annotations& annotations);
+
+} // namespace utils::annotation_file
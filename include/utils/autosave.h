@@ -0,0 +1,146 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <optional>
+#include <functional>
+#include <vector>
+#include <ostream>
+#include <filesystem>
+#include <condition_variable>
+#include "scene_model.h"
+
+namespace utils {
+
+struct AutosaveOptions {
+  // Saves once the annotations have not changed for this long.
+  std::chrono::milliseconds delay = std::chrono::milliseconds(5000);
+  // Saves at the latest this long after the first unsaved change, even if edits keep coming.
+  std::chrono::milliseconds maxDelay = std::chrono::milliseconds(60000);
+  /*
+   * Where the delays are measured with, the steady clock if not set. The
+   * worker does not wake up on its own with a clock of its own, tests call
+   * Autosave::clockChanged after moving it on.
+   */
+  std::function<std::chrono::steady_clock::time_point()> now = nullptr;
+};
+
+class Autosave {
+  /*
+   * Saves annotations on a background thread, once a burst of edits is over.
+   * The UI thread only takes a snapshot of the annotations, which shares
+   * them with the scene until it changes again, so saving never holds up a
+   * frame. Files are replaced atomically, see utils::annotation_file::write.
+   *
+   * Edits recorded by the scene are appended to the journal next to the file
+   * as soon as they are made, see utils::journal. Saving the whole file then
+   * only compacts the journal, which is why it can wait longer.
+   */
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  struct Job {
+    AnnotationSnapshot snapshot;
+    std::filesystem::path path;
+  };
+  struct Timing {
+    size_t count = 0;
+    double total = 0.0;
+    double worst = 0.0;
+    void add(double ms);
+    double mean() const { return count == 0 ? 0.0 : total / double(count); }
+  };
+
+  AutosaveOptions options;
+  // Revision of the annotations last saved or scheduled, only used on the UI thread.
+  std::optional<uint64_t> scheduledRevision;
+  // Left alone by restore, as it could not be read. Only used on the UI thread.
+  std::filesystem::path keptPath;
+  Timing snapshotTiming;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::optional<Job> pending;
+  // Whether the worker is writing a job it took.
+  bool writing = false;
+  std::condition_variable writeDone;
+  Clock::time_point firstChange;
+  Clock::time_point lastChange;
+  Timing writeTiming;
+  size_t failedWrites = 0;
+  // Edits not appended to the journal of journalTarget yet.
+  std::vector<AnnotationEdit> unjournaled;
+  std::filesystem::path journalTarget;
+  Timing journalTiming;
+  bool stopping = false;
+  // Held while writing, so that saves never write the same file at once.
+  std::mutex writeMutex;
+  // What was written last. A save that lost the race for writeMutex to a newer one is dropped.
+  std::filesystem::path lastWrittenPath;
+  uint64_t lastWrittenRevision = 0;
+  // The edits in the journal of journaledPath, guarded by writeMutex.
+  std::vector<AnnotationEdit> journaled;
+  std::filesystem::path journaledPath;
+  std::thread worker;
+
+public:
+  Autosave(AutosaveOptions options = {});
+  Autosave(const Autosave&) = delete;
+  Autosave& operator=(const Autosave&) = delete;
+  // Writes what is still pending before returning.
+  ~Autosave();
+
+  /*
+   * Called on the UI thread whenever the annotations may have changed, does
+   * nothing unless they did since they were last saved.
+   */
+  void update(SceneModel& scene, const std::filesystem::path& path);
+  /*
+   * Saves right away on the calling thread, e.g. when asked to by the user.
+   * Returns whether the file was written.
+   */
+  bool save(SceneModel& scene, const std::filesystem::path& path);
+  /*
+   * The annotations in the scene are what is on disk, e.g. right after
+   * loading them. Drops any save that is pending.
+   */
+  void markSaved(SceneModel& scene);
+  /*
+   * Called right after loading the annotations from the file, with whether
+   * it was read or did not exist, see Timeline::load. Edits left in its
+   * journal, e.g. by a crash, are applied to the scene and saved to the file
+   * right away. Edits to the scene are journaled from then on. Returns how
+   * many edits were recovered.
+   *
+   * If the file could not be read, the scene does not hold what is in it
+   * and the journal cannot be applied to it. Both are then left as they are
+   * and not saved to until the next restore, so that nothing is lost before
+   * the file has been fixed.
+   */
+  size_t restore(SceneModel& scene, const std::filesystem::path& path, bool loaded);
+  // Writes a pending save right away, e.g. before switching to another file.
+  void flush();
+  /*
+   * For tests with their own clock, see AutosaveOptions::now. Wakes the
+   * worker and returns once it has journaled all edits and written the save
+   * that is due, if any.
+   */
+  void clockChanged();
+
+  size_t saveCount();
+  // In milliseconds, time spent on the UI thread when annotations change.
+  double meanSnapshotTime() const { return snapshotTiming.mean(); }
+  double maxSnapshotTime() const { return snapshotTiming.worst; }
+  void print(std::ostream& out);
+
+private:
+  Clock::time_point now() const;
+  // When the pending save is written, called with mutex held.
+  Clock::time_point due() const;
+  bool write(const Job& job);
+  void appendToJournal(const std::filesystem::path& path, std::vector<AnnotationEdit> edits);
+  void run();
+};
+
+} // namespace utils
@@ -11,7 +11,22 @@ namespace utils::dataset {
 
 fs::path getAnnotationPathForPointCloudPath(const fs::path& path);
 std::vector<fs::path> getDatasetImagePaths(fs::path path);
-std::vector<Eigen::Matrix4f> getDatasetCameraTrajectory(fs::path path);
+/*
+ * Reads the camera to world transforms from a trajectory.log file. Returns
+ * none and prints why if the file can not be read.
+ *
+ * With cache set, the transforms are also written to a binary sidecar next
+ * to the file, .trajectory.log.bin, which is mapped instead of parsing the
+ * file again as long as the size and modification time of the file match.
+ */
+std::vector<Eigen::Matrix4f> getDatasetCameraTrajectory(fs::path path, bool cache = true);
+/*
+ * Parses the contents of a trajectory.log file, chunks of it in parallel.
+ * Each transform is a line with three ids followed by four rows of four
+ * numbers. Blank lines are skipped, lines may end in \n or \r\n. A
+ * transform cut short at the end is dropped.
+ */
+std::vector<Eigen::Matrix4f> parseCameraTrajectory(const char* data, size_t size);
 DatasetMetadata getDatasetMetadata(fs::path path);
 std::vector<fs::path> getDatasetPointCloudPaths(fs::path path);
 
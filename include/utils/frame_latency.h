@@ -0,0 +1,41 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <ostream>
+
+namespace utils {
+
+class FrameLatency {
+  /*
+   * Counts rendered frames and measures input latency, the time from the
+   * first input event that needs a new frame to the end of that frame.
+   */
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  std::optional<Clock::time_point> pendingEvent;
+  size_t frames = 0;
+  size_t idleWaits = 0;
+  size_t latencyCount = 0;
+  double totalLatency = 0.0;
+  double worstLatency = 0.0;
+
+public:
+  /*
+   * Only the first event before a frame counts, later ones are shown by the
+   * same frame.
+   */
+  void eventReceived(Clock::time_point time = Clock::now());
+  void frameRendered(Clock::time_point time = Clock::now());
+  void idleWait() { idleWaits++; }
+
+  size_t frameCount() const { return frames; }
+  size_t idleWaitCount() const { return idleWaits; }
+  // In milliseconds.
+  double meanLatency() const;
+  double maxLatency() const { return worstLatency; }
+  void print(std::ostream& out) const;
+};
+
+} // namespace utils
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <filesystem>
+#include "scene_model.h"
+
+namespace utils::journal {
+
+/*
+ * The journal holds the edits made since the annotation file next to it was
+ * last written, so that saving an edit only costs appending a few bytes.
+ * Each record is prefixed with its size and a checksum, a record cut short
+ * by a crash is detected when reading and ends the journal.
+ */
+
+// annotations.json has its journal in annotations.json.journal.
+std::filesystem::path pathFor(const std::filesystem::path& annotationPath);
+
+/*
+ * Appends the edits to the journal, creating it if needed, and syncs it to
+ * disk. Returns false and prints why if writing failed.
+ */
+bool append(const std::filesystem::path& path, const std::vector<AnnotationEdit>& edits);
+
+/*
+ * Replaces the journal with only the given edits, atomically like
+ * utils::annotation_file::write. Without any edits, the journal is removed.
+ */
+bool rewrite(const std::filesystem::path& path, const std::vector<AnnotationEdit>& edits);
+
+/*
+ * The edits in the journal in the order they were made, up to the first
+ * incomplete or corrupt record. Their revisions count up from 1.
+ */
+std::vector<AnnotationEdit> read(const std::filesystem::path& path);
+
+} // namespace utils::journal
@@ -0,0 +1,13 @@
+#pragma once
+#include <functional>
+
+namespace utils::main_loop {
+/*
+ * The main loop sleeps while there is nothing new to draw. Work finishing on
+ * a background thread calls wake, so that the loop picks up the result right
+ * away instead of with the next input event. The app sets how the loop is
+ * woken, without it wake does nothing. Both can be called from any thread.
+ */
+void setWake(std::function<void()> wake);
+void wake();
+} // namespace utils::main_loop
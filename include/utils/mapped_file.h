@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace utils {
+
+class MappedFile {
+  /*
+   * Read-only memory mapping of a whole file.
+   * The mapping is released when the object goes out of scope, so pointers
+   * into data() must not outlive it.
+   */
+private:
+  const uint8_t* mapping = nullptr;
+  size_t mappedSize = 0;
+
+public:
+  MappedFile(const std::filesystem::path& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  const uint8_t* data() const { return mapping; }
+  size_t size() const { return mappedSize; }
+};
+
+} // namespace utils
@@ -11,10 +11,13 @@ Eigen::Vector2f toVector2(const nlohmann::json& json);
 
 Eigen::Quaternionf toQuaternion(const nlohmann::json& json);
 
+AnnotationIds toAnnotationIds(const nlohmann::json& json);
+
 nlohmann::json serialize(const Eigen::Vector3f& v);
 nlohmann::json serialize(const Eigen::Vector2f& v);
 nlohmann::json serialize(const Keypoint& keypoint);
 nlohmann::json serialize(const BBox& bbox);
 nlohmann::json serialize(const Rectangle& rectangle);
+nlohmann::json serialize(const AnnotationIds& ids);
 
 } // namespace utils::serialize
@@ -18,5 +18,8 @@ public:
   InputModifier modifiers = 0;
 
   Vector3f rayWorld() const;
+  // The point under the cursor and the surface normal there, traced once per
+  // cursor position by the view controller and shared by all views.
   std::optional<Vector3f> pointingAt;
+  Vector3f pointingAtNormal = Vector3f::UnitZ();
 };
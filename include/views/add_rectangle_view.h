@@ -24,6 +24,8 @@ private:
   views::PointView pointView;
   views::RectangleView rectangleView;
   std::array<Vector3f, 4> vertices;
+  // Incremented when the vertices change.
+  uint64_t revision = 0;
 public:
   AddRectangleView(SceneModel& model, Timeline& timeline, int viewId = 0);
   bool leftButtonUp(const ViewContext3D& viewContext) override;
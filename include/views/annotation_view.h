@@ -1,7 +1,7 @@
 #pragma once
 #include "views/view.h"
 #include "views/bbox.h"
-#include "views/mesh_view.h"
+#include "views/keypoint_view.h"
 #include "views/rectangle_view.h"
 #include "scene_model.h"
 
@@ -10,13 +10,13 @@ namespace views {
 class AnnotationView : public views::View3D {
 private:
   const SceneModel& sceneModel;
-  views::MeshDrawable sphereDrawable;
+  KeypointView keypointView;
   BBoxView bboxView;
   RectangleView rectangleView;
 
-  Vector4f lightDir = Vector4f(0.0, 1.0, -1.0, 1.0);
 public:
   AnnotationView(const SceneModel& model, int viewId = -1);
   void render(const ViewContext3D& context) const;
+  const KeypointView& getKeypointView() const { return keypointView; }
 };
 } // namespace views
@@ -1,22 +1,31 @@
 #pragma once
+#include <span>
 #include <bgfx/bgfx.h>
 #include "views/view.h"
+#include "views/instance_buffer.h"
 #include "scene_model.h"
 
 namespace views {
 
 class BBoxView : public views::View3D {
+  /*
+   * Draws the edges of all bounding boxes with one instanced draw call.
+   */
 private:
   bgfx::VertexBufferHandle vertexBuffer;
   bgfx::IndexBufferHandle indexBuffer;
   bgfx::VertexLayout layout;
   bgfx::ProgramHandle program;
-  bgfx::UniformHandle u_scale, u_color;
+  // Orientation, position, dimensions and class color of each box.
+  mutable InstanceBuffer instances;
 
 public:
   BBoxView(int viewId = 0);
   ~BBoxView();
-  void render(const BBox& bbox) const;
+  /*
+   * The boxes are only uploaded again when the revision changes.
+   */
+  void render(std::span<const BBox> bboxes, uint64_t revision) const;
 };
 
 } // namespace views
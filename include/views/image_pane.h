@@ -1,20 +1,27 @@
 #pragma once
 #include <bgfx/bgfx.h>
 #include "views/view.h"
+#include "texture_utils.h"
 
 namespace views {
 
 class ImagePane : public View {
-  bgfx::TextureHandle texture;
+  texture_utils::StreamingTexture texture;
   bgfx::VertexBufferHandle vertexBuffer;
   bgfx::IndexBufferHandle indexBuffer;
   bgfx::ProgramHandle program;
   bgfx::UniformHandle textureColor;
 
 public:
+  // Shows nothing until an image is set.
+  ImagePane(int viewId = 0);
+  // For images of this size, e.g. the frames of a dataset as given by its intrinsics.
+  ImagePane(int viewId, uint16_t width, uint16_t height);
   ImagePane(const std::string& path, int viewId = 0);
   ~ImagePane();
   void setImage(const std::string& path);
+  // For images decoded ahead of time, e.g. by model::FramePrefetcher.
+  void setImage(texture_utils::ImagePtr image);
   void render() const;
 };
 } // namespace views
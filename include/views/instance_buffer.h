@@ -0,0 +1,50 @@
+#pragma once
+#include <optional>
+#include <bgfx/bgfx.h>
+
+namespace views {
+class InstanceBuffer {
+  /*
+   * Per-instance data kept on the GPU between frames, for things that change
+   * far less often than they are drawn. Each instance is a number of vec4s,
+   * bound to i_data0, i_data1, ... in the vertex shader. The data is only
+   * packed and uploaded again when the revision passed to update changes.
+   */
+private:
+  bgfx::VertexLayout layout;
+  bgfx::DynamicVertexBufferHandle handle = BGFX_INVALID_HANDLE;
+  uint32_t capacity = 0;
+  uint32_t count = 0;
+  std::optional<uint64_t> revision;
+
+public:
+  InstanceBuffer(int vectorsPerInstance);
+  ~InstanceBuffer();
+  InstanceBuffer(const InstanceBuffer&) = delete;
+  InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+  /*
+   * Calls pack(i, data) with room for the vectors of instance i, unless the
+   * instances were already uploaded at this revision.
+   */
+  template <typename Pack>
+  void update(uint64_t newRevision, uint32_t instanceCount, Pack pack) {
+    if (revision == newRevision) return;
+    revision = newRevision;
+    count = instanceCount;
+    if (instanceCount == 0) return;
+    const uint16_t floats = layout.getStride() / sizeof(float);
+    const bgfx::Memory* memory = allocate(instanceCount);
+    float* data = reinterpret_cast<float*>(memory->data);
+    for (uint32_t i = 0; i < instanceCount; i++) {
+      pack(i, data + i * floats);
+    }
+    bgfx::update(handle, 0, memory);
+  }
+  uint32_t size() const { return count; }
+  void setInstances() const;
+
+private:
+  const bgfx::Memory* allocate(uint32_t instanceCount);
+};
+} // namespace views
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <bgfx/bgfx.h>
+#include "views/view.h"
+#include "scene_model.h"
+
+namespace views {
+class KeypointView : public views::View3D {
+  /*
+   * Draws all keypoints as spheres colored by class with a single instanced
+   * draw call. Position, radius and color of each keypoint are packed into a
+   * transient instance data buffer every frame.
+   */
+private:
+  bgfx::VertexBufferHandle vertexBuffer;
+  bgfx::IndexBufferHandle indexBuffer;
+  bgfx::VertexLayout layout;
+  bgfx::ProgramHandle program;
+  bgfx::UniformHandle u_lightDir;
+  Vector4f lightDir = Vector4f(0.0, 1.0, -1.0, 1.0);
+  mutable uint32_t lastDrawCalls = 0;
+
+public:
+  KeypointView(int viewId);
+  ~KeypointView();
+  void render(const ViewContext3D& context, const std::vector<Keypoint>& keypoints) const;
+  uint32_t getLastDrawCalls() const { return lastDrawCalls; }
+};
+} // namespace views
@@ -1,10 +1,33 @@
 #pragma once
+#include <span>
+#include <vector>
+#include <unordered_map>
 #include <bgfx/bgfx.h>
 #include "scene_model.h"
 #include "views/view.h"
+#include "geometry/point_cloud_octree.h"
 
 namespace views {
 class PointCloudView : public views::View3D {
+  /*
+   * Draws the point cloud at a level of detail picked from its octree every
+   * frame, within a point budget. Vertex buffers are created per octree node
+   * the first time it is picked, up to a number of points per frame, and the
+   * least recently drawn ones are released when too many points are on the
+   * GPU. Until a node has been uploaded, its ancestors stand in for it.
+   *
+   * While the octree is still being built, every few points of the cloud are
+   * drawn instead, within the same budgets.
+   */
+public:
+  struct FrameStats {
+    size_t nodes = 0;
+    size_t points = 0;
+    size_t uploadedPoints = 0;
+    // Picked, but left for later frames because of the upload budget.
+    size_t deferredNodes = 0;
+  };
+
 private:
   struct VertexData {
     float x;
@@ -12,26 +35,61 @@ private:
     float z;
     uint32_t rgba;
   };
+  // Normalized positions, the model transform maps them back onto the cloud.
+  struct QuantizedVertexData {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    int16_t padding;
+    uint32_t rgba;
+  };
+  struct NodeBuffer {
+    bgfx::VertexBufferHandle handle;
+    uint32_t count;
+    uint64_t lastDrawn;
+  };
 
   SceneModel& scene;
-  std::vector<VertexData> vertexData;
-  std::vector<uint32_t> indices;
-  bgfx::VertexBufferHandle vertexBuffer;
-  bgfx::IndexBufferHandle indexBuffer;
+  std::shared_ptr<geometry::PointCloud> pointCloud;
+  std::shared_ptr<const geometry::PointCloudOctree> octree;
   bgfx::VertexLayout layout;
-  bgfx::ProgramHandle program;
+  bgfx::VertexLayout quantizedLayout;
+  Matrix4f modelTransform = Matrix4f::Identity();
+  bgfx::ProgramHandle program = BGFX_INVALID_HANDLE;
   bgfx::UniformHandle u_activePoint;
   bool initialized = false;
+
+  // Streaming state, updated while rendering.
+  mutable std::unordered_map<uint32_t, NodeBuffer> residentNodes;
+  mutable size_t residentPoints = 0;
+  // Drawn while there is no octree, in order.
+  mutable std::vector<NodeBuffer> flatBuffers;
+  mutable uint64_t frame = 0;
+  mutable FrameStats lastFrame;
+
 public:
   PointCloudView(SceneModel& model, int viewId);
   ~PointCloudView();
   void loadPointCloud();
   void changeSize(float diff);
-  void packVertexData();
   void render(const ViewContext3D& context) const;
+  const FrameStats& getLastFrameStats() const { return lastFrame; }
   /*
    * Called when the point cloud has changed.
    */
   void reload();
+  /*
+   * Called when a build finished, switches to the octree of the point cloud
+   * once the scene has it.
+   */
+  void updateOctree();
+
+private:
+  NodeBuffer uploadPoints(std::span<const uint32_t> points) const;
+  NodeBuffer& uploadNode(uint32_t node) const;
+  // The buffers to draw without an octree, uploading more of them within the budget.
+  void selectFlat(std::vector<NodeBuffer*>& buffers) const;
+  void evictNodes() const;
+  void releaseNodes();
 };
 }
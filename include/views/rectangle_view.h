@@ -1,22 +1,31 @@
 #pragma once
-#include <vector>
+#include <span>
 #include <bgfx/bgfx.h>
 #include "views/view.h"
+#include "views/instance_buffer.h"
 #include "view_context_3d.h"
 #include "scene_model.h"
 
 namespace views {
 class RectangleView : views::View3D{
+  /*
+   * Draws all rectangles with one instanced draw call.
+   */
 private:
   bgfx::VertexBufferHandle vertexBuffer;
   bgfx::IndexBufferHandle indexBuffer;
   bgfx::VertexLayout vertexLayout;
   bgfx::ProgramHandle program;
-  bgfx::UniformHandle u_scale;
+  // Orientation, center and scale of each rectangle.
+  mutable InstanceBuffer instances;
 public:
   RectangleView(int id);
   ~RectangleView();
-  void setVertices(const std::array<Vector3f, 4>&);
-  void render(const ViewContext3D& context, const Rectangle& rectangle) const;
+  /*
+   * The rectangles are only uploaded again when the revision changes. The
+   * rotate control of the hovered one is shown.
+   */
+  void render(const ViewContext3D& context, std::span<const Rectangle> rectangles, uint64_t revision,
+              int hovered = -1) const;
 };
 }
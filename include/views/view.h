@@ -72,6 +72,7 @@ public:
   virtual bool mouseMoved(const ViewContext3D& viewContext) { return false; }
   virtual bool keypress(const char character, const InputModifier& mod) { return false; };
   void setCameraTransform(const ViewContext3D& context) const;
+  Matrix4f getProjection(const ViewContext3D& context) const;
 };
 
 } // namespace views
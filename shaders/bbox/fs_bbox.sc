@@ -1,9 +1,7 @@
-$input v_pos
+$input v_color0
 
 #include <bgfx_shader.sh>
 
-uniform vec4 u_color;
-
 void main() {
-  gl_FragColor = u_color;
+  gl_FragColor = v_color0;
 }
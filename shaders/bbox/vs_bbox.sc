@@ -1,12 +1,16 @@
-$input a_position
-$output v_pos
+$input a_position, i_data0, i_data1, i_data2, i_data3
+$output v_color0
 
 #include <bgfx_shader.sh>
 
-uniform vec4 u_scale;
+// Per box: i_data0 is the orientation quaternion (x, y, z, w), i_data1 the
+// position, i_data2 the dimensions and i_data3 the color.
+vec3 rotate(vec4 q, vec3 v) {
+  return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main() {
-  v_pos = a_position;
-  gl_Position = mul(u_modelViewProj, vec4(u_scale.x * a_position.x, u_scale.y * a_position.y, u_scale.z * a_position.z, 1.0));
+  vec3 position = rotate(i_data0, a_position * i_data2.xyz) + i_data1.xyz;
+  gl_Position = mul(u_viewProj, vec4(position, 1.0));
+  v_color0 = i_data3;
 }
-
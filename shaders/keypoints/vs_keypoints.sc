@@ -0,0 +1,12 @@
+$input a_position, a_normal, i_data0, i_data1
+$output v_normal, v_color0
+
+#include <bgfx_shader.sh>
+
+// i_data0 holds the center of the sphere and its radius, i_data1 its color.
+void main() {
+  vec3 position = a_position * i_data0.w + i_data0.xyz;
+  v_normal = mul(u_modelView, vec4(a_normal, 0.0)).xyz;
+  gl_Position = mul(u_modelViewProj, vec4(position, 1.0));
+  v_color0 = i_data1;
+}
@@ -5,8 +5,10 @@ $output v_color0
 uniform vec4 u_active_point;
 
 void main() {
-  gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0));
-  float distance = length(u_active_point.xyz - a_position.xyz);
+  // Quantized clouds come in normalized, the model transform maps them back.
+  vec3 position = mul(u_model[0], vec4(a_position, 1.0)).xyz;
+  gl_Position = mul(u_viewProj, vec4(position, 1.0));
+  float distance = length(u_active_point.xyz - position);
   if (distance < 0.005) {
     v_color0 = vec4(0.21, 0.87, 0.39, 1.0);
   } else {
@@ -1,4 +1,4 @@
-$input v_texcoord0
+$input v_texcoord0, v_scale
 
 #include "./bgfx_shader.sh"
 
@@ -8,20 +8,18 @@ const vec4 innerColor = vec4(0.4, 1.0, 0.5, 0.75);
 const vec4 outerColor = vec4(0.0, 0.8, 0.0, 0.75);
 const vec4 circleColor = vec4(0.8, 1.0, 0.8, 0.75);
 
-uniform vec4 u_scale;
-
 void main() {
-  vec2 scaledPos = v_texcoord0.xy * u_scale.xy;
-  float minScale = min(u_scale.x, u_scale.y);
-  float scaledBorderWidthX = borderWidth * u_scale.y / minScale;
-  float scaledBorderWidthY = borderWidth * u_scale.x / minScale;
+  vec2 scaledPos = v_texcoord0.xy * v_scale.xy;
+  float minScale = min(v_scale.x, v_scale.y);
+  float scaledBorderWidthX = borderWidth * v_scale.y / minScale;
+  float scaledBorderWidthY = borderWidth * v_scale.x / minScale;
   float borderWidthX = -1.0 + scaledBorderWidthX;
   float borderWidthY = -1.0 + scaledBorderWidthY;
   float maxValueX = (1.0 - scaledBorderWidthX);
   float maxValueY = (1.0 - scaledBorderWidthY);
   float norm = length(scaledPos.xy / minScale);
 
-  bool withCircle = u_scale.w > 0.0f;
+  bool withCircle = v_scale.w > 0.0f;
 
   if (withCircle && norm < 0.25) {
     gl_FragColor = circleColor;
@@ -1,3 +1,7 @@
 vec3 a_position : POSITION;
+vec4 i_data0 : TEXCOORD7;
+vec4 i_data1 : TEXCOORD6;
+vec4 i_data2 : TEXCOORD5;
 
 vec2 v_texcoord0 : TEXCOORD0;
+vec4 v_scale : TEXCOORD1;
@@ -1,13 +1,18 @@
-$input a_position
-$output v_texcoord0
+$input a_position, i_data0, i_data1, i_data2
+$output v_texcoord0, v_scale
 
 #include "./bgfx_shader.sh"
 
-uniform vec4 u_scale;
+// Per rectangle: i_data0 is the orientation quaternion (x, y, z, w), i_data1
+// the center and i_data2 the scale, with w > 0 when the rotate control shows.
+vec3 rotate(vec4 q, vec3 v) {
+  return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main() {
-  vec4 position = vec4(a_position.x * u_scale.x, a_position.y * u_scale.y, a_position.z, 1.0);
-  gl_Position = mul(u_modelViewProj, position);
+  vec3 local = vec3(a_position.x * i_data2.x, a_position.y * i_data2.y, a_position.z);
+  vec3 position = rotate(i_data0, local) + i_data1.xyz;
+  gl_Position = mul(u_viewProj, vec4(position, 1.0));
   v_texcoord0 = vec2(a_position.x, a_position.y);
+  v_scale = i_data2;
 }
-
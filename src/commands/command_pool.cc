@@ -0,0 +1,93 @@
+#include <new>
+#include <cstdint>
+#include "commands/command_pool.h"
+
+namespace commands {
+
+// Keeps what follows the header aligned like memory from operator new.
+struct alignas(alignof(std::max_align_t)) SlotHeader {
+  uint32_t size;
+  uint32_t sizeClass;
+};
+// Slots are multiples of this, commands larger than the largest class come from the heap.
+const size_t SlotGranularity = 64;
+const size_t SizeClasses = 8;
+const uint32_t HeapAllocated = SizeClasses;
+const size_t BlockSize = 64 * 1024;
+
+static size_t slotSize(size_t sizeClass) {
+  return (sizeClass + 1) * SlotGranularity;
+}
+
+static SlotHeader* headerOf(const void* pointer) {
+  return reinterpret_cast<SlotHeader*>(const_cast<char*>(static_cast<const char*>(pointer)) - sizeof(SlotHeader));
+}
+
+CommandPool& CommandPool::instance() {
+  // Never destroyed, commands in static objects may outlive any other static.
+  static CommandPool* pool = new CommandPool();
+  return *pool;
+}
+
+CommandPool::CommandPool() : freeSlots(SizeClasses, nullptr) {}
+
+CommandPool::~CommandPool() {
+  for (void* block : blocks) {
+    ::operator delete(block);
+  }
+}
+
+void CommandPool::refill(size_t sizeClass) {
+  char* block = static_cast<char*>(::operator new(BlockSize));
+  blocks.push_back(block);
+  reserved += BlockSize;
+  size_t size = slotSize(sizeClass);
+  for (size_t offset = 0; offset + size <= BlockSize; offset += size) {
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(block + offset);
+    slot->next = freeSlots[sizeClass];
+    freeSlots[sizeClass] = slot;
+  }
+}
+
+void* CommandPool::allocate(size_t size) {
+  size_t sizeClass = (size + sizeof(SlotHeader) - 1) / SlotGranularity;
+  SlotHeader* header;
+  if (sizeClass >= SizeClasses) {
+    header = static_cast<SlotHeader*>(::operator new(size + sizeof(SlotHeader)));
+    sizeClass = HeapAllocated;
+  } else {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (freeSlots[sizeClass] == nullptr) refill(sizeClass);
+    FreeSlot* slot = freeSlots[sizeClass];
+    freeSlots[sizeClass] = slot->next;
+    header = reinterpret_cast<SlotHeader*>(slot);
+  }
+  header->size = uint32_t(size);
+  header->sizeClass = uint32_t(sizeClass);
+  return header + 1;
+}
+
+void CommandPool::deallocate(void* pointer) {
+  if (pointer == nullptr) return;
+  SlotHeader* header = headerOf(pointer);
+  if (header->sizeClass == HeapAllocated) {
+    ::operator delete(header);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  FreeSlot* slot = reinterpret_cast<FreeSlot*>(header);
+  size_t sizeClass = header->sizeClass;
+  slot->next = freeSlots[sizeClass];
+  freeSlots[sizeClass] = slot;
+}
+
+size_t CommandPool::allocationSize(const void* pointer) {
+  return headerOf(pointer)->size;
+}
+
+size_t CommandPool::reservedBytes() {
+  std::unique_lock<std::mutex> lock(mutex);
+  return reserved;
+}
+
+} // namespace commands
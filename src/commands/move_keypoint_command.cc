@@ -14,4 +14,11 @@ void MoveKeypointCommand::undo(SceneModel& sceneModel) {
   sceneModel.updateKeypoint(oldKeypoint.id, oldKeypoint);
   sceneModel.activeKeypoint = -1;
 }
+
+bool MoveKeypointCommand::merge(const Command& next) {
+  auto move = dynamic_cast<const MoveKeypointCommand*>(&next);
+  if (move == nullptr || move->oldKeypoint.id != oldKeypoint.id) return false;
+  newKeypoint = move->newKeypoint;
+  return true;
+}
 }; // namespace commands
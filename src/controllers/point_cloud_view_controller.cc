@@ -9,9 +9,9 @@ using namespace commands;
 using namespace views;
 namespace fs = std::filesystem;
 
-PointCloudViewController::PointCloudViewController(fs::path pcPath) : viewId(IdFactory::getInstance().getId()),
+PointCloudViewController::PointCloudViewController(fs::path pcPath, model::PointCloudDatasetOptions datasetOptions) : viewId(IdFactory::getInstance().getId()),
                                                                               timeline(sceneModel),
-                                                                              dataset(pcPath),
+                                                                              dataset(pcPath, datasetOptions),
                                                                               sceneModel(),
                                                                               datasetMetadata(utils::dataset::getDatasetMetadata(pcPath.parent_path() / "metadata.json")),
                                                                               viewContext(),
@@ -25,9 +25,8 @@ PointCloudViewController::PointCloudViewController(fs::path pcPath) : viewId(IdF
                                                                               statusBarView(sceneModel, IdFactory::getInstance().getId()) {
 
   annotationPath = utils::dataset::getAnnotationPathForPointCloudPath(pcPath);
-  auto future = dataset.getCurrentCloud();
-  future.wait();
-  sceneModel.setPointCloud(future.get());
+  model::DatasetPointCloud current = dataset.getCurrentCloud().get();
+  sceneModel.setPointCloud(current.pointCloud, current.rayTraceCloud, current.octree);
   pointCloudView.loadPointCloud();
   sceneModel.activeView = active_view::PointCloudView;
 }
@@ -65,6 +64,8 @@ void PointCloudViewController::refresh() {
 }
 
 void PointCloudViewController::render() const {
+  displayNeeded = false;
+  renderedRevision = sceneModel.getDisplayRevision();
   bgfx::setViewRect(viewId, 0, 0, viewContext.width, viewContext.height);
   annotationView.render(viewContext);
 
@@ -84,8 +85,15 @@ void PointCloudViewController::render() const {
   }
 }
 
+bool PointCloudViewController::needsDisplay() const {
+  // Nodes that did not fit in the upload budget of the last frame are drawn in the next ones.
+  return displayNeeded || sceneModel.getDisplayRevision() != renderedRevision ||
+         pointCloudView.getLastFrameStats().deferredNodes > 0;
+}
+
 // Input handling.
 bool PointCloudViewController::leftButtonDown(double x, double y, InputModifier mod) {
+  setNeedsDisplay();
   updateViewContext(x, y, mod);
 
   if (getActiveToolView().leftButtonDown(viewContext)) {
@@ -95,6 +103,7 @@ bool PointCloudViewController::leftButtonDown(double x, double y, InputModifier
 }
 
 bool PointCloudViewController::leftButtonUp(double x, double y, InputModifier mod) {
+  setNeedsDisplay();
   updateViewContext(x, y, mod);
 
   if (!cameraControls.leftButtonUp(viewContext)) {
@@ -104,31 +113,40 @@ bool PointCloudViewController::leftButtonUp(double x, double y, InputModifier mo
 }
 
 bool PointCloudViewController::mouseMoved(double x, double y, InputModifier mod) {
+  const std::optional<Vector3f> pointingAt = viewContext.pointingAt;
   updateViewContext(x, y, mod);
+  // The point under the cursor is highlighted.
+  if (viewContext.pointingAt != pointingAt) {
+    setNeedsDisplay();
+  }
 
   if (getActiveToolView().mouseMoved(viewContext)) {
+    setNeedsDisplay();
     return true;
   }
 
   if (cameraControls.mouseMoved(viewContext)) {
+    setNeedsDisplay();
     return true;
   }
   return false;
 }
 
 bool PointCloudViewController::scroll(double xoffset, double yoffset, InputModifier mod) {
+  setNeedsDisplay();
   cameraControls.scroll(xoffset, yoffset, viewContext);
   return true;
 }
 
 void PointCloudViewController::resize(const views::Rect& rect) {
+  setNeedsDisplay();
   viewContext.width = rect.width;
   viewContext.height = rect.height - views::StatusBarHeight;
   statusBarView.setRect(statusBarRect());
 }
 
 bool PointCloudViewController::keypress(char character, const InputModifier mod) {
-  // TODO: Load a new path/cloud when tab is pressed
+  setNeedsDisplay();
   Controller::keypress(character, mod);
   if (sceneModel.activeView == active_view::PointCloudView) {
     if (mod & ModCommand && (character == '+' || character == '=')) {
@@ -160,7 +178,11 @@ bool PointCloudViewController::keypress(char character, const InputModifier mod)
     }
   } else if (int(character) == 2) {
     // Tab pressed.
-    nextPointCloud();
+    if (mod & ModShift) {
+      previousPointCloud();
+    } else {
+      nextPointCloud();
+    }
   }
   return false;
 }
@@ -179,31 +201,75 @@ void PointCloudViewController::updateViewContext(double x, double y, InputModifi
   auto intersection = sceneModel.traceRayIntersection(viewContext.camera.getPosition(), rayDirection);
   if (intersection.hit) {
     viewContext.pointingAt = intersection.point;
+    viewContext.pointingAtNormal = intersection.normal;
   } else {
     viewContext.pointingAt = {};
   }
 }
 
-void PointCloudViewController::save() const {
+void PointCloudViewController::save() {
   // TODO: Modify file name according to current point cloud file and not the "root"
-  sceneModel.save(annotationPath);
+  if (autosave.save(sceneModel, annotationPath)) {
+    std::cout << "Saved annotations to " << annotationPath.string() << std::endl;
+  }
 };
 
 void PointCloudViewController::load() {
   // TODO: Modify file name according to current point cloud file and not the "root"
-  timeline.load(annotationPath);
+  bool loaded = timeline.load(annotationPath);
+  autosave.restore(sceneModel, annotationPath, loaded);
 };
 
+void PointCloudViewController::updateAutosave() {
+  autosave.update(sceneModel, annotationPath);
+}
+
+void PointCloudViewController::updateBackgroundWork() {
+  if (sceneModel.updateGeometryBuilds()) {
+    pointCloudView.updateOctree();
+    // The point under the cursor now comes with the normal of the surface.
+    updateViewContext(viewContext.mousePositionX, viewContext.mousePositionY, viewContext.modifiers);
+    setNeedsDisplay();
+  }
+}
+
 void PointCloudViewController::undo() {
+  setNeedsDisplay();
   timeline.undoCommand();
   refresh();
 }
 
+void PointCloudViewController::redo() {
+  setNeedsDisplay();
+  timeline.redoCommand();
+  refresh();
+}
+
 void PointCloudViewController::nextPointCloud() {
-  auto future = dataset.next();
-  future.wait();
-  auto pointCloud = future.get();
-  sceneModel.setPointCloud(pointCloud);
+  showPointCloud(dataset.getCurrentIndex() + 1);
+}
+
+void PointCloudViewController::previousPointCloud() {
+  showPointCloud(dataset.getCurrentIndex() - 1);
+}
+
+void PointCloudViewController::showPointCloud(int index) {
+  const int shownIndex = dataset.getCurrentIndex();
+  model::DatasetPointCloudFuture future = dataset.seek(index);
+  model::DatasetPointCloud pointCloud;
+  try {
+    // Returns immediately if the cloud was prefetched.
+    pointCloud = future.get();
+  } catch (const std::exception& e) {
+    std::cout << "Could not load point cloud " << dataset.currentPath().string() << ": " << e.what() << std::endl;
+    // The previous cloud stays on screen, stepping on continues from it.
+    dataset.seek(shownIndex);
+    return;
+  }
+  // Annotations of the previous cloud are saved before they are cleared.
+  autosave.update(sceneModel, annotationPath);
+  autosave.flush();
+  sceneModel.setPointCloud(pointCloud.pointCloud, pointCloud.rayTraceCloud, pointCloud.octree);
   sceneModel.reset();
   pointCloudView.reload();
   annotationPath = utils::dataset::getAnnotationPathForPointCloudPath(dataset.currentPath());
@@ -2,23 +2,40 @@
 #include <chrono>
 #include <filesystem>
 #include <random>
+#include <iostream>
 #include <vector>
 #include <string>
 #include "controllers/preview_controller.h"
 #include "id.h"
-#include "utils/dataset.h"
+#include "utils/main_loop.h"
 
 namespace fs = std::filesystem;
 
 namespace controllers {
-PreviewController::PreviewController(const SceneModel& scene, fs::path path, int viewId) :
+PreviewController::PreviewController(const SceneModel& scene, std::shared_ptr<const model::DatasetIndex> index, int viewId) :
   viewId(viewId),
-  datasetPath(path),
-  sceneCamera(datasetPath / "camera_intrinsics.json"),
+  dataset(index),
+  frames(index),
   model(scene),
-  viewContext(sceneCamera) {
+  viewContext(dataset->getCamera()) {
 
   annotationView = std::make_unique<views::AnnotationView>(model, IdFactory::getInstance().getId());
+  const SceneCamera& camera = dataset->getCamera();
+  imageView = std::make_unique<views::ImagePane>(viewId, camera.imageWidth, camera.imageHeight);
+
+  thumbnails = openThumbnails();
+  if (thumbnails == nullptr && !dataset->empty()) {
+    fs::path thumbnailPath = model::ThumbnailCache::pathFor(*dataset);
+    std::cout << "Generating thumbnails in " << thumbnailPath.string() << std::endl;
+    model::ThumbnailOptions options;
+    options.compress = bgfx::getCaps()->formats[bgfx::TextureFormat::BC1] & BGFX_CAPS_FORMAT_TEXTURE_2D;
+    thumbnailGenerator = std::jthread([this, index, thumbnailPath, options](std::stop_token stop) {
+      if (model::ThumbnailCache::generate(*index, thumbnailPath, options, stop)) {
+        thumbnailsGenerated = true;
+        utils::main_loop::wake();
+      }
+    });
+  }
   setRandomImage();
 }
 
@@ -26,6 +43,7 @@ void PreviewController::viewWillAppear(const views::Rect& rect) {
   Controller3D::viewWillAppear(rect);
   viewContext.width = rect.width;
   viewContext.height = rect.height;
+  if (currentFrame.has_value() && useThumbnail(*currentFrame) != showingThumbnail) showImage(*currentFrame);
   bgfx::setViewClear(viewId, BGFX_CLEAR_DEPTH, 1.0f);
   bgfx::setViewClear(annotationView->viewId, BGFX_CLEAR_DEPTH, 1.0f);
 }
@@ -52,31 +70,74 @@ bool PreviewController::keypress(char keypress, const InputModifier mod) {
 }
 
 void PreviewController::setRandomImage() {
+  if (dataset->empty()) return;
   unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
   std::mt19937 rng(seed);
-  auto images = utils::dataset::getDatasetImagePaths(datasetPath / "color");
-  std::uniform_int_distribution<> distribution(0, images.size());
-  int sampled = distribution(rng);
-  setImage(sampled);
+  std::uniform_int_distribution<size_t> distribution(0, dataset->size() - 1);
+  setImage(distribution(rng));
 }
 
 void PreviewController::setImage(float t) {
-  auto images = utils::dataset::getDatasetImagePaths(datasetPath / "color");
-  int imageCount = images.size();
-  t = std::clamp(t, 0.0f, 1.0f);
-  int imageIndex = std::floor(t * float(imageCount));
-  setImage(imageIndex);
+  if (dataset->empty()) return;
+  setImage(dataset->frameAt(t));
 }
 
-void PreviewController::setImage(int i) {
-  auto images = utils::dataset::getDatasetImagePaths(datasetPath / "color");
-  Matrix4f T_CW = utils::dataset::getDatasetCameraTrajectory(datasetPath / "scene" / "trajectory.log")[i]; // model.cameraTrajectory()[i];
+void PreviewController::setImage(size_t frame) {
+  const Matrix4f& T_CW = dataset->cameraPose(frame);
   Vector3f p_C = T_CW.block<3, 1>(0, 3);
   Quaternionf R_C(T_CW.block<3, 3>(0, 0));
   auto R_WC = AngleAxisf(M_PI, Vector3f::UnitX());
   viewContext.camera.setOrientation((R_C * R_WC).normalized());
   viewContext.camera.setPosition(p_C);
-  imageView = std::make_unique<views::ImagePane>(images[i], viewId);
+  showImage(frame);
+}
+
+bool PreviewController::updateImage() {
+  bool changed = false;
+  if (thumbnails == nullptr && thumbnailsGenerated.exchange(false)) {
+    thumbnails = openThumbnails();
+    if (currentFrame.has_value() && useThumbnail(*currentFrame) != showingThumbnail) {
+      showImage(*currentFrame);
+      changed = true;
+    }
+  }
+  if (pendingImage.valid() && pendingImage.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    imageView->setImage(pendingImage.get());
+    pendingImage = {};
+    changed = true;
+  }
+  return changed;
+}
+
+void PreviewController::showImage(size_t frame) {
+  currentFrame = frame;
+  pendingImage = {};
+  showingThumbnail = useThumbnail(frame);
+  if (showingThumbnail) {
+    imageView->setImage(thumbnails->image(frame));
+    return;
+  }
+  // Decoded in the background, usually ahead of time.
+  model::FrameFuture image = frames.seek(frame);
+  if (thumbnails != nullptr && thumbnails->contains(frame) &&
+      image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    imageView->setImage(thumbnails->image(frame));
+    pendingImage = image;
+    return;
+  }
+  imageView->setImage(image.get());
+}
+
+std::unique_ptr<model::ThumbnailCache> PreviewController::openThumbnails() const {
+  auto cache = model::ThumbnailCache::open(model::ThumbnailCache::pathFor(*dataset), *dataset);
+  if (cache == nullptr) return nullptr;
+  if (!(bgfx::getCaps()->formats[cache->textureFormat()] & BGFX_CAPS_FORMAT_TEXTURE_2D)) return nullptr;
+  return cache;
+}
+
+bool PreviewController::useThumbnail(size_t frame) const {
+  if (thumbnails == nullptr || !thumbnails->contains(frame)) return false;
+  return thumbnails->width(frame) >= rect.width && thumbnails->height(frame) >= rect.height;
 }
 
 void PreviewController::render() const {
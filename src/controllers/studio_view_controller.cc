@@ -16,7 +16,8 @@ using namespace views;
 
 StudioViewController::StudioViewController(fs::path datasetPath) : viewId(IdFactory::getInstance().getId()),
                                                                    sceneModel((datasetPath / "scene" / "integrated.ply").string()),
-                                                                   sceneCamera(datasetPath / "camera_intrinsics.json"),
+                                                                   datasetIndex(std::make_shared<model::DatasetIndex>(datasetPath)),
+                                                                   sceneCamera(datasetIndex->getCamera()),
                                                                    datasetPath(datasetPath),
                                                                    datasetMetadata(utils::dataset::getDatasetMetadata(datasetPath.parent_path() / "metadata.json")),
                                                                    timeline(sceneModel),
@@ -31,7 +32,7 @@ StudioViewController::StudioViewController(fs::path datasetPath) : viewId(IdFact
                                                                    addRectangleView(sceneModel, timeline, viewId),
                                                                    statusBarView(sceneModel, IdFactory::getInstance().getId()) {
   pointCloudPath = datasetPath / "scene" / "cloud.ply";
-  preview = std::make_shared<controllers::PreviewController>(sceneModel, datasetPath, IdFactory::getInstance().getId());
+  preview = std::make_shared<controllers::PreviewController>(sceneModel, datasetIndex, IdFactory::getInstance().getId());
   addSubController(std::static_pointer_cast<controllers::Controller>(preview));
 }
 
@@ -71,6 +72,8 @@ void StudioViewController::refresh() {
 }
 
 void StudioViewController::render() const {
+  displayNeeded = false;
+  renderedRevision = sceneModel.getDisplayRevision();
   bgfx::setViewRect(viewId, 0, 0, viewContext.width, viewContext.height);
   annotationView.render(viewContext);
 
@@ -99,8 +102,15 @@ void StudioViewController::render() const {
   }
 }
 
+bool StudioViewController::needsDisplay() const {
+  if (displayNeeded || sceneModel.getDisplayRevision() != renderedRevision) return true;
+  // Nodes that did not fit in the upload budget of the last frame are drawn in the next ones.
+  return sceneModel.activeView == active_view::PointCloudView && pointCloudView.getLastFrameStats().deferredNodes > 0;
+}
+
 // Input handling.
 bool StudioViewController::leftButtonDown(double x, double y, InputModifier mod) {
+  setNeedsDisplay();
   updateViewContext(x, y, mod);
 
   if (preview->leftButtonDown(viewContext)) {
@@ -114,6 +124,7 @@ bool StudioViewController::leftButtonDown(double x, double y, InputModifier mod)
 }
 
 bool StudioViewController::leftButtonUp(double x, double y, InputModifier mod) {
+  setNeedsDisplay();
   updateViewContext(x, y, mod);
 
   if (preview->leftButtonUp(viewContext)) {
@@ -125,19 +136,27 @@ bool StudioViewController::leftButtonUp(double x, double y, InputModifier mod) {
 }
 
 bool StudioViewController::mouseMoved(double x, double y, InputModifier mod) {
+  const std::optional<Vector3f> pointingAt = viewContext.pointingAt;
   updateViewContext(x, y, mod);
+  // Tools follow the point under the cursor.
+  if (viewContext.pointingAt != pointingAt) {
+    setNeedsDisplay();
+  }
 
-  if (getActiveToolView().mouseMoved(viewContext)) {
+  if (getActiveToolView().mouseMoved(viewContext) || cameraControls.mouseMoved(viewContext)) {
+    setNeedsDisplay();
     return true;
   }
-  return cameraControls.mouseMoved(viewContext);
+  return false;
 }
 
 bool StudioViewController::scroll(double xoffset, double yoffset, InputModifier mod) {
+  setNeedsDisplay();
   return cameraControls.scroll(xoffset, yoffset, viewContext);
 }
 
 void StudioViewController::resize(const views::Rect& rect) {
+  setNeedsDisplay();
   viewContext.width = rect.width;
   viewContext.height = rect.height - views::StatusBarHeight;
   preview->resize(previewRect());
@@ -145,6 +164,7 @@ void StudioViewController::resize(const views::Rect& rect) {
 }
 
 bool StudioViewController::keypress(char character, const InputModifier mod) {
+  setNeedsDisplay();
   Controller::keypress(character, mod);
   if (sceneModel.activeView == active_view::PointCloudView) {
     if (mod & ModCtrl && (character == '+' || character == '=')) {
@@ -206,30 +226,56 @@ void StudioViewController::updateViewContext(double x, double y, InputModifier m
 
   const Vector3f& rayDirection = viewContext.camera.computeRayWorld(viewContext.width, viewContext.height,
                                                                     viewContext.mousePositionX, viewContext.mousePositionY);
-  auto point = sceneModel.traceRay(viewContext.camera.getPosition(), rayDirection);
-  if (point.has_value()) {
-    viewContext.pointingAt = point;
+  auto intersection = sceneModel.traceRayIntersection(viewContext.camera.getPosition(), rayDirection);
+  if (intersection.hit) {
+    viewContext.pointingAt = intersection.point;
+    viewContext.pointingAtNormal = intersection.normal;
   } else {
     viewContext.pointingAt = {};
   }
 }
 
-void StudioViewController::save() const {
-  sceneModel.save(datasetPath / "annotations.json");
+void StudioViewController::save() {
+  fs::path annotationPath = datasetPath / "annotations.json";
+  if (autosave.save(sceneModel, annotationPath)) {
+    std::cout << "Saved annotations to " << annotationPath.string() << std::endl;
+  }
 }
 
 void StudioViewController::load() {
-  timeline.load(datasetPath / "annotations.json");
+  bool loaded = timeline.load(datasetPath / "annotations.json");
+  autosave.restore(sceneModel, datasetPath / "annotations.json", loaded);
+}
+
+void StudioViewController::updateAutosave() {
+  autosave.update(sceneModel, datasetPath / "annotations.json");
+}
+
+void StudioViewController::updateBackgroundWork() {
+  if (sceneModel.updateGeometryBuilds()) {
+    pointCloudView.updateOctree();
+    // The point under the cursor now comes with the normal of the surface.
+    updateViewContext(viewContext.mousePositionX, viewContext.mousePositionY, viewContext.modifiers);
+    setNeedsDisplay();
+  }
+  if (preview->updateImage()) setNeedsDisplay();
 }
 
 void StudioViewController::undo() {
+  setNeedsDisplay();
   timeline.undoCommand();
   refresh();
 }
 
+void StudioViewController::redo() {
+  setNeedsDisplay();
+  timeline.redoCommand();
+  refresh();
+}
+
 void StudioViewController::loadPointCloud() {
   if (sceneModel.getPointCloud() == nullptr) {
-    sceneModel.setPointCloud(std::make_shared<geometry::PointCloud>(pointCloudPath));
+    sceneModel.loadPointCloud(pointCloudPath);
   }
   pointCloudView.loadPointCloud();
 }
@@ -0,0 +1,205 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <unistd.h>
+#include "geometry/index_cache.h"
+
+namespace fs = std::filesystem;
+
+namespace geometry {
+
+namespace {
+const char Magic[8] = {'S', 'T', 'R', 'A', 'Y', 'B', 'V', 'H'};
+const size_t SectionAlignment = 64;
+// Headers are far shorter, unless the file has a lot of comments.
+const size_t MaxHeaderSize = 1 << 16;
+const uint64_t FNVOffset = 0xcbf29ce484222325ull;
+const uint64_t FNVPrime = 0x100000001b3ull;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t kind;
+  uint64_t sourceSize;
+  int64_t sourceModified;
+  uint64_t headerHash;
+  uint32_t sectionCount;
+  uint32_t reserved;
+};
+
+struct SectionEntry {
+  uint32_t id;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+inline uint64_t fnv(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * FNVPrime;
+}
+
+// FNV-1a over the bytes.
+uint64_t hashBytes(std::string_view bytes) {
+  uint64_t hash = fnv(FNVOffset, bytes.size());
+  for (char byte : bytes) {
+    hash = fnv(hash, uint8_t(byte));
+  }
+  return hash;
+}
+
+// The header of a .ply file, up to and including end_header, or as much of the file as could be a header.
+std::string readHeader(const fs::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Could not open " + path.string());
+  std::string header(MaxHeaderSize, '\0');
+  in.read(header.data(), header.size());
+  header.resize(size_t(in.gcount()));
+  const std::string_view end = "end_header";
+  size_t position = header.find(end);
+  if (position != std::string::npos) header.resize(position + end.size());
+  return header;
+}
+
+int64_t modifiedTime(const fs::path& path) {
+  return int64_t(fs::last_write_time(path).time_since_epoch().count());
+}
+
+size_t aligned(size_t offset) {
+  return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+}
+} // namespace
+
+IndexCache::IndexCache(const fs::path& source, IndexKind k) : sourceFile(source), kind(k) {}
+
+fs::path IndexCache::path() const {
+  return sourceFile.parent_path() / ("." + sourceFile.filename().string() + ".bvh");
+}
+
+uint64_t IndexCache::getHeaderHash() const {
+  if (!headerHash.has_value()) headerHash = hashBytes(readHeader(sourceFile));
+  return *headerHash;
+}
+
+bool IndexCache::load() {
+  mapped.reset();
+  sections.clear();
+  std::error_code error;
+  if (!fs::exists(path(), error)) return false;
+
+  try {
+    return loadMapped(std::make_unique<utils::MappedFile>(path()));
+  } catch (const std::exception& e) {
+    // Unreadable cache or source file, rebuild.
+    return false;
+  }
+}
+
+bool IndexCache::loadMapped(std::unique_ptr<utils::MappedFile> file) {
+  if (file->size() < sizeof(Header)) return false;
+
+  Header header;
+  std::memcpy(&header, file->data(), sizeof(Header));
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.kind != uint32_t(kind)) {
+    return false;
+  }
+  // Check the cheap parts of the key first, only read the source if they match.
+  if (header.sourceSize != fs::file_size(sourceFile) || header.sourceModified != modifiedTime(sourceFile)) {
+    return false;
+  }
+  size_t tableEnd = sizeof(Header) + size_t(header.sectionCount) * sizeof(SectionEntry);
+  if (tableEnd > file->size()) return false;
+
+  std::vector<std::pair<IndexSection, std::span<const uint8_t>>> entries;
+  for (uint32_t i = 0; i < header.sectionCount; i++) {
+    SectionEntry entry;
+    std::memcpy(&entry, file->data() + sizeof(Header) + i * sizeof(SectionEntry), sizeof(SectionEntry));
+    if (entry.offset > file->size() || entry.size > file->size() - entry.offset) return false;
+    entries.push_back({IndexSection(entry.id), {file->data() + entry.offset, size_t(entry.size)}});
+  }
+
+  if (header.headerHash != getHeaderHash()) return false;
+
+  mapped = std::move(file);
+  sections = std::move(entries);
+  return true;
+}
+
+std::span<const uint8_t> IndexCache::getSection(IndexSection section) const {
+  for (const auto& [id, bytes] : sections) {
+    if (id == section) return bytes;
+  }
+  return {};
+}
+
+void IndexCache::setSection(IndexSection section, const void* data, size_t size) {
+  std::span<const uint8_t> bytes(static_cast<const uint8_t*>(data), size);
+  for (auto& entry : sections) {
+    if (entry.first == section) {
+      entry.second = bytes;
+      return;
+    }
+  }
+  sections.push_back({section, bytes});
+}
+
+bool IndexCache::save() const {
+  Header header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.kind = uint32_t(kind);
+  header.reserved = 0;
+  header.sectionCount = uint32_t(sections.size());
+  try {
+    header.sourceSize = fs::file_size(sourceFile);
+    header.sourceModified = modifiedTime(sourceFile);
+    header.headerHash = getHeaderHash();
+  } catch (const std::exception& e) {
+    std::cout << "Not caching acceleration structures for " << sourceFile.string() << ": " << e.what() << std::endl;
+    return false;
+  }
+
+  std::vector<SectionEntry> table;
+  size_t offset = aligned(sizeof(Header) + sections.size() * sizeof(SectionEntry));
+  for (const auto& [id, bytes] : sections) {
+    table.push_back({uint32_t(id), 0, offset, bytes.size()});
+    offset = aligned(offset + bytes.size());
+  }
+
+  // Write next to the final file and rename, so readers never see a partially written cache. Several
+  // threads and processes may be saving the same cache.
+  static std::atomic<uint64_t> saveCount = 0;
+  fs::path temporary = path();
+  temporary += ".tmp" + std::to_string(getpid()) + "." + std::to_string(saveCount++);
+  FILE* out = std::fopen(temporary.c_str(), "wb");
+  if (out == nullptr) {
+    std::cout << "Could not write acceleration structure cache " << temporary.string() << std::endl;
+    return false;
+  }
+  const char padding[SectionAlignment] = {};
+  bool ok = std::fwrite(&header, sizeof(Header), 1, out) == 1;
+  ok = ok && std::fwrite(table.data(), sizeof(SectionEntry), table.size(), out) == table.size();
+  size_t written = sizeof(Header) + table.size() * sizeof(SectionEntry);
+  for (size_t i = 0; ok && i < sections.size(); i++) {
+    size_t pad = table[i].offset - written;
+    ok = std::fwrite(padding, 1, pad, out) == pad;
+    ok = ok && std::fwrite(sections[i].second.data(), 1, sections[i].second.size(), out) == sections[i].second.size();
+    written = table[i].offset + sections[i].second.size();
+  }
+  ok = (std::fclose(out) == 0) && ok;
+
+  std::error_code error;
+  if (ok) fs::rename(temporary, path(), error);
+  if (!ok || error) {
+    fs::remove(temporary, error);
+    std::cout << "Could not write acceleration structure cache " << path().string() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace geometry
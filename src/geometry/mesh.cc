@@ -5,6 +5,7 @@
 #include "views/view.h"
 #include "shader_utils.h"
 #include "views/mesh_view.h"
+#include "geometry/ply_reader.h"
 
 namespace geometry {
 
@@ -133,6 +134,25 @@ void Sphere::subdivide() {
 }
 
 Mesh::Mesh(const std::string& meshFile, const Matrix4f& T, float scale) : TriangleMesh(T) {
+  if (!loadBinary(meshFile, scale)) {
+    loadWithHapply(meshFile, scale);
+  }
+  computeNormals();
+}
+
+bool Mesh::loadBinary(const std::string& meshFile, float scale) {
+  PlyReader reader(meshFile);
+  if (!reader.isBinaryLittleEndian()) return false;
+  if (!reader.readTriangles(F)) return false;
+  reader.readColumns("vertex", {"x", "y", "z"}, V, scale);
+  colorsFromFile = reader.hasProperty("vertex", "red");
+  if (colorsFromFile) {
+    reader.readColors(vertexColors);
+  }
+  return true;
+}
+
+void Mesh::loadWithHapply(const std::string& meshFile, float scale) {
   happly::PLYData plyIn(meshFile);
   const auto& vertices = plyIn.getVertexPositions();
   const auto& propertyNames = plyIn.getElement("vertex").getPropertyNames();
@@ -165,7 +185,6 @@ Mesh::Mesh(const std::string& meshFile, const Matrix4f& T, float scale) : Triang
       F(i, j) = faces[i][j];
     }
   }
-  computeNormals();
 }
 
 Mesh::~Mesh() {
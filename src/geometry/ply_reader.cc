@@ -0,0 +1,347 @@
+#include <bit>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <omp.h>
+#include "geometry/ply_reader.h"
+
+namespace geometry {
+
+namespace {
+
+const std::string HeaderEnd = "end_header";
+
+PlyReader::Type parseType(const std::string& name) {
+  if (name == "char" || name == "int8") return PlyReader::Type::Int8;
+  if (name == "uchar" || name == "uint8") return PlyReader::Type::UInt8;
+  if (name == "short" || name == "int16") return PlyReader::Type::Int16;
+  if (name == "ushort" || name == "uint16") return PlyReader::Type::UInt16;
+  if (name == "int" || name == "int32") return PlyReader::Type::Int32;
+  if (name == "uint" || name == "uint32") return PlyReader::Type::UInt32;
+  if (name == "float" || name == "float32") return PlyReader::Type::Float32;
+  if (name == "double" || name == "float64") return PlyReader::Type::Float64;
+  throw std::runtime_error("Unknown ply property type " + name);
+}
+
+size_t typeSize(PlyReader::Type type) {
+  switch (type) {
+  case PlyReader::Type::Int8:
+  case PlyReader::Type::UInt8:
+    return 1;
+  case PlyReader::Type::Int16:
+  case PlyReader::Type::UInt16:
+    return 2;
+  case PlyReader::Type::Int32:
+  case PlyReader::Type::UInt32:
+  case PlyReader::Type::Float32:
+    return 4;
+  case PlyReader::Type::Float64:
+    return 8;
+  }
+  return 0;
+}
+
+bool isFloatingPoint(PlyReader::Type type) {
+  return type == PlyReader::Type::Float32 || type == PlyReader::Type::Float64;
+}
+
+template <typename T>
+inline T load(const uint8_t* address) {
+  // Records are packed, so values are not necessarily aligned.
+  T value;
+  std::memcpy(&value, address, sizeof(T));
+  return value;
+}
+
+size_t loadCount(const uint8_t* address, PlyReader::Type type) {
+  switch (type) {
+  case PlyReader::Type::Int8:
+    return size_t(load<int8_t>(address));
+  case PlyReader::Type::UInt8:
+    return size_t(load<uint8_t>(address));
+  case PlyReader::Type::Int16:
+    return size_t(load<int16_t>(address));
+  case PlyReader::Type::UInt16:
+    return size_t(load<uint16_t>(address));
+  case PlyReader::Type::Int32:
+    return size_t(load<int32_t>(address));
+  case PlyReader::Type::UInt32:
+    return size_t(load<uint32_t>(address));
+  default:
+    throw std::runtime_error("Ply list counts have to be integers.");
+  }
+}
+
+template <typename Source, typename Scalar>
+inline Scalar convert(const uint8_t* address, float scale) {
+  if constexpr (std::is_integral_v<Source> && std::is_integral_v<Scalar>) {
+    // Indices and colors, scaling does not apply and floats would lose precision.
+    return Scalar(load<Source>(address));
+  } else {
+    return Scalar(float(load<Source>(address)) * scale);
+  }
+}
+
+/*
+ * Strided copy of three columns of type Source into a row major matrix.
+ * The loop body is branch free so that the compiler can vectorize it.
+ */
+template <typename Source, typename Scalar>
+void copyColumns(const uint8_t* data, size_t count, size_t stride, const std::array<size_t, 3>& offsets,
+                 float scale, Scalar* out) {
+  const size_t o0 = offsets[0], o1 = offsets[1], o2 = offsets[2];
+#pragma omp parallel for
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* record = data + i * stride;
+    out[i * 3 + 0] = convert<Source, Scalar>(record + o0, scale);
+    out[i * 3 + 1] = convert<Source, Scalar>(record + o1, scale);
+    out[i * 3 + 2] = convert<Source, Scalar>(record + o2, scale);
+  }
+}
+
+template <typename Scalar>
+void copyColumns(PlyReader::Type type, const uint8_t* data, size_t count, size_t stride,
+                 const std::array<size_t, 3>& offsets, float scale, Scalar* out) {
+  switch (type) {
+  case PlyReader::Type::Int8:
+    return copyColumns<int8_t>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::UInt8:
+    return copyColumns<uint8_t>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::Int16:
+    return copyColumns<int16_t>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::UInt16:
+    return copyColumns<uint16_t>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::Int32:
+    return copyColumns<int32_t>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::UInt32:
+    return copyColumns<uint32_t>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::Float32:
+    return copyColumns<float>(data, count, stride, offsets, scale, out);
+  case PlyReader::Type::Float64:
+    return copyColumns<double>(data, count, stride, offsets, scale, out);
+  }
+}
+
+} // namespace
+
+PlyReader::PlyReader(const fs::path& path) : file(path) {
+  parseHeader();
+}
+
+void PlyReader::parseHeader() {
+  const char* begin = reinterpret_cast<const char*>(file.data());
+  std::string_view contents(begin, file.size());
+  // The header ends at the first line that is only end_header, the binary body after it can hold anything.
+  bool ended = false;
+  size_t lineStart = 0;
+  for (size_t lineNumber = 0; !ended; lineNumber++) {
+    size_t lineEnd = contents.find('\n', lineStart);
+    if (lineEnd == std::string_view::npos) {
+      throw std::runtime_error(lineNumber == 0 ? "Not a ply file." : "Truncated ply header.");
+    }
+    std::string_view line = contents.substr(lineStart, lineEnd - lineStart);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    lineStart = lineEnd + 1;
+    if (lineNumber == 0) {
+      if (line != "ply") throw std::runtime_error("Not a ply file.");
+      continue;
+    }
+    if (line == HeaderEnd) {
+      ended = true;
+      continue;
+    }
+
+    std::istringstream tokens{std::string(line)};
+    std::string keyword;
+    tokens >> keyword;
+    if (keyword == "format") {
+      tokens >> format;
+    } else if (keyword == "element") {
+      Element element;
+      tokens >> element.name >> element.count;
+      elements.push_back(element);
+    } else if (keyword == "property") {
+      if (elements.empty()) {
+        throw std::runtime_error("Ply property declared before any element.");
+      }
+      Property property;
+      std::string type;
+      tokens >> type;
+      if (type == "list") {
+        std::string countType, itemType;
+        tokens >> countType >> itemType;
+        property.isList = true;
+        property.countType = parseType(countType);
+        property.type = parseType(itemType);
+      } else {
+        property.type = parseType(type);
+      }
+      tokens >> property.name;
+      elements.back().properties.push_back(property);
+    }
+  }
+  dataOffset = lineStart;
+
+  for (Element& element : elements) {
+    size_t offset = 0;
+    bool fixedSize = true;
+    for (Property& property : element.properties) {
+      if (property.isList) {
+        fixedSize = false;
+        break;
+      }
+      property.offset = offset;
+      offset += typeSize(property.type);
+    }
+    element.stride = fixedSize ? offset : 0;
+  }
+}
+
+bool PlyReader::isBinaryLittleEndian() const {
+  return format == "binary_little_endian" && std::endian::native == std::endian::little;
+}
+
+const PlyReader::Element* PlyReader::getElement(const std::string& name) const {
+  for (const Element& element : elements) {
+    if (element.name == name) return &element;
+  }
+  return nullptr;
+}
+
+const PlyReader::Property* PlyReader::getProperty(const std::string& elementName, const std::string& name) const {
+  const Element* element = getElement(elementName);
+  if (element == nullptr) return nullptr;
+  for (const Property& property : element->properties) {
+    if (property.name == name) return &property;
+  }
+  return nullptr;
+}
+
+bool PlyReader::hasProperty(const std::string& element, const std::string& property) const {
+  return getProperty(element, property) != nullptr;
+}
+
+size_t PlyReader::elementSize(const Element& element, size_t offset) const {
+  if (element.stride != 0) return element.count * element.stride;
+  // Records with lists have to be walked one by one.
+  size_t start = offset;
+  for (size_t i = 0; i < element.count; i++) {
+    for (const Property& property : element.properties) {
+      if (property.isList) {
+        // The count itself has to be in the file before it can be read.
+        if (offset + typeSize(property.countType) > file.size()) {
+          throw std::runtime_error("Truncated ply file.");
+        }
+        size_t count = loadCount(file.data() + offset, property.countType);
+        offset += typeSize(property.countType) + count * typeSize(property.type);
+      } else {
+        offset += typeSize(property.type);
+      }
+      if (offset > file.size()) {
+        throw std::runtime_error("Truncated ply file.");
+      }
+    }
+  }
+  return offset - start;
+}
+
+size_t PlyReader::elementOffset(const Element& target) const {
+  size_t offset = dataOffset;
+  for (const Element& element : elements) {
+    if (&element == &target) return offset;
+    offset += elementSize(element, offset);
+  }
+  throw std::runtime_error("Element " + target.name + " is not part of this file.");
+}
+
+template <typename Scalar>
+void PlyReader::readColumns(const std::string& elementName, const std::array<std::string, 3>& names,
+                            Eigen::Matrix<Scalar, Eigen::Dynamic, 3, Eigen::RowMajor>& out, float scale) const {
+  const Element* element = getElement(elementName);
+  if (element == nullptr || element->stride == 0) {
+    throw std::runtime_error("Ply element " + elementName + " is missing or has variable size records.");
+  }
+  std::array<size_t, 3> offsets;
+  const Property* first = nullptr;
+  for (int i = 0; i < 3; i++) {
+    const Property* property = getProperty(elementName, names[i]);
+    if (property == nullptr) {
+      throw std::runtime_error("Ply property " + names[i] + " is missing.");
+    }
+    if (first != nullptr && property->type != first->type) {
+      throw std::runtime_error("Ply properties read together have to share a type.");
+    }
+    first = property;
+    offsets[i] = property->offset;
+  }
+
+  size_t offset = elementOffset(*element);
+  if (offset + element->count * element->stride > file.size()) {
+    throw std::runtime_error("Truncated ply file.");
+  }
+  out.resize(element->count, 3);
+  copyColumns(first->type, file.data() + offset, element->count, element->stride, offsets, scale, out.data());
+}
+
+template <typename Scalar>
+void PlyReader::readColors(Eigen::Matrix<Scalar, Eigen::Dynamic, 3, Eigen::RowMajor>& out) const {
+  const Property* red = getProperty("vertex", "red");
+  float scale = red != nullptr && isFloatingPoint(red->type) ? 255.0f : 1.0f;
+  readColumns("vertex", {"red", "green", "blue"}, out, scale);
+}
+
+bool PlyReader::readTriangles(Eigen::Matrix<uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>& out) const {
+  const Element* element = getElement("face");
+  if (element == nullptr) {
+    out.resize(0, 3);
+    return true;
+  }
+  // Assume every face is a triangle, which makes the records fixed size, then verify.
+  size_t stride = 0;
+  size_t listOffset = 0;
+  const Property* list = nullptr;
+  for (const Property& property : element->properties) {
+    if (property.isList) {
+      if (list != nullptr) return false;
+      list = &property;
+      listOffset = stride;
+      stride += typeSize(property.countType) + 3 * typeSize(property.type);
+    } else {
+      stride += typeSize(property.type);
+    }
+  }
+  if (list == nullptr || isFloatingPoint(list->type) || isFloatingPoint(list->countType)) return false;
+
+  size_t offset = elementOffset(*element);
+  if (offset + element->count * stride > file.size()) return false;
+  const uint8_t* data = file.data() + offset;
+  const size_t count = element->count;
+  const Type countType = list->countType;
+  bool triangles = true;
+#pragma omp parallel for reduction(&& : triangles)
+  for (size_t i = 0; i < count; i++) {
+    triangles = triangles && loadCount(data + i * stride + listOffset, countType) == 3;
+  }
+  if (!triangles) return false;
+
+  std::array<size_t, 3> offsets;
+  size_t itemSize = typeSize(list->type);
+  for (size_t j = 0; j < 3; j++) {
+    offsets[j] = listOffset + typeSize(countType) + j * itemSize;
+  }
+  out.resize(count, 3);
+  copyColumns(list->type, data, count, stride, offsets, 1.0f, out.data());
+  return true;
+}
+
+template void PlyReader::readColumns<float>(const std::string&, const std::array<std::string, 3>&,
+                                            Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>&, float) const;
+template void PlyReader::readColumns<uint8_t>(const std::string&, const std::array<std::string, 3>&,
+                                              Eigen::Matrix<uint8_t, Eigen::Dynamic, 3, Eigen::RowMajor>&, float) const;
+template void PlyReader::readColumns<uint32_t>(const std::string&, const std::array<std::string, 3>&,
+                                               Eigen::Matrix<uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>&, float) const;
+template void PlyReader::readColors<uint8_t>(Eigen::Matrix<uint8_t, Eigen::Dynamic, 3, Eigen::RowMajor>&) const;
+template void PlyReader::readColors<uint32_t>(Eigen::Matrix<uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>&) const;
+
+} // namespace geometry
@@ -1,38 +1,219 @@
+#include <nanoflann.hpp>
+#include <eigen3/Eigen/Eigenvalues>
 #include "3rdparty/happly.h"
 #include "geometry/point_cloud.h"
+#include "geometry/ply_reader.h"
 
 namespace geometry {
-PointCloud::PointCloud(const std::string& filepath) {
+
+const size_t NormalNeighbours = 30;
+const float MinNormalLength = 1e-6f;
+
+template <typename T>
+struct PCAdaptor {
+  const RowMatrixf& pointCloud;
+  PCAdaptor(const RowMatrixf& pc) : pointCloud(pc) {}
+
+  using coord_t = T;
+  inline uint32_t kdtree_get_point_count() const { return pointCloud.rows(); };
+  inline T kdtree_get_pt(const uint32_t idx, const uint32_t dim) const {
+    return pointCloud(idx, dim);
+  }
+  template <class BBOX>
+  bool kdtree_get_bbox(BBOX& ) const { return false; }
+};
+
+// The index type is spelled out, as its default differs between nanoflann versions.
+using KDTreeIndex = uint32_t;
+using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
+  nanoflann::L2_Simple_Adaptor<float, PCAdaptor<float>, float>,
+  PCAdaptor<float>, 3, KDTreeIndex>;
+PointCloud::PointCloud(const std::string& filepath, bool quantizePositions) {
+  PlyReader reader(filepath);
+  if (reader.isBinaryLittleEndian()) {
+    reader.readColumns("vertex", {"x", "y", "z"}, points);
+    if (reader.hasProperty("vertex", "red")) {
+      reader.readColors(colors);
+    } else {
+      colors = RowMatrixu8::Constant(points.rows(), 3, 255);
+    }
+    if (reader.hasProperty("vertex", "nx")) {
+      reader.readColumns("vertex", {"nx", "ny", "nz"}, normals);
+      normalizeNormals();
+    }
+    if (quantizePositions) quantize();
+    return;
+  }
+
+  // Ascii and big endian files go through happly.
   happly::PLYData plyIn(filepath);
   const auto& vertices = plyIn.getVertexPositions();
   const auto& vertexColors = plyIn.getVertexColors();
   points.resize(vertices.size(), 3);
   colors.resize(vertexColors.size(), 3);
 
+#pragma omp parallel for
   for (unsigned int i = 0; i < vertices.size(); i++) {
     for (uint8_t j = 0; j < 3; j++) {
       points(i, j) = vertices[i][j];
       colors(i, j) = vertexColors[i][j];
     }
   }
+
+  happly::Element& vertexElement = plyIn.getElement("vertex");
+  if (vertexElement.hasProperty("nx")) {
+    std::vector<float> nx = vertexElement.getProperty<float>("nx");
+    std::vector<float> ny = vertexElement.getProperty<float>("ny");
+    std::vector<float> nz = vertexElement.getProperty<float>("nz");
+    normals.resize(nx.size(), 3);
+#pragma omp parallel for
+    for (unsigned int i = 0; i < nx.size(); i++) {
+      normals(i, 0) = nx[i];
+      normals(i, 1) = ny[i];
+      normals(i, 2) = nz[i];
+    }
+    normalizeNormals();
+  }
+  if (quantizePositions) quantize();
+}
+
+void PointCloud::normalizeNormals() {
+  // Exporters write zero or unnormalized normals, those too short to have a direction are estimated instead.
+  size_t missing = 0;
+#pragma omp parallel for reduction(+ : missing)
+  for (int64_t i = 0; i < int64_t(normals.rows()); i++) {
+    float length = normals.row(i).norm();
+    if (length > MinNormalLength) {
+      normals.row(i) /= length;
+    } else {
+      normals.row(i).setZero();
+      missing++;
+    }
+  }
+  missingNormals = missing;
+}
+
+void PointCloud::quantize() {
+  if (points.rows() == 0) return;
+  Eigen::Vector3f min = points.colwise().minCoeff().transpose();
+  Eigen::Vector3f max = points.colwise().maxCoeff().transpose();
+  quantization.center = 0.5f * (min + max);
+  for (int j = 0; j < 3; j++) {
+    float halfExtent = 0.5f * (max[j] - min[j]);
+    // A flat axis has every point at the center.
+    quantization.scale[j] = halfExtent > 0.0f ? halfExtent / PositionQuantization::Range : 1.0f;
+  }
+
+  const Eigen::Array3f inverseScale = quantization.scale.cwiseInverse().array();
+  quantizedPoints.resize(points.rows(), 3);
+#pragma omp parallel for
+  for (int64_t i = 0; i < int64_t(points.rows()); i++) {
+    Eigen::Array3f q = (points.row(i).transpose() - quantization.center).array() * inverseScale;
+    q = q.round().max(-PositionQuantization::Range).min(PositionQuantization::Range);
+    quantizedPoints.row(i) = q.cast<int16_t>().transpose();
+  }
+  points.resize(0, 3);
+}
+
+static RowMatrixf fitNormals(const RowMatrixf& points) {
+  PCAdaptor<float> adaptor(points);
+#if NANOFLANN_VERSION >= 0x140
+  KDTree index(3, adaptor, nanoflann::KDTreeSingleIndexAdaptorParams(10, nanoflann::KDTreeSingleIndexAdaptorFlags::SkipInitialBuildIndex));
+#else
+  KDTree index(3, adaptor, nanoflann::KDTreeSingleIndexAdaptorParams(10));
+#endif
+  index.buildIndex();
+
+  RowMatrixf estimated(points.rows(), 3);
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t i = 0; i < int64_t(points.rows()); i++) {
+    KDTreeIndex neighbours[NormalNeighbours];
+    float distances[NormalNeighbours];
+    const float* query = points.row(i).data();
+    size_t found = index.knnSearch(query, NormalNeighbours, &neighbours[0], &distances[0]);
+    if (found < 3) {
+      estimated.row(i) = Eigen::RowVector3f::UnitZ();
+      continue;
+    }
+
+    Eigen::Vector3f mean = Eigen::Vector3f::Zero();
+    for (size_t j = 0; j < found; j++) {
+      mean += points.row(neighbours[j]).transpose();
+    }
+    mean /= float(found);
+    Eigen::Matrix3f covariance = Eigen::Matrix3f::Zero();
+    for (size_t j = 0; j < found; j++) {
+      Eigen::Vector3f centered = points.row(neighbours[j]).transpose() - mean;
+      covariance += centered * centered.transpose();
+    }
+
+    // Closed form solve of the 3x3 system, eigenvalues come in increasing order.
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> solver;
+    solver.computeDirect(covariance);
+    estimated.row(i) = solver.eigenvectors().col(0).normalized().transpose();
+  }
+  return estimated;
+}
+
+void PointCloud::estimateNormals() {
+  RowMatrixf estimated;
+  if (!isQuantized()) {
+    estimated = fitNormals(points);
+  } else {
+    // The kd-tree needs float positions, only decode them for the duration of the fit.
+    RowMatrixf decoded(size(), 3);
+#pragma omp parallel for
+    for (int64_t i = 0; i < int64_t(size()); i++) {
+      decoded.row(i) = point(i).transpose();
+    }
+    estimated = fitNormals(decoded);
+  }
+
+  if (size_t(normals.rows()) == size()) {
+    // Only the normals the file was missing are replaced.
+#pragma omp parallel for
+    for (int64_t i = 0; i < int64_t(size()); i++) {
+      if (normals.row(i).isZero()) normals.row(i) = estimated.row(i);
+    }
+  } else {
+    normals = std::move(estimated);
+  }
+  missingNormals = 0;
+}
+
+void PointCloud::setNormals(RowMatrixf estimated) {
+  normals = std::move(estimated);
+  missingNormals = 0;
+}
+
+template <typename Matrix>
+Eigen::RowVector3f columnStd(const Matrix& values) {
+  Eigen::RowVector3f mean = values.colwise().mean();
+  Eigen::RowVector3f sumOfSquares = (values.rowwise() - mean).array().square().colwise().sum();
+  return (sumOfSquares / float(values.rows() - 1)).cwiseSqrt();
 }
 
 Eigen::RowVector3f PointCloud::getMean() const {
+  if (isQuantized()) {
+    // Quantization is affine, so take the mean of the integers and map it back.
+    Eigen::RowVector3f mean = quantizedPoints.cast<float>().colwise().mean();
+    return quantization.center.transpose() + mean.cwiseProduct(quantization.scale.transpose());
+  }
   Eigen::RowVector3f mean = points.colwise().mean();
   return mean;
 }
 
 Eigen::RowVector3f PointCloud::getStd() const {
-  Eigen::VectorXf x = points.col(0);
-  Eigen::VectorXf y = points.col(1);
-  Eigen::VectorXf z = points.col(2);
-
-  float std_x = std::sqrt(((x - x.mean() * Eigen::VectorXf::Ones(x.size())).array().square().sum() / (x.size() - 1)));
-  float std_y = std::sqrt(((y - y.mean() * Eigen::VectorXf::Ones(y.size())).array().square().sum() / (y.size() - 1)));
-  float std_z = std::sqrt(((z - z.mean() * Eigen::VectorXf::Ones(z.size())).array().square().sum() / (z.size() - 1)));
+  if (isQuantized()) {
+    return columnStd(quantizedPoints.cast<float>()).cwiseProduct(quantization.scale.transpose());
+  }
+  return columnStd(points);
+}
 
-  Eigen::RowVector3f std(std_x, std_y, std_z);
-  return std;
+size_t PointCloud::sizeInBytes() const {
+  return (points.size() + normals.size()) * sizeof(RowMatrixf::Scalar) +
+         quantizedPoints.size() * sizeof(RowMatrixi16::Scalar) +
+         colors.size() * sizeof(RowMatrixu8::Scalar);
 }
 
 } // namespace geometry
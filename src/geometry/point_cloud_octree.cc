@@ -0,0 +1,193 @@
+#include <cmath>
+#include <queue>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include "geometry/point_cloud_octree.h"
+
+namespace geometry {
+
+namespace {
+// Below this many points a node is partitioned on a single thread.
+const int64_t ParallelThreshold = 1 << 16;
+
+using Planes = std::array<Eigen::Vector4f, 6>;
+
+Planes frustumPlanes(const Eigen::Matrix4f& viewProjection) {
+  // Gribb & Hartmann. The near plane is taken at z = -w, which is also
+  // conservative for projections with [0, 1] depth.
+  Eigen::Vector4f x = viewProjection.row(0).transpose();
+  Eigen::Vector4f y = viewProjection.row(1).transpose();
+  Eigen::Vector4f z = viewProjection.row(2).transpose();
+  Eigen::Vector4f w = viewProjection.row(3).transpose();
+  return {w + x, w - x, w + y, w - y, w + z, w - z};
+}
+
+bool intersectsFrustum(const Planes& planes, const OctreeNode& node) {
+  for (const Eigen::Vector4f& plane : planes) {
+    // Distance of the corner of the cube furthest along the plane normal.
+    float distance = plane.head<3>().dot(node.center) + plane[3] + node.halfSize * plane.head<3>().cwiseAbs().sum();
+    if (distance < 0.0f) return false;
+  }
+  return true;
+}
+
+float pointSpacing(float halfSize, size_t count) {
+  return 2.0f * halfSize / std::sqrt(float(std::max(count, size_t(1))));
+}
+} // namespace
+
+PointCloudOctree::PointCloudOctree(const PointCloud& pointCloud, OctreeOptions opts) : options(opts) {
+  const int64_t count = int64_t(pointCloud.size());
+  order.resize(count);
+  std::iota(order.begin(), order.end(), 0);
+  if (count == 0) return;
+
+  Eigen::Vector3f min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+  Eigen::Vector3f max = -min;
+#pragma omp parallel
+  {
+    Eigen::Vector3f threadMin = min;
+    Eigen::Vector3f threadMax = max;
+#pragma omp for nowait
+    for (int64_t i = 0; i < count; i++) {
+      Eigen::Vector3f point = pointCloud.point(i);
+      threadMin = threadMin.cwiseMin(point);
+      threadMax = threadMax.cwiseMax(point);
+    }
+#pragma omp critical
+    {
+      min = min.cwiseMin(threadMin);
+      max = max.cwiseMax(threadMax);
+    }
+  }
+
+  OctreeNode root;
+  root.center = 0.5f * (min + max);
+  root.halfSize = std::max(0.5f * (max - min).maxCoeff(), 1e-6f);
+  root.begin = 0;
+  root.count = uint32_t(count);
+  root.children.fill(-1);
+  root.depth = 0;
+  nodes.push_back(root);
+  build(pointCloud, 0);
+}
+
+void PointCloudOctree::build(const PointCloud& pointCloud, uint32_t nodeIndex) {
+  const OctreeNode node = nodes[nodeIndex];
+  if (node.count <= options.nodeCapacity || node.depth >= options.maxDepth) {
+    nodes[nodeIndex].spacing = pointSpacing(node.halfSize, node.count);
+    largestNode = std::max(largestNode, size_t(node.count));
+    return;
+  }
+
+  // Keep every stride-th point. Clouds are usually stored in scan order, so
+  // this thins them out about evenly over the surface.
+  const int64_t count = node.count;
+  const int64_t stride = (count + options.nodeCapacity - 1) / options.nodeCapacity;
+  uint32_t* points = order.data() + node.begin;
+  std::vector<uint8_t> buckets(count);
+#pragma omp parallel for if (count > ParallelThreshold)
+  for (int64_t i = 0; i < count; i++) {
+    if (i % stride == 0) {
+      buckets[i] = 8;
+      continue;
+    }
+    Eigen::Vector3f point = pointCloud.point(points[i]);
+    buckets[i] = uint8_t(point[0] >= node.center[0]) |
+                 uint8_t(point[1] >= node.center[1]) << 1 |
+                 uint8_t(point[2] >= node.center[2]) << 2;
+  }
+
+  // Stable counting sort, the points kept in this node go first, then one range per octant.
+  std::array<uint32_t, 9> sizes = {};
+  for (uint8_t bucket : buckets) {
+    sizes[bucket]++;
+  }
+  std::array<uint32_t, 9> offsets;
+  offsets[8] = 0;
+  uint32_t offset = sizes[8];
+  for (int octant = 0; octant < 8; octant++) {
+    offsets[octant] = offset;
+    offset += sizes[octant];
+  }
+  std::vector<uint32_t> sorted(count);
+  std::array<uint32_t, 9> positions = offsets;
+  for (int64_t i = 0; i < count; i++) {
+    sorted[positions[buckets[i]]++] = points[i];
+  }
+  std::copy(sorted.begin(), sorted.end(), points);
+
+  nodes[nodeIndex].count = sizes[8];
+  nodes[nodeIndex].spacing = pointSpacing(node.halfSize, sizes[8]);
+  largestNode = std::max(largestNode, size_t(sizes[8]));
+
+  const float childHalfSize = 0.5f * node.halfSize;
+  std::vector<uint32_t> children;
+  for (int octant = 0; octant < 8; octant++) {
+    if (sizes[octant] == 0) continue;
+    OctreeNode child;
+    for (int axis = 0; axis < 3; axis++) {
+      child.center[axis] = node.center[axis] + ((octant >> axis) & 1 ? childHalfSize : -childHalfSize);
+    }
+    child.halfSize = childHalfSize;
+    child.begin = node.begin + offsets[octant];
+    child.count = sizes[octant];
+    child.children.fill(-1);
+    child.depth = node.depth + 1;
+    nodes[nodeIndex].children[octant] = int32_t(nodes.size());
+    children.push_back(uint32_t(nodes.size()));
+    nodes.push_back(child);
+  }
+  for (uint32_t child : children) {
+    build(pointCloud, child);
+  }
+}
+
+std::span<const uint32_t> PointCloudOctree::nodePoints(uint32_t node) const {
+  return {order.data() + nodes[node].begin, nodes[node].count};
+}
+
+size_t PointCloudOctree::sizeInBytes() const {
+  return nodes.size() * sizeof(OctreeNode) + order.size() * sizeof(uint32_t);
+}
+
+float PointCloudOctree::screenSpaceError(const OctreeNode& node, const LODQuery& query) const {
+  const float radius = node.halfSize * std::sqrt(3.0f);
+  float distance = (node.center - query.eye).norm() - radius;
+  if (distance <= 0.0f) {
+    // Inside the node, always refine.
+    return std::numeric_limits<float>::max();
+  }
+  return node.spacing / distance * query.pixelsPerUnit;
+}
+
+std::vector<uint32_t> PointCloudOctree::select(const LODQuery& query) const {
+  std::vector<uint32_t> selected;
+  if (nodes.empty()) return selected;
+  const Planes planes = frustumPlanes(query.viewProjection);
+
+  // Largest screen space error first.
+  std::priority_queue<std::pair<float, uint32_t>> candidates;
+  if (intersectsFrustum(planes, nodes[0])) {
+    candidates.push({screenSpaceError(nodes[0], query), 0});
+  }
+  size_t points = 0;
+  while (!candidates.empty()) {
+    auto [error, index] = candidates.top();
+    candidates.pop();
+    const OctreeNode& node = nodes[index];
+    if (points + node.count > query.pointBudget) break;
+    points += node.count;
+    selected.push_back(index);
+    if (error <= query.maxScreenSpaceError) continue;
+
+    for (int32_t child : node.children) {
+      if (child < 0 || !intersectsFrustum(planes, nodes[child])) continue;
+      candidates.push({screenSpaceError(nodes[child], query), uint32_t(child)});
+    }
+  }
+  return selected;
+}
+
+} // namespace geometry
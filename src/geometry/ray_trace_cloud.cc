@@ -1,108 +1,203 @@
 #include "geometry/ray_trace_cloud.h"
 #include <iostream>
+#include <stdexcept>
 
 using namespace geometry;
 using namespace particle_tracing;
 
-const uint32_t FindClosest = 50;
-uint32_t closestIndices[FindClosest];
-float distances[FindClosest];
+namespace {
+// Sphere centers stored as 16 bit integers, see PositionQuantization.
+struct QuantizedPoints {
+  const int16_t* values;
+  PositionQuantization quantization;
+  float3 operator[](unsigned int i) const {
+    Vector3f point = quantization.decode(&values[3 * i]);
+    return float3(point[0], point[1], point[2]);
+  }
+};
+
+// Calls f with an accessor for the storage the point positions are kept in.
+template <typename F>
+auto visitPoints(const PointCloud& pointCloud, F&& f) {
+  if (pointCloud.isQuantized()) {
+    return f(QuantizedPoints{pointCloud.quantizedPoints.data(), pointCloud.quantization});
+  }
+  return f(FloatPoints{pointCloud.points.data()});
+}
+
+// Same sphere test as SphereIntersector, against every point.
+template <class Points>
+std::optional<uint32_t> closestHitBruteForce(const Points& points, size_t pointCount, const Vector3f& origin,
+                                             const Vector3f& direction, float pointRadius) {
+  const float a = direction.dot(direction);
+  float closestT = std::numeric_limits<float>::max();
+  int64_t closestIndex = -1;
+#pragma omp parallel
+  {
+    float threadT = std::numeric_limits<float>::max();
+    int64_t threadIndex = -1;
+#pragma omp for nowait
+    for (int64_t i = 0; i < int64_t(pointCount); i++) {
+      const float3 center = points[i];
+      Vector3f oc = origin - Vector3f(center[0], center[1], center[2]);
+      float b = 2.0f * direction.dot(oc);
+      float c = oc.dot(oc) - pointRadius * pointRadius;
+      float disc = b * b - 4.0f * a * c;
+      if (disc < 0.0f) continue;
+      float distSqrt = std::sqrt(disc);
+      float t0 = (-b - distSqrt) / (2.0f * a);
+      float t1 = (-b + distSqrt) / (2.0f * a);
+      if (t1 < 0.0f) continue;
+      float t = t0 < 0.0f ? t1 : t0;
+      if (t < threadT) {
+        threadT = t;
+        threadIndex = i;
+      }
+    }
+#pragma omp critical
+    if (threadIndex >= 0 && (threadT < closestT || (threadT == closestT && threadIndex < closestIndex))) {
+      closestT = threadT;
+      closestIndex = threadIndex;
+    }
+  }
+  if (closestIndex < 0) return {};
+  return uint32_t(closestIndex);
+}
+} // namespace
 
-RayTraceCloud::RayTraceCloud(std::shared_ptr<geometry::PointCloud> pc, float& size) : pointCloud(pc), pointSize(size),
-                                                                                      adaptor(pointCloud->points),
-                                                                                      index(3, adaptor, {10}) {
+RayTraceCloud::RayTraceCloud(std::shared_ptr<geometry::PointCloud> pc, const std::filesystem::path& source) : pointCloud(pc),
+                                                                                                             sourceFile(source) {}
+
+void RayTraceCloud::build() {
+  if (sourceFile.empty()) {
+    buildIndices();
+  } else {
+    IndexCache cache(sourceFile, pointCloud->isQuantized() ? IndexKind::QuantizedPointCloud : IndexKind::PointCloud);
+    if (!cache.load() || !loadIndices(cache)) {
+      buildIndices();
+      saveIndices(cache);
+    }
+  }
+  ready.store(true, std::memory_order_release);
+}
+
+void RayTraceCloud::buildIndices() {
   nanort::BVHBuildOptions<float> options;
   options.cache_bbox = false;
-  RowMatrixf vertices = pointCloud->points;
-  SphereGeometry sphereGeometry(vertices.data(), 0.01);
-  SpherePred spherePredicate(vertices.data());
-  bool ret = bvh.Build(vertices.rows(), sphereGeometry, spherePredicate, options);
+  bool ret = visitPoints(*pointCloud, [&](const auto& points) {
+    using Points = std::decay_t<decltype(points)>;
+    SphereGeometry<Points> sphereGeometry(points, 0.01);
+    SpherePred<Points> spherePredicate(points);
+    return bvh.Build(pointCloud->size(), sphereGeometry, spherePredicate, options);
+  });
   if (!ret) {
-    std::cout << "Failed to initialize bounding volume hierarchy" << std::endl;
-    exit(1);
+    throw std::runtime_error("Failed to initialize bounding volume hierarchy");
+  }
+  if (!pointCloud->hasNormals()) {
+    pointCloud->estimateNormals();
+    normalsEstimated = true;
   }
-  index.buildIndex();
 }
 
-Vector3f estimateNormal(const RowVector3f& queryPoint, const RowMatrixf& points, uint32_t* indices) {
-  Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor> ps(FindClosest, 3);
-  for (uint32_t i = 0; i < FindClosest; i++) {
-    ps.row(i) = points.row(indices[i]);
-  }
+bool RayTraceCloud::loadIndices(const IndexCache& cache) {
+  auto nodes = cache.getArray<nanort::BVHNode<float>>(IndexSection::BVHNodes);
+  auto indices = cache.getArray<unsigned int>(IndexSection::BVHIndices);
+  const size_t pointCount = pointCloud->size();
+  if (indices.size() != pointCount) return false;
 
-  RowVector3f centroid = ps.colwise().mean();
+  if (!pointCloud->hasNormals()) {
+    auto normals = cache.getArray<float>(IndexSection::PointNormals);
+    if (normals.size() != pointCount * 3) return false;
+    pointCloud->setNormals(Eigen::Map<const RowMatrixf>(normals.data(), pointCount, 3));
+  }
+  return bvh.Load(nodes.data(), nodes.size(), indices.data(), indices.size());
+}
 
-  for (uint32_t i = 0; i < FindClosest; i++) {
-    ps.row(i) = ps.row(i) - centroid;
+void RayTraceCloud::saveIndices(IndexCache& cache) const {
+  cache.setArray(IndexSection::BVHNodes, bvh.GetNodes());
+  cache.setArray(IndexSection::BVHIndices, bvh.GetIndices());
+  // Normals read from the file itself are not worth duplicating.
+  if (normalsEstimated) {
+    const RowMatrixf& normals = pointCloud->normals;
+    cache.setSection(IndexSection::PointNormals, normals.data(), normals.size() * sizeof(float));
   }
+  cache.save();
+}
 
-  auto svd = ps.transpose().jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV);
-  Vector3f normal = svd.matrixU().col(2);
-  return normal.normalized();
+size_t RayTraceCloud::sizeInBytes() const {
+  if (!isReady()) return 0;
+  return bvh.GetNodes().size() * sizeof(nanort::BVHNode<float>) + bvh.GetIndices().size() * sizeof(unsigned int);
 }
 
-Intersection RayTraceCloud::traceRayIntersection(const Vector3f& origin, const Vector3f& direction) const {
-  if (pointCloud == nullptr) return {false, Vector3f::Zero(), Vector3f::Zero()};
-  nanort::Ray<float> ray;
-  ray.min_t = 0.0;
-  ray.max_t = 1e9f;
-  ray.org[0] = origin[0];
-  ray.org[1] = origin[1];
-  ray.org[2] = origin[2];
+std::optional<uint32_t> RayTraceCloud::closestHit(const Vector3f& origin, const Vector3f& direction, float pointSize, bool built) const {
+  if (pointCloud == nullptr) return {};
+  float pointRadius = 0.005f * pointSize;
 
-  ray.dir[0] = direction[0];
-  ray.dir[1] = direction[1];
-  ray.dir[2] = direction[2];
+  return visitPoints(*pointCloud, [&](const auto& points) -> std::optional<uint32_t> {
+    if (!built) {
+      return closestHitBruteForce(points, pointCloud->size(), origin, direction, pointRadius);
+    }
 
-  float pointRadius = 0.005f * pointSize;
-  const float* points = &pointCloud->points.data()[0];
-  SphereIntersector<SphereIntersection> intersector(points, pointRadius);
-  SphereIntersection intersection;
-  bool hit = bvh.Traverse(ray, intersector, &intersection);
-  if (hit) {
-    unsigned int pointId = intersection.prim_id;
-    RowVector3f position = pointCloud->points.row(pointId);
-
-    nanoflann::KNNResultSet<float, uint32_t, uint32_t> resultSet(FindClosest);
-    resultSet.init(&closestIndices[0], &distances[0]);
-    float queryPoint[3] = {position[0], position[1], position[2]};
-    index.findNeighbors(resultSet, &queryPoint[0], nanoflann::SearchParams(10));
-    Vector3f normal = estimateNormal(position, pointCloud->points, &closestIndices[0]).normalized();
-
-    // If the normal is pointing in the same direction as the ray,
-    // the normal is on the wrong side and we should flip it.
-    if (direction.dot(normal) < 0.0) {
-      normal = -normal;
+    nanort::Ray<float> ray;
+    ray.min_t = 0.0;
+    ray.max_t = 1e9f;
+    ray.org[0] = origin[0];
+    ray.org[1] = origin[1];
+    ray.org[2] = origin[2];
+
+    ray.dir[0] = direction[0];
+    ray.dir[1] = direction[1];
+    ray.dir[2] = direction[2];
+
+    SphereIntersector<SphereIntersection, std::decay_t<decltype(points)>> intersector(points, pointRadius);
+    SphereIntersection intersection;
+    bool hit = bvh.Traverse(ray, intersector, &intersection);
+    if (hit) {
+      return intersection.prim_id;
     }
+    return {};
+  });
+}
 
-    return {true, position, normal};
-  } else {
+Intersection RayTraceCloud::intersect(const Vector3f& origin, const Vector3f& direction, float pointSize, bool built) const {
+  std::optional<uint32_t> pointId = closestHit(origin, direction, pointSize, built);
+  if (!pointId.has_value()) {
     return {false, Vector3f::Zero(), Vector3f::Zero()};
   }
-}
+  Vector3f position = pointCloud->point(*pointId);
+  if (!built) {
+    // Normals might still be being estimated.
+    return {true, position, direction.normalized()};
+  }
 
-std::optional<Vector3f> RayTraceCloud::traceRay(const Vector3f& origin, const Vector3f& direction) const {
-  if (pointCloud == nullptr) return {};
-  nanort::Ray<float> ray;
-  ray.min_t = 0.0;
-  ray.max_t = 1e9f;
-  ray.org[0] = origin[0];
-  ray.org[1] = origin[1];
-  ray.org[2] = origin[2];
+  Vector3f normal = pointCloud->normals.row(*pointId).transpose();
+  // If the normal is pointing in the same direction as the ray,
+  // the normal is on the wrong side and we should flip it.
+  if (direction.dot(normal) < 0.0) {
+    normal = -normal;
+  }
 
-  ray.dir[0] = direction[0];
-  ray.dir[1] = direction[1];
-  ray.dir[2] = direction[2];
+  return {true, position, normal};
+}
 
-  float pointRadius = 0.005f * pointSize;
-  const float* points = &pointCloud->points.data()[0];
-  SphereIntersector<SphereIntersection> intersector(points, pointRadius);
-  SphereIntersection intersection;
-  bool hit = bvh.Traverse(ray, intersector, &intersection);
-  if (hit) {
-    unsigned int pointId = intersection.prim_id;
-    RowVector3f position = pointCloud->points.row(pointId);
-    return position.transpose();
+Intersection RayTraceCloud::traceRayIntersection(const Vector3f& origin, const Vector3f& direction, float pointSize) const {
+  return intersect(origin, direction, pointSize, isReady());
+}
+
+std::vector<Intersection> RayTraceCloud::traceRays(std::span<const Ray> rays, float pointSize) const {
+  std::vector<Intersection> intersections(rays.size());
+  const bool built = isReady();
+  // Before the BVH is ready each ray is a full scan, the nested parallel region in
+  // closestHitBruteForce then runs on a single thread and rays are spread instead.
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int64_t i = 0; i < int64_t(rays.size()); i++) {
+    intersections[i] = intersect(rays[i].origin, rays[i].direction, pointSize, built);
   }
-  return {};
+  return intersections;
+}
+
+std::optional<Vector3f> RayTraceCloud::traceRay(const Vector3f& origin, const Vector3f& direction, float pointSize) const {
+  std::optional<uint32_t> pointId = closestHit(origin, direction, pointSize, isReady());
+  if (!pointId.has_value()) return {};
+  return pointCloud->point(*pointId);
 }
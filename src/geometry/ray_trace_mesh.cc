@@ -1,12 +1,49 @@
+#include <limits>
 #include <iostream>
 #include "geometry/ray_trace_mesh.h"
 
 namespace geometry {
-RayTraceMesh::RayTraceMesh(std::shared_ptr<geometry::TriangleMesh> m) : nanoMesh(m->vertices().data(), m->faces().data(), sizeof(float) * 3) {
+// Bounds of the vertices used by faces, which the root of the BVH covers exactly.
+static std::pair<Vector3f, Vector3f> faceBounds(const TriangleMesh& mesh) {
+  Vector3f min = Vector3f::Constant(std::numeric_limits<float>::infinity());
+  Vector3f max = -min;
+  const auto& faces = mesh.faces();
+  const auto& vertices = mesh.vertices();
+  for (Eigen::Index i = 0; i < faces.size(); i++) {
+    Vector3f vertex = vertices.row(faces.data()[i]).transpose();
+    min = min.cwiseMin(vertex);
+    max = max.cwiseMax(vertex);
+  }
+  return {min, max};
+}
+
+RayTraceMesh::RayTraceMesh(std::shared_ptr<geometry::TriangleMesh> m, const std::filesystem::path& sourceFile) : nanoMesh(m->vertices().data(), m->faces().data(), sizeof(float) * 3) {
   mesh = m;
+  std::optional<IndexCache> cache;
+  if (!sourceFile.empty()) {
+    cache.emplace(sourceFile, IndexKind::TriangleMesh);
+    if (cache->load()) {
+      auto nodes = cache->getArray<nanort::BVHNode<float>>(IndexSection::BVHNodes);
+      auto indices = cache->getArray<unsigned int>(IndexSection::BVHIndices);
+      // The mesh may have been scaled or transformed while loading, the root bounds catch that.
+      bool matches = indices.size() == size_t(mesh->faces().rows()) && !nodes.empty();
+      if (matches) {
+        auto [min, max] = faceBounds(*mesh);
+        matches = Vector3f(nodes[0].bmin).isApprox(min) && Vector3f(nodes[0].bmax).isApprox(max);
+      }
+      if (matches && bvh.Load(nodes.data(), nodes.size(), indices.data(), indices.size())) {
+        return;
+      }
+    }
+  }
   nanort::TriangleSAHPred<float> trianglePred(mesh->vertices().data(), mesh->faces().data(), sizeof(float) * 3);
   nanort::BVHBuildOptions<float> build_options;
   bvh.Build(mesh->faces().rows(), nanoMesh, trianglePred, build_options);
+  if (cache.has_value()) {
+    cache->setArray(IndexSection::BVHNodes, bvh.GetNodes());
+    cache->setArray(IndexSection::BVHIndices, bvh.GetIndices());
+    cache->save();
+  }
 }
 
 Intersection RayTraceMesh::traceRayIntersection(const Vector3f& origin, const Vector3f& direction) const {
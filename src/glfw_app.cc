@@ -1,4 +1,5 @@
 #include "glfw_app.h"
+#include "utils/main_loop.h"
 #include <bgfx/platform.h>
 #include <bx/handlealloc.h>
 #include <bx/thread.h>
@@ -88,9 +89,12 @@ GLFWApp::GLFWApp(std::string name, int w, int h) : width(w), height(h) {
   }
   glfwShowWindow(window);
   glfwGetWindowSize(window, &width, &height);
+  // Background threads wake the event loop when their work is done.
+  utils::main_loop::setWake([]() { glfwPostEmptyEvent(); });
 }
 
 GLFWApp::~GLFWApp() {
+  utils::main_loop::setWake(nullptr);
   view = nullptr;
   bgfx::shutdown();
   glfwDestroyWindowImpl(window);
@@ -0,0 +1,29 @@
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "model/dataset_index.h"
+#include "utils/dataset.h"
+
+namespace model {
+
+DatasetIndex::DatasetIndex(const fs::path& datasetPath) : path(datasetPath),
+                                                          camera(datasetPath / "camera_intrinsics.json") {
+  if (fs::exists(path / "color")) {
+    imagePaths = utils::dataset::getDatasetImagePaths(path / "color");
+  }
+  if (fs::exists(path / "scene" / "trajectory.log")) {
+    cameraPoses = utils::dataset::getDatasetCameraTrajectory(path / "scene" / "trajectory.log");
+  }
+  if (imagePaths.size() != cameraPoses.size()) {
+    std::cout << "Dataset has " << imagePaths.size() << " color images but " << cameraPoses.size()
+              << " camera poses, using the first " << size() << " frames." << std::endl;
+  }
+}
+
+size_t DatasetIndex::frameAt(float t) const {
+  if (empty()) return 0;
+  t = std::clamp(t, 0.0f, 1.0f);
+  return std::min(size_t(std::floor(t * float(size()))), size() - 1);
+}
+
+} // namespace model
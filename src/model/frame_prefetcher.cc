@@ -0,0 +1,95 @@
+#include <algorithm>
+#include "model/frame_prefetcher.h"
+#include "utils/main_loop.h"
+
+namespace model {
+
+FramePrefetcher::FramePrefetcher(std::shared_ptr<const DatasetIndex> index, FramePrefetcherOptions opts) :
+    dataset(index), options(opts) {
+  for (int i = 0; i < std::max(options.workers, 1); i++) {
+    workers.emplace_back(&FramePrefetcher::run, this);
+  }
+}
+
+FramePrefetcher::~FramePrefetcher() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobAvailable.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+FrameFuture FramePrefetcher::seek(size_t frame) {
+  FrameFuture future;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    currentFrame = std::min(frame, dataset->size() - 1);
+    scheduleWindow();
+    future = frames.at(currentFrame).future;
+  }
+  jobAvailable.notify_all();
+  return future;
+}
+
+bool FramePrefetcher::isReady(size_t frame) const {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto entry = frames.find(frame);
+  return entry != frames.end() &&
+         entry->second.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+size_t FramePrefetcher::size() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return frames.size();
+}
+
+void FramePrefetcher::scheduleWindow() {
+  size_t last = std::min(currentFrame + size_t(std::max(options.lookAhead, 0)), dataset->size() - 1);
+  // Frames outside of the window are dropped, whether decoded or not.
+  for (auto it = frames.begin(); it != frames.end();) {
+    if (it->first < currentFrame || it->first > last) {
+      it = frames.erase(it);
+    } else {
+      it++;
+    }
+  }
+  std::deque<size_t> queued;
+  queued.swap(jobs);
+  for (size_t frame = currentFrame; frame <= last; frame++) {
+    auto entry = frames.find(frame);
+    if (entry == frames.end()) {
+      Entry newEntry;
+      newEntry.promise = std::make_shared<std::promise<texture_utils::ImagePtr>>();
+      newEntry.future = newEntry.promise->get_future().share();
+      frames.emplace(frame, std::move(newEntry));
+      jobs.push_back(frame);
+    } else if (std::find(queued.begin(), queued.end(), frame) != queued.end()) {
+      jobs.push_back(frame);
+    }
+  }
+}
+
+void FramePrefetcher::run() {
+  while (true) {
+    fs::path imagePath;
+    std::shared_ptr<std::promise<texture_utils::ImagePtr>> promise;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobAvailable.wait(lock, [&]() { return stopping || !jobs.empty(); });
+      if (stopping) return;
+      size_t frame = jobs.front();
+      jobs.pop_front();
+      promise = frames.at(frame).promise;
+      imagePath = dataset->imagePath(frame);
+    }
+    // Whoever still waits for the frame gets it, even if the window moved on.
+    promise->set_value(texture_utils::decodeImage(imagePath.string()));
+    utils::main_loop::wake();
+  }
+}
+
+} // namespace model
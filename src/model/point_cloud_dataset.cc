@@ -1,34 +1,68 @@
+#include <algorithm>
+#include <iostream>
+#include <set>
 #include "model/point_cloud_dataset.h"
+#include "utils/main_loop.h"
 
 namespace model {
 
-PointCloudDataset::PointCloudDataset(fs::path current) : path(current.parent_path()), currentPointCloud(current) {
+PointCloudDataset::PointCloudDataset(fs::path current, PointCloudDatasetOptions opts) : path(current.parent_path()), options(opts) {
   indexPointClouds();
 
   auto it = find_if(pointClouds.begin(), pointClouds.end(), [&](const fs::path pc) {
     return pc == current;
   });
-  currentIndex = it - pointClouds.begin();
-  currentCloud = fetchPointCloud(currentPointCloud);
-  nextCloud = fetchPointCloud(nextPath());
+  if (it == pointClouds.end()) {
+    pointClouds.push_back(current);
+    it = pointClouds.end() - 1;
+  }
+  worker = std::thread(&PointCloudDataset::run, this);
+  seek(it - pointClouds.begin());
 }
 
-const std::shared_future<PointCloudPtr>& PointCloudDataset::getCurrentCloud() const {
-  return currentCloud;
+PointCloudDataset::~PointCloudDataset() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobAvailable.notify_all();
+  worker.join();
 }
 
-fs::path PointCloudDataset::currentPath() const { return currentPointCloud; }
-fs::path PointCloudDataset::nextPath() const {
-  int nextIndex = (currentIndex + 1) % int(pointClouds.size());
-  return pointClouds[nextIndex];
+DatasetPointCloudFuture PointCloudDataset::getCurrentCloud() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return cache.at(currentIndex).future;
 }
 
-std::shared_future<PointCloudPtr> PointCloudDataset::next() {
-  currentIndex = (currentIndex + 1) % int(pointClouds.size());
-  currentPointCloud = pointClouds[currentIndex];
-  currentCloud = nextCloud;
-  nextCloud = fetchPointCloud(nextPath());
-  return currentCloud;
+fs::path PointCloudDataset::currentPath() const { return pointClouds[currentIndex]; }
+fs::path PointCloudDataset::nextPath() const { return pointClouds[wrap(currentIndex + 1)]; }
+fs::path PointCloudDataset::previousPath() const { return pointClouds[wrap(currentIndex - 1)]; }
+
+DatasetPointCloudFuture PointCloudDataset::next() { return seek(currentIndex + 1); }
+DatasetPointCloudFuture PointCloudDataset::previous() { return seek(currentIndex - 1); }
+
+DatasetPointCloudFuture PointCloudDataset::seek(int index) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    currentIndex = wrap(index);
+    scheduleWindow();
+  }
+  jobAvailable.notify_one();
+  return getCurrentCloud();
+}
+
+size_t PointCloudDataset::size() const { return pointClouds.size(); }
+
+bool PointCloudDataset::isCached(int index) const {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto entry = cache.find(wrap(index));
+  return entry != cache.end() && entry->second.loaded;
+}
+
+size_t PointCloudDataset::cacheSizeInBytes() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return cachedBytes;
 }
 
 void PointCloudDataset::indexPointClouds() {
@@ -39,20 +73,134 @@ void PointCloudDataset::indexPointClouds() {
       pointClouds.push_back(file);
     }
   }
+  // Directory iteration order is unspecified, sort to get a stable order when stepping through.
+  std::sort(pointClouds.begin(), pointClouds.end());
+}
+
+int PointCloudDataset::wrap(int index) const {
+  int count = int(pointClouds.size());
+  return ((index % count) + count) % count;
+}
+
+std::vector<int> PointCloudDataset::window() const {
+  // Current cloud first, then alternate between ahead and behind, nearest first.
+  std::vector<int> indices = {currentIndex};
+  int maxDistance = std::max(options.lookAhead, options.lookBehind);
+  for (int distance = 1; distance <= maxDistance; distance++) {
+    if (distance <= options.lookAhead) indices.push_back(wrap(currentIndex + distance));
+    if (distance <= options.lookBehind) indices.push_back(wrap(currentIndex - distance));
+  }
+  std::vector<int> unique;
+  for (int index : indices) {
+    if (std::find(unique.begin(), unique.end(), index) == unique.end()) unique.push_back(index);
+  }
+  return unique;
+}
+
+void PointCloudDataset::scheduleWindow() {
+  std::vector<int> indices = window();
+  std::set<int> queued(jobs.begin(), jobs.end());
+
+  // Cancel loads that have not started yet and fell out of the window.
+  for (int index : queued) {
+    if (std::find(indices.begin(), indices.end(), index) == indices.end()) {
+      cache.erase(index);
+    }
+  }
+  // Failed loads are tried again once they are back in the window.
+  std::erase_if(cache, [](const auto& entry) { return entry.second.failed; });
+
+  jobs.clear();
+  for (int index : indices) {
+    auto entry = cache.find(index);
+    if (entry == cache.end()) {
+      CacheEntry newEntry;
+      newEntry.promise = std::make_shared<std::promise<DatasetPointCloud>>();
+      newEntry.future = newEntry.promise->get_future().share();
+      entry = cache.emplace(index, std::move(newEntry)).first;
+      jobs.push_back(index);
+    } else if (queued.count(index)) {
+      jobs.push_back(index);
+    }
+  }
+  cache[currentIndex].lastUsed = ++useCounter;
+  evict();
 }
 
-std::shared_future<PointCloudPtr> PointCloudDataset::fetchPointCloud(fs::path pcPath) {
-  auto path = nextPath();
-  std::promise<PointCloudPtr> promise;
-  std::shared_future<PointCloudPtr> theFuture = promise.get_future();
-  auto getFunction = [&, theFuture]() -> PointCloudPtr {
-    PointCloudPtr ptr = std::make_shared<geometry::PointCloud>(pcPath.string());
-    promise.set_value(ptr);
-    theFuture.wait();
-    return ptr;
-  };
-  auto result = std::async(std::launch::async, getFunction);
-  return theFuture;
+void PointCloudDataset::evict() {
+  std::vector<int> indices = window();
+  while (cachedBytes > options.memoryBudget) {
+    // Evict clouds outside of the window first, least recently used first. Never the current one.
+    auto victim = cache.end();
+    bool victimInWindow = true;
+    for (auto it = cache.begin(); it != cache.end(); it++) {
+      if (!it->second.loaded || it->first == currentIndex) continue;
+      bool inWindow = std::find(indices.begin(), indices.end(), it->first) != indices.end();
+      if (victim == cache.end() || (victimInWindow && !inWindow) ||
+          (victimInWindow == inWindow && it->second.lastUsed < victim->second.lastUsed)) {
+        victim = it;
+        victimInWindow = inWindow;
+      }
+    }
+    if (victim == cache.end()) break;
+    cachedBytes -= victim->second.bytes;
+    cache.erase(victim);
+  }
 }
 
+void PointCloudDataset::run() {
+  while (true) {
+    int index;
+    fs::path pcPath;
+    std::shared_ptr<std::promise<DatasetPointCloud>> promise;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobAvailable.wait(lock, [&]() { return stopping || !jobs.empty(); });
+      if (stopping) return;
+      index = jobs.front();
+      jobs.pop_front();
+      promise = cache.at(index).promise;
+      pcPath = pointClouds[index];
+    }
+
+    DatasetPointCloud loaded;
+    try {
+      loaded.pointCloud = std::make_shared<geometry::PointCloud>(pcPath.string(), options.quantizePositions);
+      loaded.octree = std::make_shared<geometry::PointCloudOctree>(*loaded.pointCloud);
+      loaded.rayTraceCloud = std::make_shared<geometry::RayTraceCloud>(loaded.pointCloud, pcPath);
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+      std::unique_lock<std::mutex> lock(mutex);
+      // Entries are only erased once loaded or failed, or while still queued, so this one is still around.
+      cache.at(index).failed = true;
+      lock.unlock();
+      utils::main_loop::wake();
+      continue;
+    }
+
+    // Hand out the cloud as soon as it is decoded, picking works without the acceleration structures.
+    promise->set_value(loaded);
+    utils::main_loop::wake();
+    size_t bytes = loaded.pointCloud->sizeInBytes() + loaded.octree->sizeInBytes();
+    try {
+      loaded.rayTraceCloud->build();
+      bytes += loaded.rayTraceCloud->sizeInBytes();
+    } catch (const std::exception& e) {
+      // Picking keeps falling back to testing every point.
+      std::cout << "Could not build ray tracing structures for " << pcPath.string() << ": " << e.what() << std::endl;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    CacheEntry& entry = cache.at(index);
+    entry.loaded = true;
+    entry.bytes = bytes;
+    entry.lastUsed = ++useCounter;
+    cachedBytes += bytes;
+    evict();
+    lock.unlock();
+    // Picking is exact from now on.
+    utils::main_loop::wake();
+  }
 }
+
+} // namespace model
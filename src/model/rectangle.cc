@@ -2,7 +2,6 @@
 #include <vector>
 #include <algorithm>
 #include "model/rectangle.h"
-#include "id.h"
 
 Rectangle::Rectangle(const Rectangle& rect) {
   id = rect.id;
@@ -10,7 +9,6 @@ Rectangle::Rectangle(const Rectangle& rect) {
   center = rect.center;
   orientation = rect.orientation;
   size = rect.size;
-  rotateControl = rect.rotateControl;
 }
 
 Rectangle::Rectangle(const std::array<Vector3f, 4>& vertices) {
@@ -38,7 +36,8 @@ Rectangle::Rectangle(const std::array<Vector3f, 4>& vertices) {
   R_RW.row(2) = normal;
   orientation = Quaternionf(R_RW.transpose());
 
-  id = IdFactory::getInstance().getId();
+  // Assigned when added to the scene.
+  id = -1;
   classId = 0;
   size = Vector2f(edge1.norm(), edge2.norm());
 }
@@ -0,0 +1,184 @@
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <bimg/bimg.h>
+#include "model/thumbnail_cache.h"
+
+namespace model {
+
+const char Magic[8] = {'S', 'T', 'R', 'A', 'Y', 'T', '0', '4'};
+// Frames decoded at once, bounding how many thumbnails are held before being written.
+const size_t BatchSize = 64;
+
+// Bytes a frame of the size takes, zero for formats thumbnails are never stored in.
+static uint32_t frameSize(uint32_t width, uint32_t height, uint32_t format) {
+  if (format == bgfx::TextureFormat::BC1) return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+  if (format == bgfx::TextureFormat::RGBA8) return width * height * 4;
+  return 0;
+}
+
+// Sets the size and modification time of the image in the entry, zero if there is none.
+static void stampImage(const fs::path& imagePath, ThumbnailCache::Entry& entry) {
+  std::error_code error;
+  uintmax_t size = fs::file_size(imagePath, error);
+  fs::file_time_type time = error ? fs::file_time_type() : fs::last_write_time(imagePath, error);
+  if (error) {
+    entry.imageSize = 0;
+    entry.imageTime = 0;
+    return;
+  }
+  entry.imageSize = uint64_t(size);
+  entry.imageTime = int64_t(time.time_since_epoch().count());
+}
+
+ThumbnailCache::ThumbnailCache(const fs::path& path) : file(path) {
+  const Header* header = reinterpret_cast<const Header*>(file.data());
+  if (file.size() < sizeof(Header) || std::memcmp(header->magic, Magic, sizeof(Magic)) != 0) {
+    throw std::runtime_error("Not a thumbnail cache: " + path.string());
+  }
+  size_t tableEnd = sizeof(Header) + size_t(header->frames) * sizeof(Entry);
+  if (file.size() < tableEnd) throw std::runtime_error("Truncated thumbnail cache: " + path.string());
+  if (frameSize(1, 1, header->format) == 0) throw std::runtime_error("Unknown thumbnail format: " + path.string());
+  entries = reinterpret_cast<const Entry*>(file.data() + sizeof(Header));
+  for (size_t i = 0; i < header->frames; i++) {
+    const Entry& entry = entries[i];
+    if (entry.offset + entry.size > file.size() || entry.size != frameSize(entry.width, entry.height, header->format)) {
+      throw std::runtime_error("Truncated thumbnail cache: " + path.string());
+    }
+  }
+  frames = header->frames;
+  format = bgfx::TextureFormat::Enum(header->format);
+}
+
+// FNV-1a, unlike std::hash the same with every standard library, so that caches are still found after updating it.
+static uint64_t pathHash(const std::string& path) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : path) {
+    hash = (hash ^ uint8_t(c)) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+fs::path ThumbnailCache::pathFor(const DatasetIndex& dataset) {
+  fs::path cache;
+  if (const char* xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache != nullptr && *xdgCache != '\0') {
+    cache = xdgCache;
+  } else if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+    cache = fs::path(home) / ".cache";
+  } else {
+    cache = fs::temp_directory_path();
+  }
+  // Datasets are often all called the same, so the name is followed by a hash of the whole path.
+  fs::path datasetPath = fs::absolute(dataset.getPath()).lexically_normal();
+  if (!datasetPath.has_filename()) datasetPath = datasetPath.parent_path();
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(pathHash(datasetPath.string())));
+  return cache / "stray" / "thumbnails" / (datasetPath.filename().string() + "-" + hash + ".bin");
+}
+
+std::unique_ptr<ThumbnailCache> ThumbnailCache::open(const fs::path& path, const DatasetIndex& dataset) {
+  if (!fs::exists(path)) return nullptr;
+  std::unique_ptr<ThumbnailCache> cache;
+  try {
+    cache = std::make_unique<ThumbnailCache>(path);
+  } catch (const std::runtime_error& error) {
+    std::cout << error.what() << std::endl;
+    return nullptr;
+  }
+  if (cache->size() != dataset.size()) return nullptr;
+  // Images replaced since, e.g. by recording the dataset again.
+  for (size_t frame = 0; frame < cache->size(); frame++) {
+    const Entry& entry = cache->entries[frame];
+    Entry current = entry;
+    stampImage(dataset.imagePath(frame), current);
+    if (current.imageSize != entry.imageSize || current.imageTime != entry.imageTime) return nullptr;
+  }
+  return cache;
+}
+
+texture_utils::ImagePtr ThumbnailCache::image(size_t frame) const {
+  if (!contains(frame)) return nullptr;
+  const Entry& entry = entries[frame];
+  return texture_utils::copyImage(entry.width, entry.height, file.data() + entry.offset, format);
+}
+
+static texture_utils::ImagePtr makeThumbnail(const fs::path& imagePath, const ThumbnailOptions& options) {
+  texture_utils::ImagePtr image = texture_utils::decodeImage(imagePath.string());
+  if (image == nullptr) return nullptr;
+  int factor = 1;
+  while (int(image->container->m_width) / factor > options.maxWidth) factor *= 2;
+  texture_utils::ImagePtr thumbnail = texture_utils::shrinkImage(*image, factor);
+  if (thumbnail == nullptr || !options.compress) return thumbnail;
+  return texture_utils::compressImage(*thumbnail);
+}
+
+bool ThumbnailCache::generate(const DatasetIndex& dataset, const fs::path& path, ThumbnailOptions options,
+                              std::stop_token stop) {
+  fs::path temporaryPath = path;
+  temporaryPath += ".tmp";
+  std::error_code error;
+  fs::create_directories(path.parent_path(), error);
+  const size_t frames = dataset.size();
+  std::vector<Entry> table(frames, Entry{0, 0, 0, 0, 0, 0});
+  {
+    std::ofstream out(temporaryPath, std::ios::binary);
+    Header header = {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.frames = uint32_t(frames);
+    header.format = options.compress ? bgfx::TextureFormat::BC1 : bgfx::TextureFormat::RGBA8;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // Filled in once the size of each thumbnail is known.
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+    uint64_t offset = sizeof(Header) + table.size() * sizeof(Entry);
+
+    std::vector<texture_utils::ImagePtr> thumbnails(BatchSize);
+    for (size_t batch = 0; batch < frames && out && !stop.stop_requested(); batch += BatchSize) {
+      const int64_t count = int64_t(std::min(BatchSize, frames - batch));
+#pragma omp parallel for schedule(dynamic) num_threads(std::max(options.threads, 1))
+      for (int64_t i = 0; i < count; i++) {
+        if (stop.stop_requested()) continue;
+        // Before decoding, so that an image replaced meanwhile does not match.
+        stampImage(dataset.imagePath(batch + i), table[batch + i]);
+        thumbnails[i] = makeThumbnail(dataset.imagePath(batch + i), options);
+      }
+      for (int64_t i = 0; i < count; i++) {
+        if (thumbnails[i] == nullptr) continue;
+        const bimg::ImageContainer* container = thumbnails[i]->container;
+        Entry& entry = table[batch + i];
+        entry.offset = offset;
+        entry.size = container->m_size;
+        entry.width = uint16_t(container->m_width);
+        entry.height = uint16_t(container->m_height);
+        out.write(static_cast<const char*>(container->m_data), container->m_size);
+        offset += container->m_size;
+        thumbnails[i] = nullptr;
+      }
+    }
+    out.seekp(sizeof(Header));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+    out.close();
+    if (stop.stop_requested()) {
+      fs::remove(temporaryPath, error);
+      return false;
+    }
+    if (!out) {
+      std::cout << "Could not write thumbnails to " << temporaryPath.string() << std::endl;
+      fs::remove(temporaryPath, error);
+      return false;
+    }
+  }
+  fs::rename(temporaryPath, path, error);
+  if (error) {
+    std::cout << "Could not replace " << path.string() << ": " << error.message() << std::endl;
+    fs::remove(temporaryPath, error);
+    return false;
+  }
+  return true;
+}
+
+} // namespace model
@@ -3,13 +3,12 @@
 #include <algorithm>
 #include <sstream>
 #include "scene_model.h"
-#include "3rdparty/json.hpp"
-#include "utils/serialize.h"
+#include "utils/annotation_file.h"
+#include "utils/main_loop.h"
 
 namespace fs = std::filesystem;
-using json = nlohmann::json;
 
-SceneModel::SceneModel(std::optional<std::string> meshPath) : meshPath(meshPath), keypoints(), boundingBoxes() {}
+SceneModel::SceneModel(std::optional<std::string> meshPath) : meshPath(meshPath) {}
 
 std::shared_ptr<geometry::TriangleMesh> SceneModel::getMesh() {
   if (mesh == nullptr) {
@@ -23,209 +22,303 @@ std::shared_ptr<geometry::PointCloud> SceneModel::getPointCloud() {
 }
 
 std::optional<Vector3f> SceneModel::traceRay(const Vector3f& origin, const Vector3f& direction) {
-  if (activeView == active_view::MeshView) {
-    if (!rtMesh.has_value()) return {};
-    return rtMesh->traceRay(origin, direction);
-  } else {
-    if (!rtPointCloud.has_value()) return {};
-    return rtPointCloud->traceRay(origin, direction);
-  }
+  geometry::Intersection intersection = traceRayIntersection(origin, direction);
+  if (!intersection.hit) return {};
+  return intersection.point;
 }
 
 geometry::Intersection SceneModel::traceRayIntersection(const Vector3f& origin, const Vector3f& direction) {
+  // Brute force hits have no surface normal, they are traced again once the ray tracer is built.
+  const bool built = rtPointCloud != nullptr && rtPointCloud->isReady();
+  if (lastTrace.has_value() && lastTrace->origin == origin && lastTrace->direction == direction &&
+      lastTrace->view == activeView && lastTrace->pointSize == pointCloudPointSize &&
+      lastTrace->geometryRevision == geometryRevision && lastTrace->built == built) {
+    return lastTrace->intersection;
+  }
+  geometry::Intersection intersection = {};
   if (activeView == active_view::MeshView) {
-    if (!rtMesh.has_value()) return {};
-    return rtMesh->traceRayIntersection(origin, direction);
+    if (rtMesh.has_value()) intersection = rtMesh->traceRayIntersection(origin, direction);
   } else {
-    if (!rtPointCloud.has_value()) return {};
-    return rtPointCloud->traceRayIntersection(origin, direction);
+    if (rtPointCloud != nullptr) intersection = rtPointCloud->traceRayIntersection(origin, direction, pointCloudPointSize);
+  }
+  lastTrace = TracedRay{origin, direction, activeView, pointCloudPointSize, geometryRevision, built, intersection};
+  return intersection;
+}
+
+template <class T>
+void assignId(model::AnnotationStore<T>& annotations, T& annotation) {
+  if (annotation.id <= 0 || annotations.contains(annotation.id)) {
+    annotation.id = annotations.nextId();
+  }
+}
+
+AnnotationIds SceneModel::getNextIds() const {
+  return {keypoints.getNextId(), boundingBoxes.getNextId(), rectangles.getNextId()};
+}
+
+void SceneModel::setNextIds(const AnnotationIds& ids) {
+  keypoints.setNextId(ids.keypoints);
+  boundingBoxes.setNextId(ids.boundingBoxes);
+  rectangles.setNextId(ids.rectangles);
+}
+
+AnnotationSnapshot SceneModel::snapshot() const {
+  return {keypoints.snapshot(), boundingBoxes.snapshot(), rectangles.snapshot(), getNextIds(), annotationRevision};
+}
+
+void SceneModel::record(AnnotationEdit edit) {
+  if (!recordingEdits) return;
+  edit.revision = annotationRevision;
+  edits.push_back(std::move(edit));
+}
+
+std::vector<AnnotationEdit> SceneModel::takeEdits() {
+  std::vector<AnnotationEdit> taken;
+  taken.swap(edits);
+  return taken;
+}
+
+template <class T>
+void setAnnotation(model::AnnotationStore<T>& annotations, const T& annotation) {
+  if (!annotations.update(annotation)) annotations.add(annotation);
+}
+
+void SceneModel::applyEdit(const AnnotationEdit& edit) {
+  switch (edit.kind) {
+  case AnnotationEdit::SetKeypoint:
+    setAnnotation(keypoints, std::get<Keypoint>(edit.annotation));
+    break;
+  case AnnotationEdit::SetBoundingBox:
+    setAnnotation(boundingBoxes, std::get<BBox>(edit.annotation));
+    break;
+  case AnnotationEdit::SetRectangle:
+    setAnnotation(rectangles, std::get<Rectangle>(edit.annotation));
+    break;
+  case AnnotationEdit::RemoveKeypoint:
+    keypoints.remove(edit.id);
+    break;
+  case AnnotationEdit::RemoveBoundingBox:
+    boundingBoxes.remove(edit.id);
+    break;
+  case AnnotationEdit::RemoveRectangle:
+    rectangles.remove(edit.id);
+    break;
   }
+  annotationRevision++;
 }
 
 Keypoint SceneModel::addKeypoint(const Vector3f& position) {
-  Keypoint keypoint(keypoints.size() + 1, currentClassId, position);
-  keypoints.push_back(keypoint);
+  Keypoint keypoint(keypoints.nextId(), currentClassId, position);
+  keypoints.add(keypoint);
+  annotationRevision++;
+  record({AnnotationEdit::SetKeypoint, 0, keypoint.id, keypoint});
   return keypoint;
 }
 Keypoint SceneModel::addKeypoint(const Keypoint& kp) {
   Keypoint keypoint = kp;
-  keypoint.id = keypoints.size() + 1;
-  keypoints.push_back(keypoint);
+  assignId(keypoints, keypoint);
+  keypoints.add(keypoint);
+  annotationRevision++;
+  record({AnnotationEdit::SetKeypoint, 0, keypoint.id, keypoint});
   return keypoint;
 }
 
 void SceneModel::removeKeypoint(const Keypoint& kp) {
   if (keypoints.empty()) return;
-  auto iterator = std::find_if(keypoints.begin(), keypoints.end(), [&](const Keypoint& keypoint) {
-    return keypoint.id == kp.id;
-  });
-  if (iterator == keypoints.end()) {
+  if (!keypoints.remove(kp.id)) {
     std::cout << "Keypoint " << kp.id << " was not found. Should not happen." << std::endl;
     return;
   }
-  keypoints.erase(iterator);
+  annotationRevision++;
+  record({AnnotationEdit::RemoveKeypoint, 0, kp.id, std::monostate()});
+}
+
+void SceneModel::setHoveredRectangle(int id) {
+  if (hoveredRectangle == id) return;
+  hoveredRectangle = id;
+  hoverRevision++;
 }
 
 void SceneModel::reset() {
   keypoints.clear();
   boundingBoxes.clear();
   rectangles.clear();
+  edits.clear();
+  annotationRevision++;
 }
 
 std::optional<Keypoint> SceneModel::getKeypoint(int id) const {
-  for (unsigned int i = 0; i < keypoints.size(); i++) {
-    if (keypoints[i].id == id) {
-      return keypoints[i];
-    }
-  }
-  return {};
+  const Keypoint* keypoint = keypoints.find(id);
+  if (keypoint == nullptr) return {};
+  return *keypoint;
 }
 
-void SceneModel::setPointCloud(std::shared_ptr<geometry::PointCloud> pc) {
+void SceneModel::setPointCloud(std::shared_ptr<geometry::PointCloud> pc, std::shared_ptr<geometry::RayTraceCloud> rayTraceCloud,
+                               std::shared_ptr<const geometry::PointCloudOctree> octree) {
   pointCloud = pc;
-  rtPointCloud.emplace(pointCloud, pointCloudPointSize);
+  geometryRevision++;
+  pointCloudOctree = octree;
+  if (pointCloudOctree == nullptr) {
+    auto built = std::make_shared<std::shared_ptr<const geometry::PointCloudOctree>>();
+    startBuild([pc, built]() { *built = std::make_shared<geometry::PointCloudOctree>(*pc); },
+               [this, pc, built]() {
+                 // The cloud might have been replaced while its octree was built.
+                 if (pointCloud == pc) pointCloudOctree = *built;
+               });
+  }
+  rtPointCloud = rayTraceCloud;
+  if (rtPointCloud == nullptr) {
+    rtPointCloud = std::make_shared<geometry::RayTraceCloud>(pointCloud);
+    startBuild([rt = rtPointCloud]() { rt->build(); });
+  }
 }
 
-void SceneModel::setKeypoint(const Keypoint& updated) {
-  auto point = std::find_if(keypoints.begin(), keypoints.end(), [&](const Keypoint& keypoint) {
-    return keypoint.id == updated.id;
+void SceneModel::loadPointCloud(const fs::path& path) {
+  pointCloudPath = path.string();
+  auto pc = std::make_shared<geometry::PointCloud>(path.string());
+  auto rayTraceCloud = std::make_shared<geometry::RayTraceCloud>(pc, path);
+  setPointCloud(pc, rayTraceCloud);
+  startBuild([rayTraceCloud]() { rayTraceCloud->build(); });
+}
+
+void SceneModel::startBuild(std::function<void()> build, std::function<void()> done) {
+  auto geometryBuild = std::make_unique<GeometryBuild>();
+  geometryBuild->done = std::move(done);
+  GeometryBuild* state = geometryBuild.get();
+  state->thread = std::jthread([state, build = std::move(build)]() {
+    try {
+      build();
+    } catch (const std::exception& e) {
+      state->error = e.what();
+    }
+    state->finished.store(true, std::memory_order_release);
+    utils::main_loop::wake();
   });
-  if (point != keypoints.end()) {
-    *point = updated;
+  geometryBuilds.push_back(std::move(geometryBuild));
+}
+
+bool SceneModel::updateGeometryBuilds() {
+  bool finished = std::erase_if(geometryBuilds, [](const std::unique_ptr<GeometryBuild>& build) {
+    if (!build->finished.load(std::memory_order_acquire)) return false;
+    if (!build->error.empty()) {
+      std::cout << "Could not build acceleration structures: " << build->error << std::endl;
+    } else if (build->done) {
+      build->done();
+    }
+    return true;
+  }) > 0;
+  if (finished) geometryRevision++;
+  return finished;
+}
+
+void SceneModel::setKeypoint(const Keypoint& updated) {
+  if (keypoints.update(updated)) {
+    annotationRevision++;
+    record({AnnotationEdit::SetKeypoint, 0, updated.id, updated});
   }
 }
 
 void SceneModel::updateKeypoint(int id, Keypoint kp) {
   assert(kp.id == id && "Keypoint needs to be the same as the one being updated.");
-  for (unsigned int i = 0; i < keypoints.size(); i++) {
-    if (keypoints[i].id == id) {
-      keypoints[i] = kp;
-      return;
-    }
+  if (keypoints.update(kp)) {
+    annotationRevision++;
+    record({AnnotationEdit::SetKeypoint, 0, kp.id, kp});
   }
 }
 
 // Bounding boxes
 std::optional<BBox> SceneModel::getBoundingBox(int id) const {
-  auto iterator = std::find_if(boundingBoxes.begin(), boundingBoxes.end(), [&](const BBox& bbox) {
-    return bbox.id == id;
-  });
-  if (iterator != boundingBoxes.end()) {
-    return *iterator;
-  }
-  return {};
+  const BBox* bbox = boundingBoxes.find(id);
+  if (bbox == nullptr) return {};
+  return *bbox;
 }
 
 void SceneModel::addBoundingBox(BBox& bbox) {
-  bbox.id = boundingBoxes.size() + 1;
-  boundingBoxes.push_back(bbox);
+  assignId(boundingBoxes, bbox);
+  boundingBoxes.add(bbox);
+  annotationRevision++;
+  record({AnnotationEdit::SetBoundingBox, 0, bbox.id, bbox});
 }
 
 template <class T>
-void removeAnnotation(std::vector<T>& entities, int id) {
-  if (entities.empty()) return;
-  auto iterator = std::find_if(entities.begin(), entities.end(), [&](const T& annotation) {
-    return annotation.id == id;
-  });
-  if (iterator != entities.end()) {
-    entities.erase(iterator);
-  }
-}
-template <class T>
-void updateAnnotation(std::vector<T>& annotations, const T& updated) {
-  auto iterator = std::find_if(annotations.begin(), annotations.end(), [&](const T& annotation) {
-    return annotation.id == updated.id;
-  });
-
-  if (iterator != annotations.end()) {
-    *iterator = updated;
-  } else {
+bool updateAnnotation(model::AnnotationStore<T>& annotations, const T& updated) {
+  if (!annotations.update(updated)) {
     std::cout << "could not find annotation: " << updated.id << std::endl;
+    return false;
   }
+  return true;
 }
 
 void SceneModel::removeBoundingBox(int id) {
-  removeAnnotation(boundingBoxes, id);
+  bool removed = boundingBoxes.remove(id);
+  annotationRevision++;
+  if (removed) record({AnnotationEdit::RemoveBoundingBox, 0, id, std::monostate()});
 }
 
 void SceneModel::updateBoundingBox(const BBox& updated) {
-  updateAnnotation(boundingBoxes, updated);
+  bool found = updateAnnotation(boundingBoxes, updated);
+  annotationRevision++;
+  if (found) record({AnnotationEdit::SetBoundingBox, 0, updated.id, updated});
 }
 
 void SceneModel::addRectangle(Rectangle& rectangle) {
-  rectangles.push_back(rectangle);
+  assignId(rectangles, rectangle);
+  rectangles.add(rectangle);
+  annotationRevision++;
+  record({AnnotationEdit::SetRectangle, 0, rectangle.id, rectangle});
 }
 
 void SceneModel::removeRectangle(int id) {
-  removeAnnotation(rectangles, id);
+  bool removed = rectangles.remove(id);
+  annotationRevision++;
+  if (removed) record({AnnotationEdit::RemoveRectangle, 0, id, std::monostate()});
 }
 
 void SceneModel::updateRectangle(const Rectangle& updated) {
-  updateAnnotation(rectangles, updated);
+  bool found = updateAnnotation(rectangles, updated);
+  annotationRevision++;
+  if (found) record({AnnotationEdit::SetRectangle, 0, updated.id, updated});
 }
 
 void SceneModel::loadMesh() {
   if (meshPath) {
     mesh = std::make_shared<geometry::Mesh>(meshPath.value_or("empty"));
-    rtMesh.emplace(mesh);
+    rtMesh.emplace(mesh, meshPath.value());
+    geometryRevision++;
   }
 }
 
-void SceneModel::load(fs::path annotationPath) {
-  nlohmann::json json;
-  std::ifstream file(annotationPath);
-  file >> json;
-  for (auto& point : json["keypoints"]) {
-    auto position = point["position"];
-    auto classId = point["class_id"].get<int>();
-    Keypoint kp(keypoints.size() + 1, classId, Vector3f(position[0].get<float>(), position[1].get<float>(), position[2].get<float>()));
-    keypoints.push_back(kp);
+bool SceneModel::load(fs::path annotationPath) {
+  utils::annotation_file::Annotations loaded;
+  if (!utils::annotation_file::read(annotationPath, loaded)) {
+    std::cout << "Not loading annotations from " << annotationPath.string() << std::endl;
+    return false;
   }
-  for (auto& bbox : json["bounding_boxes"]) {
-    auto p = bbox["position"];
-    auto orn = bbox["orientation"];
-    auto d = bbox["dimensions"];
-    auto classId = bbox["class_id"];
-    BBox box = {
-        .id = int(boundingBoxes.size()) + 1,
-        .classId = classId,
-        .position = Vector3f(p[0].get<float>(), p[1].get<float>(), p[2].get<float>()),
-        .orientation = Quaternionf(orn["w"].get<float>(), orn["x"].get<float>(), orn["y"].get<float>(), orn["z"].get<float>()),
-        .dimensions = Vector3f(d[0].get<float>(), d[1].get<float>(), d[2].get<float>())};
-    boundingBoxes.push_back(box);
+  // Added to what is already in the scene, usually nothing.
+  keypoints.reserve(keypoints.size() + loaded.keypoints.size());
+  boundingBoxes.reserve(boundingBoxes.size() + loaded.boundingBoxes.size());
+  rectangles.reserve(rectangles.size() + loaded.rectangles.size());
+  for (Keypoint& keypoint : loaded.keypoints) {
+    assignId(keypoints, keypoint);
+    keypoints.add(keypoint);
   }
-
-  for (auto& rectangle : json["rectangles"]) {
-    Rectangle rect(0, rectangle["class_id"],
-                   utils::serialize::toVector3(rectangle["center"]),
-                   utils::serialize::toQuaternion(rectangle["orientation"]),
-                   utils::serialize::toVector2(rectangle["size"]));
-    rectangles.push_back(rect);
+  for (BBox& bbox : loaded.boundingBoxes) {
+    assignId(boundingBoxes, bbox);
+    boundingBoxes.add(bbox);
   }
+  for (Rectangle& rectangle : loaded.rectangles) {
+    assignId(rectangles, rectangle);
+    rectangles.add(rectangle);
+  }
+  if (loaded.nextIds.has_value()) {
+    setNextIds(loaded.nextIds.value());
+  }
+  annotationRevision++;
+  return true;
 }
 
 void SceneModel::save(fs::path annotationPath) const {
-  nlohmann::json json = nlohmann::json::object();
-  if (!keypoints.empty()) {
-    json["keypoints"] = nlohmann::json::array();
-    for (size_t i = 0; i < keypoints.size(); i++) {
-      json["keypoints"][i] = utils::serialize::serialize(keypoints[i]);
-    }
-  }
-  if (!boundingBoxes.empty()) {
-    json["bounding_boxes"] = nlohmann::json::array();
-    for (size_t i = 0; i < boundingBoxes.size(); i++) {
-      const auto& bbox = boundingBoxes[i];
-      json["bounding_boxes"][i] = utils::serialize::serialize(bbox);
-    }
-  }
-  if (!rectangles.empty()) {
-    json["rectangles"] = nlohmann::json::array();
-    for (size_t i = 0; i < rectangles.size(); i++) {
-      json["rectangles"][i] = utils::serialize::serialize(rectangles[i]);
-    }
+  if (utils::annotation_file::write(annotationPath, keypoints.all(), boundingBoxes.all(), rectangles.all(), getNextIds())) {
+    std::cout << "Saved annotations to " << annotationPath.string() << std::endl;
   }
-  std::ofstream file(annotationPath.string());
-  file << json.dump(4);
-  std::cout << "Saved annotations to " << annotationPath.string() << std::endl;
 }
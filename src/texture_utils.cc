@@ -1,4 +1,8 @@
+#include <climits>
+#include <cstring>
+#include <utility>
 #include <iostream>
+#include <algorithm>
 #include <bx/bx.h>
 #include <bx/allocator.h>
 #include <bx/file.h>
@@ -10,40 +14,269 @@ namespace texture_utils {
 
 static bx::DefaultAllocator allocator;
 
+Image::~Image() {
+  bimg::imageFree(container);
+}
+
 static void imageReleaseCb(void* _ptr, void* _userData) {
   BX_UNUSED(_ptr);
-  bimg::ImageContainer* imageContainer = (bimg::ImageContainer*)_userData;
-  bimg::imageFree(imageContainer);
+  delete static_cast<ImagePtr*>(_userData);
 }
 
-bgfx::TextureHandle loadTexture(const std::string& filePath) {
+ImagePtr decodeImage(const std::string& filePath) {
   bx::FileReader reader;
-  bgfx::TextureHandle handle = BGFX_INVALID_HANDLE;
   bx::Error error;
-  void* data;
-  if (reader.open(filePath.c_str(), &error)) {
-    uint32_t size = (uint32_t)bx::getSize(&reader);
-    data = BX_ALLOC(&allocator, size);
-    bx::read(&reader, data, size, &error);
-    bx::close(&reader);
-    bimg::ImageContainer* imageContainer = bimg::imageParse(&allocator, data, size);
-    if (!error.isOk()) {
-      std::cout << "can't load texture: " << filePath << std::endl;
-      exit(1);
+  if (!reader.open(filePath.c_str(), &error)) {
+    std::cout << "can't open texture: " << filePath << std::endl;
+    return nullptr;
+  }
+  uint32_t size = (uint32_t)bx::getSize(&reader);
+  void* data = BX_ALLOC(&allocator, size);
+  bx::read(&reader, data, size, &error);
+  bx::close(&reader);
+  bimg::ImageContainer* imageContainer = nullptr;
+  if (error.isOk()) {
+    imageContainer = bimg::imageParse(&allocator, data, size);
+  }
+  BX_FREE(&allocator, data);
+  if (imageContainer != nullptr && imageContainer->m_format != bimg::TextureFormat::RGBA8) {
+    bimg::ImageContainer* rgba = bimg::imageConvert(&allocator, bimg::TextureFormat::RGBA8, *imageContainer, false);
+    bimg::imageFree(imageContainer);
+    imageContainer = rgba;
+  }
+  if (imageContainer == nullptr) {
+    std::cout << "can't load texture: " << filePath << std::endl;
+    return nullptr;
+  }
+  return std::make_shared<const Image>(imageContainer);
+}
+
+ImagePtr shrinkImage(const Image& image, int factor) {
+  // Images from decodeImage already are RGBA8, others are converted first.
+  bimg::ImageContainer* converted = nullptr;
+  if (image.container->m_format != bimg::TextureFormat::RGBA8) {
+    converted = bimg::imageConvert(&allocator, bimg::TextureFormat::RGBA8, *image.container, false);
+    if (converted == nullptr) return nullptr;
+  }
+  const bimg::ImageContainer* rgba = converted != nullptr ? converted : image.container;
+  const uint32_t width = rgba->m_width / factor;
+  const uint32_t height = rgba->m_height / factor;
+  bimg::ImageContainer* shrunk = bimg::imageAlloc(&allocator, bimg::TextureFormat::RGBA8, uint16_t(width),
+                                                  uint16_t(height), 1, 1, false, false);
+  const uint8_t* source = static_cast<const uint8_t*>(rgba->m_data);
+  uint8_t* destination = static_cast<uint8_t*>(shrunk->m_data);
+  const uint32_t sourceStride = rgba->m_width * 4;
+  const uint32_t area = uint32_t(factor * factor);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      uint32_t sum[4] = {0, 0, 0, 0};
+      for (int dy = 0; dy < factor; dy++) {
+        const uint8_t* row = source + (y * factor + dy) * sourceStride + x * factor * 4;
+        for (int dx = 0; dx < factor * 4; dx += 4) {
+          sum[0] += row[dx];
+          sum[1] += row[dx + 1];
+          sum[2] += row[dx + 2];
+          sum[3] += row[dx + 3];
+        }
+      }
+      uint8_t* pixel = destination + (y * width + x) * 4;
+      for (int c = 0; c < 4; c++) pixel[c] = uint8_t((sum[c] + area / 2) / area);
+    }
+  }
+  if (converted != nullptr) bimg::imageFree(converted);
+  return std::make_shared<const Image>(shrunk);
+}
+
+static uint16_t packColor(const uint8_t* color) {
+  return uint16_t(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 |
+                  (color[2] * 31 + 127) / 255);
+}
+
+static void unpackColor(uint16_t packed, int* color) {
+  color[0] = ((packed >> 11) & 31) * 255 / 31;
+  color[1] = ((packed >> 5) & 63) * 255 / 63;
+  color[2] = (packed & 31) * 255 / 31;
+}
+
+// One 4 by 4 block, with the end points on the diagonal of the bounding box of its colors that fits them best.
+static void compressBlock(const uint8_t (&pixels)[16][4], uint8_t* block) {
+  uint8_t low[3] = {255, 255, 255};
+  uint8_t high[3] = {0, 0, 0};
+  int mean[3] = {0, 0, 0};
+  for (const uint8_t* pixel : pixels) {
+    for (int c = 0; c < 3; c++) {
+      low[c] = std::min(low[c], pixel[c]);
+      high[c] = std::max(high[c], pixel[c]);
+      mean[c] += pixel[c];
+    }
+  }
+  // Channels that fall while the one varying most rises go from high to low instead.
+  int widest = 0;
+  for (int c = 1; c < 3; c++) {
+    if (high[c] - low[c] > high[widest] - low[widest]) widest = c;
+  }
+  for (int c = 0; c < 3; c++) {
+    if (c == widest) continue;
+    int covariance = 0;
+    for (const uint8_t* pixel : pixels) {
+      covariance += (pixel[widest] * 16 - mean[widest]) * (pixel[c] * 16 - mean[c]);
+    }
+    if (covariance < 0) std::swap(low[c], high[c]);
+  }
+  uint16_t first = packColor(high);
+  uint16_t second = packColor(low);
+  // The first end point has to be the larger one for the mode with four colors.
+  if (first < second) std::swap(first, second);
+  int palette[4][3];
+  unpackColor(first, palette[0]);
+  unpackColor(second, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  uint32_t indices = 0;
+  if (first != second) {
+    for (int i = 0; i < 16; i++) {
+      int best = 0;
+      int bestDistance = INT_MAX;
+      for (int j = 0; j < 4; j++) {
+        int distance = 0;
+        for (int c = 0; c < 3; c++) {
+          const int d = int(pixels[i][c]) - palette[j][c];
+          distance += d * d;
+        }
+        if (distance < bestDistance) {
+          best = j;
+          bestDistance = distance;
+        }
+      }
+      indices |= uint32_t(best) << (2 * i);
+    }
+  }
+  block[0] = uint8_t(first);
+  block[1] = uint8_t(first >> 8);
+  block[2] = uint8_t(second);
+  block[3] = uint8_t(second >> 8);
+  for (int i = 0; i < 4; i++) block[4 + i] = uint8_t(indices >> (8 * i));
+}
+
+ImagePtr compressImage(const Image& image) {
+  const bimg::ImageContainer* rgba = image.container;
+  const uint32_t width = rgba->m_width;
+  const uint32_t height = rgba->m_height;
+  bimg::ImageContainer* compressed = bimg::imageAlloc(&allocator, bimg::TextureFormat::BC1, uint16_t(width),
+                                                      uint16_t(height), 1, 1, false, false);
+  const uint8_t* source = static_cast<const uint8_t*>(rgba->m_data);
+  uint8_t* block = static_cast<uint8_t*>(compressed->m_data);
+  uint8_t pixels[16][4];
+  for (uint32_t y = 0; y < height; y += 4) {
+    for (uint32_t x = 0; x < width; x += 4, block += 8) {
+      // Blocks over the right and bottom edges repeat the last column and row.
+      for (uint32_t i = 0; i < 16; i++) {
+        const uint32_t pixelX = std::min(x + i % 4, width - 1);
+        const uint32_t pixelY = std::min(y + i / 4, height - 1);
+        std::memcpy(pixels[i], source + (pixelY * width + pixelX) * 4, 4);
+      }
+      compressBlock(pixels, block);
+    }
+  }
+  return std::make_shared<const Image>(compressed);
+}
+
+ImagePtr copyImage(uint16_t width, uint16_t height, const uint8_t* pixels, bgfx::TextureFormat::Enum format) {
+  return std::make_shared<const Image>(bimg::imageAlloc(&allocator, bimg::TextureFormat::Enum(format), width,
+                                                        height, 1, 1, false, false, pixels));
+}
+
+bgfx::TextureHandle createTexture(ImagePtr image) {
+  const bimg::ImageContainer* imageContainer = image->container;
+  // Released by bgfx once uploaded, which may happen on its render thread.
+  const bgfx::Memory* mem = bgfx::makeRef(imageContainer->m_data, imageContainer->m_size, imageReleaseCb,
+                                          new ImagePtr(image));
+  return bgfx::createTexture2D(uint16_t(imageContainer->m_width), uint16_t(imageContainer->m_height),
+                               1 < imageContainer->m_numMips,
+                               imageContainer->m_numLayers,
+                               bgfx::TextureFormat::Enum(imageContainer->m_format),
+                               BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE,
+                               mem);
+}
+
+bgfx::TextureHandle loadTexture(const std::string& filePath) {
+  ImagePtr image = decodeImage(filePath);
+  if (image == nullptr) return BGFX_INVALID_HANDLE;
+  return createTexture(image);
+}
+
+StreamingTexture::StreamingTexture() {
+  for (Ring& ring : rings) ring.textures.fill(BGFX_INVALID_HANDLE);
+}
+
+StreamingTexture::~StreamingTexture() {
+  for (Ring& ring : rings) release(ring);
+}
+
+void StreamingTexture::reserve(uint16_t width, uint16_t height) {
+  ringFor(width, height, bgfx::TextureFormat::RGBA8);
+}
+
+StreamingTexture::Ring& StreamingTexture::ringFor(uint16_t width, uint16_t height,
+                                                  bgfx::TextureFormat::Enum format) {
+  uses++;
+  for (Ring& ring : rings) {
+    if (ring.width == width && ring.height == height && ring.format == format) {
+      ring.used = uses;
+      return ring;
     }
-    const bgfx::Memory* mem = bgfx::makeRef(imageContainer->m_data,
-                                            imageContainer->m_size, imageReleaseCb, imageContainer);
+  }
+  // Never replace the textures being shown, else the least recently used ones.
+  size_t replaced = 0;
+  for (size_t i = 1; i < rings.size(); i++) {
+    if (i == shown) continue;
+    if (replaced == shown || rings[i].used < rings[replaced].used) replaced = i;
+  }
+  Ring& ring = rings[replaced];
+  release(ring);
+  ring.width = width;
+  ring.height = height;
+  ring.format = format;
+  ring.used = uses;
+  for (bgfx::TextureHandle& texture : ring.textures) {
+    // Without memory the texture is mutable, so that it can be updated.
+    texture = bgfx::createTexture2D(width, height, false, 1, format, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE);
+    allocations++;
+  }
+  return ring;
+}
 
-    BX_FREE(&allocator, data);
+void StreamingTexture::release(Ring& ring) {
+  for (bgfx::TextureHandle& texture : ring.textures) {
+    if (bgfx::isValid(texture)) bgfx::destroy(texture);
+    texture = BGFX_INVALID_HANDLE;
+  }
+  ring.width = 0;
+  ring.height = 0;
+  ring.format = bgfx::TextureFormat::Count;
+}
 
-    handle = bgfx::createTexture2D(uint16_t(imageContainer->m_width), uint16_t(imageContainer->m_height),
-                                   1 < imageContainer->m_numMips,
-                                   imageContainer->m_numLayers,
-                                   bgfx::TextureFormat::Enum(imageContainer->m_format),
-                                   BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE,
-                                   mem);
+void StreamingTexture::update(ImagePtr image) {
+  if (image == nullptr) {
+    hasImage = false;
+    return;
   }
+  const bimg::ImageContainer* imageContainer = image->container;
+  Ring& ring = ringFor(uint16_t(imageContainer->m_width), uint16_t(imageContainer->m_height),
+                       bgfx::TextureFormat::Enum(imageContainer->m_format));
+  ring.current = (ring.current + 1) % RingSize;
+  const bgfx::Memory* mem = bgfx::makeRef(imageContainer->m_data, imageContainer->m_size, imageReleaseCb,
+                                          new ImagePtr(image));
+  bgfx::updateTexture2D(ring.textures[ring.current], 0, 0, 0, 0, ring.width, ring.height, mem);
+  shown = size_t(&ring - rings.data());
+  hasImage = true;
+}
 
-  return handle;
+bgfx::TextureHandle StreamingTexture::handle() const {
+  if (!hasImage) return BGFX_INVALID_HANDLE;
+  const Ring& ring = rings[shown];
+  return ring.textures[ring.current];
 }
 } // namespace texture_utils
@@ -6,65 +6,77 @@
 #include "commands/keypoints.h"
 #include "commands/bounding_box.h"
 #include "commands/rectangle.h"
+#include "commands/load_annotations.h"
 
 using CommandPtr = std::unique_ptr<commands::Command>;
-using CommandStack = std::list<std::unique_ptr<commands::Command>>;
 
 using namespace commands;
-Timeline::Timeline(SceneModel& model) : sceneModel(model), commandStack() {
+Timeline::Timeline(SceneModel& model, TimelineOptions options) : sceneModel(model), options(options), commandStack() {
 }
 
-void Timeline::load(fs::path annotationPath) {
+bool Timeline::load(fs::path annotationPath) {
   commandStack.clear();
+  redoStack.clear();
+  bytes = 0;
   if (!std::filesystem::exists(annotationPath))
-    return;
-  std::ifstream file(annotationPath.string());
-  nlohmann::json json;
-  file >> json;
-  for (auto& keypoint : json["keypoints"]) {
-    auto position = keypoint["position"];
-    auto k = Vector3f(position[0].get<float>(), position[1].get<float>(), position[2].get<float>());
-    int classId = keypoint.value("class_id", 0);
-    Keypoint kp(-1, classId, k);
-    std::unique_ptr<Command> command = std::make_unique<commands::AddKeypointCommand>(kp);
-    pushCommand(std::move(command));
-  }
-  for (auto& bbox : json["bounding_boxes"]) {
-    auto p = bbox["position"];
-    auto orn = bbox["orientation"];
-    auto d = bbox["dimensions"];
-    int classId = bbox.value("classId", 0);
-    BBox box = {
-        .classId = classId,
-        .position = utils::serialize::toVector3(p),
-        .orientation = Quaternionf(orn["w"].get<float>(), orn["x"].get<float>(), orn["y"].get<float>(), orn["z"].get<float>()),
-        .dimensions = utils::serialize::toVector3(d),
-    };
-    std::unique_ptr<Command> command = std::make_unique<commands::AddBBoxCommand>(box);
-    pushCommand(std::move(command));
+    return true;
+  auto command = std::make_unique<commands::LoadAnnotationsCommand>(annotationPath);
+  command->execute(sceneModel);
+  bool loaded = command->succeeded();
+  // The history was just cleared, there is nothing to merge with or forget.
+  bytes += CommandPool::allocationSize(command.get());
+  commandStack.push_back(std::move(command));
+  return loaded;
+}
+
+void Timeline::forget(CommandStack& stack) {
+  for (const CommandPtr& command : stack) {
+    bytes -= CommandPool::allocationSize(command.get());
   }
-  for (auto& rectangle : json["rectangles"]) {
-    int classId = rectangle.value("class_id", 0);
-    Rectangle rect(0, classId,
-                   utils::serialize::toVector3(rectangle["center"]),
-                   utils::serialize::toQuaternion(rectangle["orientation"]),
-                   utils::serialize::toVector2(rectangle["size"]));
-    std::unique_ptr<Command> command = std::make_unique<commands::AddRectangleCommand>(rect);
-    pushCommand(std::move(command));
+  stack.clear();
+}
+
+void Timeline::limitHistory() {
+  while (!commandStack.empty() &&
+         (commandStack.size() + redoStack.size() > options.maxCommands || bytes > options.maxBytes)) {
+    bytes -= CommandPool::allocationSize(commandStack.front().get());
+    commandStack.pop_front();
   }
 }
 
 void Timeline::pushCommand(CommandPtr command) {
   command->execute(sceneModel);
+  Clock::time_point now = Clock::now();
+  bool continues = redoStack.empty() && !commandStack.empty() && now - lastPush < options.mergeWindow;
+  lastPush = now;
+  if (continues && commandStack.back()->merge(*command)) return;
+  forget(redoStack);
+  bytes += CommandPool::allocationSize(command.get());
   commandStack.push_back(std::move(command));
+  limitHistory();
 }
 
 void Timeline::undoCommand() {
-  if (commandStack.empty()) return;
+  if (commandStack.empty() || !commandStack.back()->undoable()) return;
   commandStack.back()->undo(sceneModel);
+  redoStack.push_back(std::move(commandStack.back()));
   commandStack.pop_back();
+  // Undoing and dragging the same annotation again starts a new edit.
+  lastPush = {};
+}
+
+void Timeline::redoCommand() {
+  if (redoStack.empty()) return;
+  redoStack.back()->execute(sceneModel);
+  commandStack.push_back(std::move(redoStack.back()));
+  redoStack.pop_back();
+  lastPush = {};
 }
 
 int Timeline::size() const {
   return commandStack.size();
 }
+
+int Timeline::redoSize() const {
+  return redoStack.size();
+}
@@ -0,0 +1,385 @@
+#include <array>
+#include <cmath>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "3rdparty/json.hpp"
+#include "utils/annotation_file.h"
+#include "utils/mapped_file.h"
+
+namespace utils::annotation_file {
+
+// Written to the file whenever this much has been formatted.
+const size_t FlushSize = 1 << 20;
+
+class JsonWriter {
+  /*
+   * Formats JSON the way nlohmann::json::dump(4) does. Keys have to be
+   * written in sorted order, as that is how nlohmann::json stores them.
+   */
+private:
+  std::ofstream& out;
+  std::string buffer;
+  // For each open object or array, whether anything has been written to it.
+  std::vector<bool> written;
+  bool afterKey = false;
+
+  void indent(size_t depth) {
+    buffer.append(depth * 4, ' ');
+  }
+  void beginValue() {
+    if (afterKey) {
+      afterKey = false;
+      return;
+    }
+    if (written.empty()) return;
+    if (written.back()) buffer += ',';
+    buffer += '\n';
+    indent(written.size());
+    written.back() = true;
+  }
+  void end(char close) {
+    bool any = written.back();
+    written.pop_back();
+    if (any) {
+      buffer += '\n';
+      indent(written.size());
+    }
+    buffer += close;
+    if (buffer.size() >= FlushSize) flush();
+  }
+
+public:
+  JsonWriter(std::ofstream& out) : out(out) {
+    buffer.reserve(FlushSize + 4096);
+  }
+  ~JsonWriter() { flush(); }
+
+  void beginObject() {
+    beginValue();
+    buffer += '{';
+    written.push_back(false);
+  }
+  void endObject() { end('}'); }
+  void beginArray() {
+    beginValue();
+    buffer += '[';
+    written.push_back(false);
+  }
+  void endArray() { end(']'); }
+  void key(const char* name) {
+    beginValue();
+    buffer += '"';
+    buffer += name;
+    buffer += "\": ";
+    afterKey = true;
+  }
+  void value(int number) {
+    beginValue();
+    char characters[16];
+    char* last = std::to_chars(characters, characters + sizeof(characters), number).ptr;
+    buffer.append(characters, last);
+  }
+  void value(float number) {
+    beginValue();
+    // nlohmann::json stores numbers as doubles and writes non-finite ones as null.
+    double x = number;
+    if (!std::isfinite(x)) {
+      buffer += "null";
+      return;
+    }
+    std::array<char, 64> characters;
+    char* last = nlohmann::detail::to_chars(characters.data(), characters.data() + characters.size(), x);
+    buffer.append(characters.data(), last);
+  }
+  template <typename Vector>
+  void vector(const Vector& v) {
+    beginArray();
+    for (int i = 0; i < v.size(); i++) {
+      value(float(v[i]));
+    }
+    endArray();
+  }
+  void quaternion(const Quaternionf& q) {
+    beginObject();
+    key("w");
+    value(q.w());
+    key("x");
+    value(q.x());
+    key("y");
+    value(q.y());
+    key("z");
+    value(q.z());
+    endObject();
+  }
+  void flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+};
+
+static void writeAnnotations(std::ofstream& file, const std::vector<Keypoint>& keypoints,
+                             const std::vector<BBox>& boundingBoxes, const std::vector<Rectangle>& rectangles,
+                             const AnnotationIds& nextIds) {
+  JsonWriter writer(file);
+  writer.beginObject();
+  if (!boundingBoxes.empty()) {
+    writer.key("bounding_boxes");
+    writer.beginArray();
+    for (const BBox& bbox : boundingBoxes) {
+      writer.beginObject();
+      writer.key("class_id");
+      writer.value(bbox.classId);
+      writer.key("dimensions");
+      writer.vector(bbox.dimensions);
+      writer.key("id");
+      writer.value(bbox.id);
+      writer.key("orientation");
+      writer.quaternion(bbox.orientation);
+      writer.key("position");
+      writer.vector(bbox.position);
+      writer.endObject();
+    }
+    writer.endArray();
+  }
+  if (!keypoints.empty()) {
+    writer.key("keypoints");
+    writer.beginArray();
+    for (const Keypoint& keypoint : keypoints) {
+      writer.beginObject();
+      writer.key("class_id");
+      writer.value(keypoint.classId);
+      writer.key("id");
+      writer.value(keypoint.id);
+      writer.key("position");
+      writer.vector(keypoint.position);
+      writer.endObject();
+    }
+    writer.endArray();
+  }
+  writer.key("next_ids");
+  writer.beginObject();
+  writer.key("bounding_boxes");
+  writer.value(nextIds.boundingBoxes);
+  writer.key("keypoints");
+  writer.value(nextIds.keypoints);
+  writer.key("rectangles");
+  writer.value(nextIds.rectangles);
+  writer.endObject();
+  if (!rectangles.empty()) {
+    writer.key("rectangles");
+    writer.beginArray();
+    for (const Rectangle& rectangle : rectangles) {
+      writer.beginObject();
+      writer.key("center");
+      writer.vector(rectangle.center);
+      writer.key("class_id");
+      writer.value(rectangle.classId);
+      writer.key("id");
+      writer.value(rectangle.id);
+      writer.key("orientation");
+      writer.quaternion(rectangle.orientation);
+      writer.key("size");
+      writer.vector(rectangle.size);
+      writer.endObject();
+    }
+    writer.endArray();
+  }
+  writer.endObject();
+}
+
+static bool syncToDisk(const std::filesystem::path& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  bool synced = fsync(fd) == 0;
+  close(fd);
+  return synced;
+}
+
+bool write(const std::filesystem::path& path, const std::vector<Keypoint>& keypoints,
+           const std::vector<BBox>& boundingBoxes, const std::vector<Rectangle>& rectangles,
+           const AnnotationIds& nextIds) {
+  std::filesystem::path temporaryPath = path;
+  temporaryPath += ".tmp";
+  std::error_code error;
+  {
+    std::ofstream file(temporaryPath, std::ios::binary);
+    writeAnnotations(file, keypoints, boundingBoxes, rectangles, nextIds);
+    file.close();
+    if (!file) {
+      std::cout << "Could not write annotations to " << temporaryPath.string() << std::endl;
+      std::filesystem::remove(temporaryPath, error);
+      return false;
+    }
+  }
+  // Otherwise the rename could reach the disk before the contents do.
+  if (!syncToDisk(temporaryPath)) {
+    std::cout << "Could not sync " << temporaryPath.string() << " to disk." << std::endl;
+  }
+  std::filesystem::rename(temporaryPath, path, error);
+  if (error) {
+    std::cout << "Could not replace " << path.string() << ": " << error.message() << std::endl;
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  return true;
+}
+
+enum class Section {
+  Other,
+  Keypoints,
+  BoundingBoxes,
+  Rectangles,
+  NextIds
+};
+
+class AnnotationReader : public nlohmann::json_sax<nlohmann::json> {
+  /*
+   * Keeps track of where in the document the parser is by nesting depth:
+   * 1 is the top level object, 2 the array of a type of annotation, 3 an
+   * annotation and 4 a vector or quaternion within it.
+   */
+private:
+  Annotations& annotations;
+  int depth = 0;
+  Section section = Section::Other;
+  std::string field;
+  // Where the numbers of a vector or quaternion field go.
+  float* target = nullptr;
+  int targetSize = 0;
+  int index = 0;
+
+  // The fields of the annotation being read.
+  int id;
+  std::optional<int> classId;
+  int legacyClassId;
+  Vector3f position;
+  Vector3f dimensions;
+  Vector2f size;
+  // In w, x, y, z order.
+  Vector4f orientation;
+
+  void beginAnnotation() {
+    id = -1;
+    classId.reset();
+    legacyClassId = 0;
+    position = Vector3f::Zero();
+    dimensions = BBox().dimensions;
+    size = Vector2f::Zero();
+    orientation = Vector4f(1.0f, 0.0f, 0.0f, 0.0f);
+  }
+  void endAnnotation() {
+    int annotationClass = classId.value_or(legacyClassId);
+    Quaternionf rotation(orientation[0], orientation[1], orientation[2], orientation[3]);
+    switch (section) {
+    case Section::Keypoints:
+      annotations.keypoints.emplace_back(id, annotationClass, position);
+      break;
+    case Section::BoundingBoxes:
+      annotations.boundingBoxes.push_back({.id = id,
+                                           .classId = annotationClass,
+                                           .position = position,
+                                           .orientation = rotation,
+                                           .dimensions = dimensions});
+      break;
+    case Section::Rectangles:
+      annotations.rectangles.emplace_back(id, annotationClass, position, rotation, size);
+      break;
+    default:
+      break;
+    }
+  }
+  void setTarget(const std::string& name) {
+    target = nullptr;
+    targetSize = 0;
+    index = 0;
+    if (name == "position" || name == "center") {
+      target = position.data(), targetSize = 3;
+    } else if (name == "dimensions") {
+      target = dimensions.data(), targetSize = 3;
+    } else if (name == "size") {
+      target = size.data(), targetSize = 2;
+    }
+  }
+  bool number(double value) {
+    if (depth == 2 && section == Section::NextIds) {
+      AnnotationIds& ids = annotations.nextIds.value();
+      if (field == "keypoints") ids.keypoints = int(value);
+      else if (field == "bounding_boxes") ids.boundingBoxes = int(value);
+      else if (field == "rectangles") ids.rectangles = int(value);
+    } else if (depth == 3) {
+      if (field == "id") id = int(value);
+      else if (field == "class_id") classId = int(value);
+      else if (field == "classId") legacyClassId = int(value);
+    } else if (depth == 4 && field == "orientation") {
+      if (index >= 0) orientation[index] = float(value);
+    } else if (depth == 4 && index < targetSize) {
+      target[index++] = float(value);
+    }
+    return true;
+  }
+
+public:
+  AnnotationReader(Annotations& annotations) : annotations(annotations) {}
+
+  bool null() override { return true; }
+  bool boolean(bool) override { return true; }
+  bool number_integer(number_integer_t value) override { return number(double(value)); }
+  bool number_unsigned(number_unsigned_t value) override { return number(double(value)); }
+  bool number_float(number_float_t value, const string_t&) override { return number(value); }
+  bool string(string_t&) override { return true; }
+  bool binary(binary_t&) override { return true; }
+
+  bool start_object(std::size_t) override {
+    depth++;
+    if (depth == 3) beginAnnotation();
+    return true;
+  }
+  bool end_object() override {
+    if (depth == 3) endAnnotation();
+    depth--;
+    return true;
+  }
+  bool start_array(std::size_t) override {
+    depth++;
+    return true;
+  }
+  bool end_array() override {
+    depth--;
+    return true;
+  }
+  bool key(string_t& name) override {
+    if (depth == 1) {
+      section = Section::Other;
+      if (name == "keypoints") section = Section::Keypoints;
+      else if (name == "bounding_boxes") section = Section::BoundingBoxes;
+      else if (name == "rectangles") section = Section::Rectangles;
+      else if (name == "next_ids") {
+        section = Section::NextIds;
+        annotations.nextIds = AnnotationIds();
+      }
+    } else if (depth == 2 || depth == 3) {
+      field = name;
+      setTarget(name);
+    } else if (depth == 4 && field == "orientation") {
+      index = name == "w" ? 0 : name == "x" ? 1 : name == "y" ? 2 : name == "z" ? 3 : -1;
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& error) override {
+    std::cout << "Could not parse annotations at byte " << position << ": " << error.what() << std::endl;
+    return false;
+  }
+};
+
+bool read(const std::filesystem::path& path, Annotations& annotations) {
+  utils::MappedFile file(path);
+  const char* data = reinterpret_cast<const char*>(file.data());
+  AnnotationReader reader(annotations);
+  return nlohmann::json::sax_parse(data, data + file.size(), &reader);
+}
+
+} // namespace utils::annotation_file
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#include "utils/autosave.h"
+#include "utils/annotation_file.h"
+#include "utils/journal.h"
+
+namespace utils {
+
+static double millisecondsSince(Autosave::Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Autosave::Clock::now() - start).count();
+}
+
+void Autosave::Timing::add(double ms) {
+  count++;
+  total += ms;
+  worst = std::max(worst, ms);
+}
+
+Autosave::Autosave(AutosaveOptions options) : options(options) {
+  worker = std::thread(&Autosave::run, this);
+}
+
+Autosave::~Autosave() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_one();
+  worker.join();
+}
+
+void Autosave::update(SceneModel& scene, const std::filesystem::path& path) {
+  uint64_t revision = scene.getAnnotationRevision();
+  if (scheduledRevision == revision || path == keptPath) return;
+  Clock::time_point start = Clock::now();
+  Clock::time_point changedAt = now();
+  std::vector<AnnotationEdit> edits = scene.takeEdits();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!edits.empty()) {
+      // Edits to another file were written by flush before switching to this one.
+      if (journalTarget != path) unjournaled.clear();
+      journalTarget = path;
+      unjournaled.insert(unjournaled.end(), std::make_move_iterator(edits.begin()), std::make_move_iterator(edits.end()));
+    }
+    if (!pending.has_value()) firstChange = changedAt;
+    lastChange = changedAt;
+    pending = Job{scene.snapshot(), path};
+  }
+  changed.notify_one();
+  scheduledRevision = revision;
+  snapshotTiming.add(millisecondsSince(start));
+}
+
+bool Autosave::save(SceneModel& scene, const std::filesystem::path& path) {
+  if (path == keptPath) {
+    std::cout << "Not saving to " << path.string() << ", which could not be read." << std::endl;
+    return false;
+  }
+  // Saved along with everything else, edits still queued for the journal are dropped when written.
+  scene.takeEdits();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending.reset();
+  }
+  scheduledRevision = scene.getAnnotationRevision();
+  return write({scene.snapshot(), path});
+}
+
+void Autosave::markSaved(SceneModel& scene) {
+  scene.takeEdits();
+  std::unique_lock<std::mutex> lock(mutex);
+  pending.reset();
+  unjournaled.clear();
+  scheduledRevision = scene.getAnnotationRevision();
+}
+
+size_t Autosave::restore(SceneModel& scene, const std::filesystem::path& path, bool loaded) {
+  markSaved(scene);
+  keptPath.clear();
+  scene.recordEdits(true);
+  std::filesystem::path journalPath = journal::pathFor(path);
+  // Saving the scene would replace a file that could not be read, and the edits in the journal only apply on top of it.
+  if (!loaded) {
+    std::cout << "Keeping " << path.string() << " and its journal as they are." << std::endl;
+    keptPath = path;
+    scene.recordEdits(false);
+    return 0;
+  }
+  if (!std::filesystem::exists(journalPath)) return 0;
+  std::vector<AnnotationEdit> edits = journal::read(journalPath);
+  for (const AnnotationEdit& edit : edits) {
+    scene.applyEdit(edit);
+  }
+  if (!edits.empty()) {
+    std::cout << "Recovered " << edits.size() << " unsaved edits from " << journalPath.string() << std::endl;
+  }
+  // Compacts the journal into the file, which also removes it.
+  save(scene, path);
+  return edits.size();
+}
+
+void Autosave::flush() {
+  std::optional<Job> job;
+  std::vector<AnnotationEdit> edits;
+  std::filesystem::path path;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    job.swap(pending);
+    edits.swap(unjournaled);
+    path = journalTarget;
+    // A save the worker already took is waited for.
+    writeDone.wait(lock, [&]() { return !writing; });
+  }
+  if (!edits.empty()) appendToJournal(path, std::move(edits));
+  if (job.has_value()) write(job.value());
+}
+
+void Autosave::clockChanged() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.notify_one();
+  writeDone.wait(lock, [&]() {
+    return !writing && unjournaled.empty() && (!pending.has_value() || now() < due());
+  });
+}
+
+Autosave::Clock::time_point Autosave::now() const {
+  return options.now ? options.now() : Clock::now();
+}
+
+Autosave::Clock::time_point Autosave::due() const {
+  // Edits keep pushing the save back, up to the maximum delay.
+  return std::min(lastChange + options.delay, firstChange + options.maxDelay);
+}
+
+size_t Autosave::saveCount() {
+  std::unique_lock<std::mutex> lock(mutex);
+  return writeTiming.count;
+}
+
+void Autosave::print(std::ostream& out) {
+  std::unique_lock<std::mutex> lock(mutex);
+  out << "Saved annotations " << writeTiming.count << " times, " << failedWrites << " failed. Writing took "
+      << writeTiming.mean() << " ms on average, at most " << writeTiming.worst << " ms." << std::endl;
+  out << "Appended edits to the journal " << journalTiming.count << " times, taking " << journalTiming.mean()
+      << " ms on average, at most " << journalTiming.worst << " ms." << std::endl;
+  out << "Snapshots on the UI thread took " << snapshotTiming.mean() << " ms on average, at most "
+      << snapshotTiming.worst << " ms over " << snapshotTiming.count << " changes." << std::endl;
+}
+
+bool Autosave::write(const Job& job) {
+  std::unique_lock<std::mutex> writeLock(writeMutex);
+  const AnnotationSnapshot& snapshot = job.snapshot;
+  if (lastWrittenPath == job.path && lastWrittenRevision > snapshot.revision) return true;
+  Clock::time_point start = Clock::now();
+  bool written = annotation_file::write(job.path, *snapshot.keypoints, *snapshot.boundingBoxes, *snapshot.rectangles,
+                                        snapshot.nextIds);
+  double ms = millisecondsSince(start);
+  if (written) {
+    lastWrittenPath = job.path;
+    lastWrittenRevision = snapshot.revision;
+    // The journal only needs to keep the edits made after the snapshot.
+    if (journaledPath == job.path) {
+      std::erase_if(journaled, [&](const AnnotationEdit& edit) { return edit.revision <= snapshot.revision; });
+      journal::rewrite(journal::pathFor(job.path), journaled);
+    } else {
+      journal::rewrite(journal::pathFor(job.path), {});
+    }
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  if (written) {
+    writeTiming.add(ms);
+  } else {
+    failedWrites++;
+  }
+  return written;
+}
+
+void Autosave::appendToJournal(const std::filesystem::path& path, std::vector<AnnotationEdit> edits) {
+  std::unique_lock<std::mutex> writeLock(writeMutex);
+  // Edits the file was saved with since they were queued.
+  if (lastWrittenPath == path) {
+    std::erase_if(edits, [&](const AnnotationEdit& edit) { return edit.revision <= lastWrittenRevision; });
+  }
+  if (edits.empty()) return;
+  if (journaledPath != path) {
+    journaled.clear();
+    journaledPath = path;
+  }
+  Clock::time_point start = Clock::now();
+  bool written = journal::append(journal::pathFor(path), edits);
+  double ms = millisecondsSince(start);
+  if (written) {
+    journaled.insert(journaled.end(), std::make_move_iterator(edits.begin()), std::make_move_iterator(edits.end()));
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  if (written) {
+    journalTiming.add(ms);
+  } else {
+    failedWrites++;
+  }
+}
+
+void Autosave::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    // Edits go to the journal right away, they are cheap to write.
+    if (!unjournaled.empty()) {
+      std::vector<AnnotationEdit> edits;
+      edits.swap(unjournaled);
+      std::filesystem::path path = journalTarget;
+      writing = true;
+      lock.unlock();
+      appendToJournal(path, std::move(edits));
+      lock.lock();
+      writing = false;
+      writeDone.notify_all();
+      continue;
+    }
+    if (!pending.has_value()) {
+      if (stopping) return;
+      changed.wait(lock);
+      continue;
+    }
+    if (!stopping && now() < due()) {
+      if (options.now) {
+        // Woken by clockChanged.
+        changed.wait(lock);
+      } else {
+        changed.wait_until(lock, due());
+      }
+      continue;
+    }
+    Job job = std::move(pending.value());
+    pending.reset();
+    writing = true;
+    lock.unlock();
+    write(job);
+    lock.lock();
+    writing = false;
+    writeDone.notify_all();
+  }
+}
+
+} // namespace utils
@@ -1,7 +1,13 @@
 #include "utils/dataset.h"
 #include "utils/serialize.h"
+#include "utils/mapped_file.h"
 #include <iostream>
 #include <fstream>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <algorithm>
 #include "3rdparty/json.hpp"
 #include "commands/keypoints.h"
 #include "commands/bounding_box.h"
@@ -46,33 +52,206 @@ std::vector<fs::path> getDatasetPointCloudPaths(fs::path path) {
   return pointClouds;
 }
 
-std::vector<Eigen::Matrix4f> getDatasetCameraTrajectory(fs::path path) {
-  if (!std::filesystem::exists(path)) {
-    std::cout << "Camera trajectory does not exist at " << path.string() << std::endl;
-    exit(1);
+namespace {
+const char TrajectoryMagic[8] = {'S', 'T', 'R', 'A', 'Y', 'T', 'R', 'J'};
+const uint32_t TrajectoryVersion = 1;
+// The file is split into chunks of about this size, which are parsed in parallel.
+const size_t TrajectoryChunkSize = 1 << 16;
+// An id line and four rows.
+const size_t LinesPerPose = 5;
+
+struct TrajectoryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t sourceSize;
+  int64_t sourceModified;
+};
+
+// The transforms are stored row by row, as in trajectory.log.
+using RowMajorPose = Eigen::Matrix<float, 4, 4, Eigen::RowMajor>;
+
+fs::path trajectoryCachePath(const fs::path& path) {
+  return path.parent_path() / ("." + path.filename().string() + ".bin");
+}
+
+int64_t modifiedTime(const fs::path& path) {
+  return int64_t(fs::last_write_time(path).time_since_epoch().count());
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* lineEnd(const char* begin, const char* end) {
+  const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+  return newline == nullptr ? end : newline;
+}
+
+// Whether the line has nothing but spaces, e.g. a trailing line or what is left of one ending in \r\n.
+bool isBlank(const char* begin, const char* end) {
+  return std::all_of(begin, end, isSpace);
+}
+
+// Parses the number the text starts with, returns where it ends or nullptr if there is none.
+const char* parseFloat(const char* begin, const char* end, float& value) {
+#if defined(__cpp_lib_to_chars)
+  auto result = std::from_chars(begin, end, value);
+  return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+  // Standard libraries without std::from_chars for floats, e.g. Apple's libc++. strtof needs a
+  // terminated string, so the number is copied out of the file first.
+  char number[64];
+  const char* numberEnd = std::find_if(begin, begin + std::min<size_t>(end - begin, sizeof(number) - 1),
+                                       [](char c) { return isSpace(c) || c == '\n'; });
+  std::memcpy(number, begin, numberEnd - begin);
+  number[numberEnd - begin] = '\0';
+  char* stop = nullptr;
+  value = std::strtof(number, &stop);
+  return stop == number ? nullptr : begin + (stop - number);
+#endif
+}
+
+// Parses the first four numbers of the line into the row, missing ones are zero.
+void parseRow(const char* begin, const char* end, Eigen::Matrix4f& pose, int row) {
+  for (int j = 0; j < 4; j++) {
+    while (begin < end && isSpace(*begin)) begin++;
+    float value = 0.0f;
+    const char* next = parseFloat(begin, end, value);
+    if (next == nullptr) {
+      for (int k = j; k < 4; k++) pose(row, k) = 0.0f;
+      return;
+    }
+    pose(row, j) = value;
+    begin = next;
+  }
+}
+
+std::optional<std::vector<Eigen::Matrix4f>> readTrajectoryCache(const fs::path& path) {
+  fs::path cachePath = trajectoryCachePath(path);
+  std::error_code error;
+  if (!fs::exists(cachePath, error)) return std::nullopt;
+  try {
+    utils::MappedFile file(cachePath);
+    TrajectoryHeader header;
+    if (file.size() < sizeof(header)) return std::nullopt;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, TrajectoryMagic, sizeof(TrajectoryMagic)) != 0 || header.version != TrajectoryVersion ||
+        header.sourceSize != fs::file_size(path) || header.sourceModified != modifiedTime(path) ||
+        file.size() != sizeof(header) + size_t(header.count) * sizeof(RowMajorPose)) {
+      return std::nullopt;
+    }
+    std::vector<Eigen::Matrix4f> poses(header.count);
+    const uint8_t* data = file.data() + sizeof(header);
+    for (size_t i = 0; i < poses.size(); i++) {
+      RowMajorPose pose;
+      std::memcpy(pose.data(), data + i * sizeof(RowMajorPose), sizeof(RowMajorPose));
+      poses[i] = pose;
+    }
+    return poses;
+  } catch (const std::exception& e) {
+    return std::nullopt;
+  }
+}
+
+void writeTrajectoryCache(const fs::path& path, const std::vector<Eigen::Matrix4f>& poses) {
+  fs::path cachePath = trajectoryCachePath(path);
+  fs::path temporary = cachePath;
+  temporary += ".tmp";
+  std::error_code error;
+  TrajectoryHeader header;
+  std::memcpy(header.magic, TrajectoryMagic, sizeof(TrajectoryMagic));
+  header.version = TrajectoryVersion;
+  header.count = uint32_t(poses.size());
+  header.sourceSize = fs::file_size(path, error);
+  header.sourceModified = error ? 0 : modifiedTime(path);
+  if (error) return;
+  {
+    std::ofstream out(temporary, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Eigen::Matrix4f& pose : poses) {
+      RowMajorPose rows = pose;
+      out.write(reinterpret_cast<const char*>(rows.data()), sizeof(RowMajorPose));
+    }
+    out.close();
+    if (!out) {
+      // The dataset may well be read only, it is parsed again next time.
+      fs::remove(temporary, error);
+      return;
+    }
+  }
+  fs::rename(temporary, cachePath, error);
+  if (error) fs::remove(temporary, error);
+}
+} // namespace
+
+std::vector<Eigen::Matrix4f> parseCameraTrajectory(const char* data, size_t size) {
+  const char* end = data + size;
+  // Chunks start at the beginning of a line.
+  std::vector<const char*> chunkStarts = {data};
+  while (chunkStarts.back() + TrajectoryChunkSize < end) {
+    const char* start = lineEnd(chunkStarts.back() + TrajectoryChunkSize, end);
+    if (start == end) break;
+    chunkStarts.push_back(start + 1);
   }
-  std::fstream in;
-  in.open(path.string(), std::ios::in);
-  if (in.fail()) return {};
-  std::string line;
-  Eigen::Vector4f row;
-  std::vector<Eigen::Matrix4f> out;
-  while (true) {
-    if (!std::getline(in, line)) {
-      break;
+  chunkStarts.push_back(end);
+  const int64_t chunkCount = int64_t(chunkStarts.size()) - 1;
+
+  // Which line each chunk starts at, so that lines can be told apart by their index. Blank lines
+  // are skipped and not counted.
+  std::vector<size_t> firstLines(chunkCount + 1, 0);
+#pragma omp parallel for
+  for (int64_t chunk = 0; chunk < chunkCount; chunk++) {
+    size_t lines = 0;
+    for (const char* begin = chunkStarts[chunk]; begin < chunkStarts[chunk + 1];) {
+      const char* lineStop = lineEnd(begin, chunkStarts[chunk + 1]);
+      if (!isBlank(begin, lineStop)) lines++;
+      begin = lineStop + 1;
     }
-    Eigen::Matrix4f pose;
-    for (int i = 0; i < 4; i++) {
-      std::getline(in, line);
-      std::stringstream lineStream(line);
-      for (int j = 0; j < 4; j++) {
-        lineStream >> row[j];
+    firstLines[chunk + 1] = lines;
+  }
+  for (int64_t chunk = 0; chunk < chunkCount; chunk++) {
+    firstLines[chunk + 1] += firstLines[chunk];
+  }
+
+  std::vector<Eigen::Matrix4f> poses(firstLines.back() / LinesPerPose);
+#pragma omp parallel for
+  for (int64_t chunk = 0; chunk < chunkCount; chunk++) {
+    size_t line = firstLines[chunk];
+    for (const char* begin = chunkStarts[chunk]; begin < chunkStarts[chunk + 1];) {
+      const char* lineStop = lineEnd(begin, chunkStarts[chunk + 1]);
+      if (!isBlank(begin, lineStop)) {
+        size_t pose = line / LinesPerPose;
+        size_t row = line % LinesPerPose;
+        if (row > 0 && pose < poses.size()) parseRow(begin, lineStop, poses[pose], int(row - 1));
+        line++;
       }
-      pose.row(i) = row;
+      begin = lineStop + 1;
     }
-    out.push_back(pose);
   }
-  return out;
+  return poses;
+}
+
+std::vector<Eigen::Matrix4f> getDatasetCameraTrajectory(fs::path path, bool cache) {
+  std::error_code error;
+  if (!fs::exists(path, error)) {
+    std::cout << "Camera trajectory does not exist at " << path.string() << std::endl;
+    return {};
+  }
+  if (cache) {
+    auto cached = readTrajectoryCache(path);
+    if (cached.has_value()) return std::move(*cached);
+  }
+  std::vector<Eigen::Matrix4f> poses;
+  try {
+    utils::MappedFile file(path);
+    poses = parseCameraTrajectory(reinterpret_cast<const char*>(file.data()), file.size());
+  } catch (const std::exception& e) {
+    std::cout << "Could not read camera trajectory: " << e.what() << std::endl;
+    return {};
+  }
+  if (cache) writeTrajectoryCache(path, poses);
+  return poses;
 }
 
 DatasetMetadata getDatasetMetadata(fs::path path) {
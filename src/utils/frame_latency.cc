@@ -0,0 +1,31 @@
+#include <algorithm>
+#include "utils/frame_latency.h"
+
+namespace utils {
+
+void FrameLatency::eventReceived(Clock::time_point time) {
+  if (!pendingEvent.has_value()) pendingEvent = time;
+}
+
+void FrameLatency::frameRendered(Clock::time_point time) {
+  frames++;
+  if (!pendingEvent.has_value()) return;
+  double latency = std::chrono::duration<double, std::milli>(time - pendingEvent.value()).count();
+  latencyCount++;
+  totalLatency += latency;
+  worstLatency = std::max(worstLatency, latency);
+  pendingEvent.reset();
+}
+
+double FrameLatency::meanLatency() const {
+  if (latencyCount == 0) return 0.0;
+  return totalLatency / double(latencyCount);
+}
+
+void FrameLatency::print(std::ostream& out) const {
+  out << "Rendered " << frames << " frames, waited for input " << idleWaits << " times." << std::endl;
+  out << "Input latency: mean " << meanLatency() << " ms, max " << maxLatency() << " ms over "
+      << latencyCount << " frames with input." << std::endl;
+}
+
+} // namespace utils
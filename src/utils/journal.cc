@@ -0,0 +1,251 @@
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "utils/journal.h"
+#include "utils/mapped_file.h"
+
+namespace utils::journal {
+
+// Starts every journal, the last two characters are the format version.
+const char Magic[8] = {'S', 'T', 'R', 'A', 'Y', 'J', '0', '1'};
+// Size and checksum of the record that follows.
+const size_t RecordHeaderSize = 2 * sizeof(uint32_t);
+
+static uint32_t checksum(const char* data, size_t size) {
+  // FNV-1a.
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ uint8_t(data[i])) * 16777619u;
+  }
+  return hash;
+}
+
+template <typename T>
+static void put(std::string& out, const T& value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void putFloats(std::string& out, const float* values, int count) {
+  out.append(reinterpret_cast<const char*>(values), count * sizeof(float));
+}
+
+static void putQuaternion(std::string& out, const Quaternionf& q) {
+  float wxyz[4] = {q.w(), q.x(), q.y(), q.z()};
+  putFloats(out, wxyz, 4);
+}
+
+static void encode(std::string& out, const AnnotationEdit& edit) {
+  size_t start = out.size();
+  out.append(RecordHeaderSize, '\0');
+  put(out, uint8_t(edit.kind));
+  put(out, int32_t(edit.id));
+  switch (edit.kind) {
+  case AnnotationEdit::SetKeypoint: {
+    const Keypoint& keypoint = std::get<Keypoint>(edit.annotation);
+    put(out, int32_t(keypoint.classId));
+    putFloats(out, keypoint.position.data(), 3);
+    break;
+  }
+  case AnnotationEdit::SetBoundingBox: {
+    const BBox& bbox = std::get<BBox>(edit.annotation);
+    put(out, int32_t(bbox.classId));
+    putFloats(out, bbox.position.data(), 3);
+    putQuaternion(out, bbox.orientation);
+    putFloats(out, bbox.dimensions.data(), 3);
+    break;
+  }
+  case AnnotationEdit::SetRectangle: {
+    const Rectangle& rectangle = std::get<Rectangle>(edit.annotation);
+    put(out, int32_t(rectangle.classId));
+    putFloats(out, rectangle.center.data(), 3);
+    putQuaternion(out, rectangle.orientation);
+    putFloats(out, rectangle.size.data(), 2);
+    break;
+  }
+  default:
+    break;
+  }
+  uint32_t header[2] = {uint32_t(out.size() - start - RecordHeaderSize), 0};
+  header[1] = checksum(out.data() + start + RecordHeaderSize, header[0]);
+  std::memcpy(out.data() + start, header, RecordHeaderSize);
+}
+
+class RecordReader {
+  /*
+   * Reads the fields of one record, failing instead of reading past its end.
+   */
+private:
+  const char* data;
+  size_t size;
+  size_t offset = 0;
+
+public:
+  RecordReader(const char* data, size_t size) : data(data), size(size) {}
+
+  template <typename T>
+  bool get(T& value) {
+    if (offset + sizeof(T) > size) return false;
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+  }
+  bool getFloats(float* values, int count) {
+    if (offset + count * sizeof(float) > size) return false;
+    std::memcpy(values, data + offset, count * sizeof(float));
+    offset += count * sizeof(float);
+    return true;
+  }
+  bool getQuaternion(Quaternionf& q) {
+    float wxyz[4];
+    if (!getFloats(wxyz, 4)) return false;
+    q = Quaternionf(wxyz[0], wxyz[1], wxyz[2], wxyz[3]);
+    return true;
+  }
+  bool done() const { return offset == size; }
+};
+
+static bool decode(const char* data, size_t size, AnnotationEdit& edit) {
+  RecordReader record(data, size);
+  uint8_t kind;
+  int32_t id;
+  int32_t classId = 0;
+  if (!record.get(kind) || !record.get(id)) return false;
+  edit.kind = AnnotationEdit::Kind(kind);
+  edit.id = id;
+  switch (edit.kind) {
+  case AnnotationEdit::SetKeypoint: {
+    Keypoint keypoint(id);
+    if (!record.get(classId) || !record.getFloats(keypoint.position.data(), 3)) return false;
+    keypoint.classId = classId;
+    edit.annotation = keypoint;
+    break;
+  }
+  case AnnotationEdit::SetBoundingBox: {
+    BBox bbox{.id = id, .classId = 0, .position = Vector3f::Zero()};
+    if (!record.get(classId) || !record.getFloats(bbox.position.data(), 3) || !record.getQuaternion(bbox.orientation) ||
+        !record.getFloats(bbox.dimensions.data(), 3)) {
+      return false;
+    }
+    bbox.classId = classId;
+    edit.annotation = bbox;
+    break;
+  }
+  case AnnotationEdit::SetRectangle: {
+    Vector3f center;
+    Quaternionf orientation;
+    Vector2f size;
+    if (!record.get(classId) || !record.getFloats(center.data(), 3) || !record.getQuaternion(orientation) ||
+        !record.getFloats(size.data(), 2)) {
+      return false;
+    }
+    edit.annotation = Rectangle(id, classId, center, orientation, size);
+    break;
+  }
+  case AnnotationEdit::RemoveKeypoint:
+  case AnnotationEdit::RemoveBoundingBox:
+  case AnnotationEdit::RemoveRectangle:
+    break;
+  default:
+    return false;
+  }
+  return record.done();
+}
+
+std::filesystem::path pathFor(const std::filesystem::path& annotationPath) {
+  std::filesystem::path path = annotationPath;
+  path += ".journal";
+  return path;
+}
+
+static bool writeAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+    if (count < 0) return false;
+    written += size_t(count);
+  }
+  return true;
+}
+
+// Writes to the file at its end and syncs it, creating it with the header if needed.
+static bool appendToFile(const std::filesystem::path& path, const std::vector<AnnotationEdit>& edits, int flags) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | flags, 0644);
+  if (fd < 0) {
+    std::cout << "Could not open journal " << path.string() << std::endl;
+    return false;
+  }
+  std::string data;
+  if (lseek(fd, 0, SEEK_END) == 0) data.append(Magic, sizeof(Magic));
+  for (const AnnotationEdit& edit : edits) {
+    encode(data, edit);
+  }
+  bool written = writeAll(fd, data) && fdatasync(fd) == 0;
+  close(fd);
+  if (!written) {
+    std::cout << "Could not write to journal " << path.string() << std::endl;
+  }
+  return written;
+}
+
+bool append(const std::filesystem::path& path, const std::vector<AnnotationEdit>& edits) {
+  if (edits.empty()) return true;
+  return appendToFile(path, edits, 0);
+}
+
+bool rewrite(const std::filesystem::path& path, const std::vector<AnnotationEdit>& edits) {
+  std::error_code error;
+  if (edits.empty()) {
+    std::filesystem::remove(path, error);
+    if (error) {
+      std::cout << "Could not remove journal " << path.string() << ": " << error.message() << std::endl;
+    }
+    return !error;
+  }
+  std::filesystem::path temporaryPath = path;
+  temporaryPath += ".tmp";
+  if (!appendToFile(temporaryPath, edits, O_TRUNC)) {
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  std::filesystem::rename(temporaryPath, path, error);
+  if (error) {
+    std::cout << "Could not replace journal " << path.string() << ": " << error.message() << std::endl;
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  return true;
+}
+
+std::vector<AnnotationEdit> read(const std::filesystem::path& path) {
+  std::vector<AnnotationEdit> edits;
+  if (!std::filesystem::exists(path)) return edits;
+  utils::MappedFile file(path);
+  const char* data = reinterpret_cast<const char*>(file.data());
+  size_t size = file.size();
+  if (size < sizeof(Magic) || std::memcmp(data, Magic, sizeof(Magic)) != 0) {
+    std::cout << "Not a journal: " << path.string() << std::endl;
+    return edits;
+  }
+  size_t offset = sizeof(Magic);
+  while (offset + RecordHeaderSize <= size) {
+    uint32_t header[2];
+    std::memcpy(header, data + offset, RecordHeaderSize);
+    const char* record = data + offset + RecordHeaderSize;
+    AnnotationEdit edit;
+    if (header[0] > size - offset - RecordHeaderSize || checksum(record, header[0]) != header[1] ||
+        !decode(record, header[0], edit)) {
+      break;
+    }
+    edit.revision = edits.size() + 1;
+    edits.push_back(std::move(edit));
+    offset += RecordHeaderSize + header[0];
+  }
+  if (offset != size) {
+    std::cout << "Ignoring " << size - offset << " bytes at the end of journal " << path.string()
+              << ", they were not completely written." << std::endl;
+  }
+  return edits;
+}
+
+} // namespace utils::journal
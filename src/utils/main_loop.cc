@@ -0,0 +1,19 @@
+#include <mutex>
+#include "utils/main_loop.h"
+
+namespace utils::main_loop {
+
+static std::mutex mutex;
+static std::function<void()> wakeFunction;
+
+void setWake(std::function<void()> wake) {
+  std::unique_lock<std::mutex> lock(mutex);
+  wakeFunction = std::move(wake);
+}
+
+void wake() {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (wakeFunction) wakeFunction();
+}
+
+} // namespace utils::main_loop
@@ -0,0 +1,41 @@
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utils/mapped_file.h"
+
+namespace utils {
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open file " + path.string());
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error("Could not stat file " + path.string());
+  }
+  mappedSize = size_t(info.st_size);
+  if (mappedSize == 0) {
+    close(fd);
+    return;
+  }
+  void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("Could not map file " + path.string());
+  }
+  madvise(address, mappedSize, MADV_SEQUENTIAL);
+  mapping = static_cast<const uint8_t*>(address);
+}
+
+MappedFile::~MappedFile() {
+  if (mapping != nullptr) {
+    munmap(const_cast<uint8_t*>(mapping), mappedSize);
+  }
+}
+
+} // namespace utils
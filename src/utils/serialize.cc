@@ -16,6 +16,13 @@ Eigen::Quaternionf toQuaternion(const nlohmann::json& json) {
   return Eigen::Quaternionf(json["w"].get<float>(), json["x"].get<float>(), json["y"].get<float>(), json["z"].get<float>());
 }
 
+AnnotationIds toAnnotationIds(const nlohmann::json& json) {
+  return {
+      .keypoints = json.value("keypoints", 1),
+      .boundingBoxes = json.value("bounding_boxes", 1),
+      .rectangles = json.value("rectangles", 1)};
+}
+
 nlohmann::json serialize(const Eigen::Vector3f& v) {
   auto out = nlohmann::json::array();
   out[0] = v[0];
@@ -33,6 +40,7 @@ nlohmann::json serialize(const Eigen::Vector2f& v) {
 
 nlohmann::json serialize(const Keypoint& keypoint) {
   auto out = nlohmann::json::object();
+  out["id"] = keypoint.id;
   out["class_id"] = keypoint.classId;
   out["position"] = serialize(keypoint.position);
   return out;
@@ -40,6 +48,7 @@ nlohmann::json serialize(const Keypoint& keypoint) {
 
 nlohmann::json serialize(const BBox& bbox) {
   auto obj = nlohmann::json::object();
+  obj["id"] = bbox.id;
   obj["position"] = serialize(bbox.position);
   obj["orientation"] = {
       {"w", bbox.orientation.w()},
@@ -53,6 +62,7 @@ nlohmann::json serialize(const BBox& bbox) {
 
 nlohmann::json serialize(const Rectangle& rectangle) {
   auto obj = nlohmann::json::object();
+  obj["id"] = rectangle.id;
   obj["center"] = serialize(rectangle.center);
   obj["orientation"] = {
       {"w", rectangle.orientation.w()},
@@ -64,4 +74,11 @@ nlohmann::json serialize(const Rectangle& rectangle) {
   return obj;
 }
 
+nlohmann::json serialize(const AnnotationIds& ids) {
+  return {
+      {"keypoints", ids.keypoints},
+      {"bounding_boxes", ids.boundingBoxes},
+      {"rectangles", ids.rectangles}};
+}
+
 } // namespace utils::serialize
@@ -113,16 +113,14 @@ bool AddBBoxView::leftButtonUp(const ViewContext3D& viewContext) {
       return true;
     }
   }
-  const Vector3f& rayDirection = viewContext.camera.computeRayWorld(viewContext.width, viewContext.height,
-                                                                    viewContext.mousePositionX, viewContext.mousePositionY);
-  Intersection intersection = sceneModel.traceRayIntersection(viewContext.camera.getPosition(), rayDirection);
-  if (intersection.hit) {
+  if (viewContext.pointingAt.has_value()) {
+    const Vector3f& normal = viewContext.pointingAtNormal;
     InstanceMetadata metadata = datasetMetadata.instanceMetadata[sceneModel.currentClassId];
-    Vector3f halfSizeNormal = intersection.normal * metadata.size[2] * 0.5;
+    Vector3f halfSizeNormal = normal * metadata.size[2] * 0.5;
     BBox bbox = {.id = -1,
                  .classId = sceneModel.currentClassId,
-                 .position = intersection.point - halfSizeNormal,
-                 .orientation = Quaternionf::FromTwoVectors(-Vector3f::UnitZ(), intersection.normal), // Z in the direction of the surface normal.
+                 .position = viewContext.pointingAt.value() - halfSizeNormal,
+                 .orientation = Quaternionf::FromTwoVectors(-Vector3f::UnitZ(), normal), // Z in the direction of the surface normal.
                  .dimensions = metadata.size};
     auto command = std::make_unique<commands::AddBBoxCommand>(bbox);
     timeline.pushCommand(std::move(command));
@@ -16,9 +16,7 @@ bool AddKeypointView::leftButtonUp(const ViewContext3D& viewContext) {
 }
 
 bool AddKeypointView::mouseMoved(const ViewContext3D& viewContext) {
-  const Vector3f& rayDirection = viewContext.camera.computeRayWorld(viewContext.width, viewContext.height,
-                                                                    viewContext.mousePositionX, viewContext.mousePositionY);
-  pointingAt = sceneModel.traceRay(viewContext.camera.getPosition(), rayDirection);
+  pointingAt = viewContext.pointingAt;
   return false;
 }
 } // namespace views
@@ -72,6 +72,7 @@ void AddRectangleView::computeVertices(const ViewContext3D& context) {
   vertices[1] = v2;
   vertices[2] = v4;
   vertices[3] = v3;
+  revision++;
 }
 
 void AddRectangleView::commit() {
@@ -88,8 +89,8 @@ bool AddRectangleView::hasRectangle() const {
 void AddRectangleView::render(const ViewContext3D& context) const {
   pointView.render(context);
   if (hasRectangle()) {
-    Rectangle rectangle(vertices);
-    rectangleView.render(context, rectangle);
+    const Rectangle rectangle(vertices);
+    rectangleView.render(context, std::span(&rectangle, 1), revision);
   }
 }
 } // namespace views
@@ -40,15 +40,13 @@ static const uint16_t cubeTriangleList[] = {
     7,
 };
 
-BBoxView::BBoxView(int id) : View3D(id) {
+BBoxView::BBoxView(int id) : View3D(id), instances(4) {
   layout.begin()
       .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
       .end();
 
   vertexBuffer = bgfx::createVertexBuffer(bgfx::makeRef(&cubeVertices[0], 8 * 3 * sizeof(float)), layout);
   indexBuffer = bgfx::createIndexBuffer(bgfx::makeRef(&cubeTriangleList[0], 24 * sizeof(uint16_t)));
-  u_scale = bgfx::createUniform("u_scale", bgfx::UniformType::Vec4);
-  u_color = bgfx::createUniform("u_color", bgfx::UniformType::Vec4);
   program = shader_utils::loadProgram("vs_bbox", "fs_bbox");
 }
 
@@ -56,21 +54,24 @@ BBoxView::~BBoxView() {
   bgfx::destroy(indexBuffer);
   bgfx::destroy(vertexBuffer);
   bgfx::destroy(program);
-  bgfx::destroy(u_scale);
-  bgfx::destroy(u_color);
 }
 
-void BBoxView::render(const BBox& bbox) const {
-  Matrix4f T = Matrix4f::Identity();
-  T.block<3, 3>(0, 0) = bbox.orientation.toRotationMatrix();
-  T.block<3, 1>(0, 3) = bbox.position;
-  bgfx::setTransform(T.data());
+void BBoxView::render(std::span<const BBox> bboxes, uint64_t revision) const {
+  instances.update(revision, bboxes.size(), [&](uint32_t i, float* data) {
+    const BBox& bbox = bboxes[i];
+    const Vector4f& color = colors::classColors[bbox.classId % 10];
+    // One vec4 per column.
+    Map<Matrix4f> instance(data);
+    instance.col(0) = bbox.orientation.coeffs();
+    instance.col(1) << bbox.position, 1.0f;
+    instance.col(2) << bbox.dimensions, 0.0f;
+    instance.col(3) = color;
+  });
+  if (instances.size() == 0) return;
+
   bgfx::setIndexBuffer(indexBuffer);
   bgfx::setVertexBuffer(0, vertexBuffer);
-  Vector4f scale(bbox.dimensions[0], bbox.dimensions[1], bbox.dimensions[2], 1.0);
-  bgfx::setUniform(u_scale, scale.data(), 1);
-  const Vector4f& color = colors::classColors[bbox.classId % 10];
-  bgfx::setUniform(u_color, color.data(), 1);
+  instances.setInstances();
   bgfx::setState(BGFX_STATE_DEFAULT |
                  BGFX_STATE_PT_LINES |
                  BGFX_STATE_WRITE_A |
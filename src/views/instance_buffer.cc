@@ -0,0 +1,38 @@
+#include <cassert>
+#include <algorithm>
+#include "views/instance_buffer.h"
+
+namespace views {
+
+static const bgfx::Attrib::Enum instanceAttributes[] = {
+    bgfx::Attrib::TexCoord7, bgfx::Attrib::TexCoord6, bgfx::Attrib::TexCoord5, bgfx::Attrib::TexCoord4};
+
+InstanceBuffer::InstanceBuffer(int vectorsPerInstance) {
+  assert(vectorsPerInstance > 0 && vectorsPerInstance <= 4 && "Instances are one to four vec4s.");
+  layout.begin();
+  for (int i = 0; i < vectorsPerInstance; i++) {
+    layout.add(instanceAttributes[i], 4, bgfx::AttribType::Float);
+  }
+  layout.end();
+}
+
+InstanceBuffer::~InstanceBuffer() {
+  if (bgfx::isValid(handle)) bgfx::destroy(handle);
+}
+
+const bgfx::Memory* InstanceBuffer::allocate(uint32_t instanceCount) {
+  if (instanceCount > capacity) {
+    // Grows geometrically so that adding annotations one by one does not
+    // recreate the buffer every time.
+    if (bgfx::isValid(handle)) bgfx::destroy(handle);
+    capacity = std::max(instanceCount, 2 * capacity);
+    handle = bgfx::createDynamicVertexBuffer(capacity, layout);
+  }
+  return bgfx::alloc(instanceCount * layout.getStride());
+}
+
+void InstanceBuffer::setInstances() const {
+  bgfx::setInstanceDataBuffer(handle, 0, count);
+}
+
+} // namespace views
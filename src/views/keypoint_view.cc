@@ -0,0 +1,84 @@
+#include "views/keypoint_view.h"
+#include "geometry/mesh.h"
+#include "shader_utils.h"
+#include "colors.h"
+
+namespace views {
+
+const float KeypointRadius = 0.01f;
+// Center and radius, followed by the color.
+const uint16_t InstanceStride = sizeof(float) * 8;
+
+KeypointView::KeypointView(int viewId) : views::View3D(viewId) {
+  layout.begin()
+      .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+      .add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float)
+      .end();
+
+  // A unit sphere, scaled to the keypoint radius in the vertex shader.
+  geometry::Sphere sphere(Matrix4f::Identity(), 1.0f);
+  const auto& V = sphere.vertices();
+  const auto& N = sphere.getVertexNormals();
+  const auto& F = sphere.faces();
+  std::vector<float> vertexData(V.rows() * 6);
+  for (int i = 0; i < V.rows(); i++) {
+    for (int j = 0; j < 3; j++) {
+      vertexData[i * 6 + j] = V(i, j);
+      vertexData[i * 6 + 3 + j] = N(i, j);
+    }
+  }
+  vertexBuffer = bgfx::createVertexBuffer(bgfx::copy(vertexData.data(), vertexData.size() * sizeof(float)), layout);
+  indexBuffer = bgfx::createIndexBuffer(bgfx::copy(F.data(), F.size() * sizeof(uint32_t)), BGFX_BUFFER_INDEX32);
+
+  u_lightDir = bgfx::createUniform("u_light_dir", bgfx::UniformType::Vec4);
+  program = shader_utils::loadProgram("vs_keypoints", "fs_keypoints");
+}
+
+KeypointView::~KeypointView() {
+  bgfx::destroy(vertexBuffer);
+  bgfx::destroy(indexBuffer);
+  bgfx::destroy(u_lightDir);
+  bgfx::destroy(program);
+}
+
+void KeypointView::render(const ViewContext3D& context, const std::vector<Keypoint>& keypoints) const {
+  lastDrawCalls = 0;
+  if (keypoints.empty()) return;
+  setCameraTransform(context);
+
+  // One draw call, unless there are more keypoints than fit in the transient
+  // instance buffer of a frame, in which case the rest is drawn in batches.
+  uint32_t drawn = 0;
+  while (drawn < keypoints.size()) {
+    uint32_t instanceCount = bgfx::getAvailInstanceDataBuffer(keypoints.size() - drawn, InstanceStride);
+    if (instanceCount == 0) break;
+
+    bgfx::InstanceDataBuffer buffer;
+    bgfx::allocInstanceDataBuffer(&buffer, instanceCount, InstanceStride);
+    float* instanceData = reinterpret_cast<float*>(buffer.data);
+    for (uint32_t i = 0; i < instanceCount; i++) {
+      const Keypoint& keypoint = keypoints[drawn + i];
+      const Vector4f& color = colors::classColors[keypoint.classId % 10];
+      float* instance = instanceData + i * 8;
+      instance[0] = keypoint.position[0];
+      instance[1] = keypoint.position[1];
+      instance[2] = keypoint.position[2];
+      instance[3] = KeypointRadius;
+      instance[4] = color[0];
+      instance[5] = color[1];
+      instance[6] = color[2];
+      instance[7] = color[3];
+    }
+
+    bgfx::setUniform(u_lightDir, lightDir.data(), 1);
+    bgfx::setVertexBuffer(0, vertexBuffer);
+    bgfx::setIndexBuffer(indexBuffer);
+    bgfx::setInstanceDataBuffer(&buffer);
+    bgfx::setState(BGFX_STATE_DEFAULT | BGFX_STATE_CULL_CW | BGFX_STATE_MSAA | BGFX_STATE_WRITE_A | BGFX_STATE_WRITE_RGB | BGFX_STATE_BLEND_ALPHA);
+    bgfx::submit(viewId, program);
+    drawn += instanceCount;
+    lastDrawCalls++;
+  }
+}
+
+} // namespace views
@@ -1,48 +1,148 @@
+#include <span>
 #include "views/point_cloud_view.h"
 #include "geometry/point_cloud.h"
 #include "shader_utils.h"
 
 namespace views {
+
+const size_t PointBudget = 3000000;
+// Points uploaded per frame, so that moving the camera never stalls on uploads.
+const size_t UploadBudget = 500000;
+// Points kept on the GPU, including nodes that went out of view.
+const size_t ResidentBudget = 2 * PointBudget;
+const float MaxScreenSpaceError = 1.5f;
+// Nodes smaller than this are packed on a single thread.
+const int64_t ParallelPackThreshold = 8192;
+
 PointCloudView::PointCloudView(SceneModel& model, int viewId) : views::View3D(viewId), scene(model) {
   layout.begin()
       .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
       .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Uint8, true)
       .end();
+  quantizedLayout.begin()
+      .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Int16, true)
+      .skip(2)
+      .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Uint8, true)
+      .end();
   u_activePoint = bgfx::createUniform("u_active_point", bgfx::UniformType::Vec4);
 };
 
 PointCloudView::~PointCloudView() {
-  bgfx::destroy(vertexBuffer);
-  bgfx::destroy(indexBuffer);
+  releaseNodes();
+  if (bgfx::isValid(program)) bgfx::destroy(program);
   bgfx::destroy(u_activePoint);
-  bgfx::destroy(program);
 }
 
-void PointCloudView::packVertexData() {
-  auto pointCloud = scene.getPointCloud();
-  auto& V = pointCloud->points;
-  auto& C = pointCloud->colors;
-  vertexData.resize(V.rows());
-  for (unsigned int i = 0; i < V.rows(); i++) {
-    vertexData[i].x = V(i, 0);
-    vertexData[i].y = V(i, 1);
-    vertexData[i].z = V(i, 2);
-    vertexData[i].rgba = (0xff << 24) + (C(i, 2) << 16) + (C(i, 1) << 8) + C(i, 0);
+static uint32_t packColor(const geometry::RowMatrixu8& C, uint32_t i) {
+  return (0xffu << 24) + (uint32_t(C(i, 2)) << 16) + (uint32_t(C(i, 1)) << 8) + uint32_t(C(i, 0));
+}
+
+template <typename Vertex, typename Pack>
+static const bgfx::Memory* packVertices(std::span<const uint32_t> points, Pack pack) {
+  // Written straight into memory owned by bgfx, which frees it after the upload.
+  const bgfx::Memory* memory = bgfx::alloc(uint32_t(points.size() * sizeof(Vertex)));
+  Vertex* vertices = reinterpret_cast<Vertex*>(memory->data);
+  const int64_t count = int64_t(points.size());
+#pragma omp parallel for if (count > ParallelPackThreshold)
+  for (int64_t i = 0; i < count; i++) {
+    vertices[i] = pack(points[i]);
+  }
+  return memory;
+}
+
+PointCloudView::NodeBuffer PointCloudView::uploadPoints(std::span<const uint32_t> points) const {
+  const auto& C = pointCloud->colors;
+  bgfx::VertexBufferHandle handle;
+  if (pointCloud->isQuantized()) {
+    // Positions go to the GPU as they are stored, normalized to [-1, 1].
+    const auto& Q = pointCloud->quantizedPoints;
+    handle = bgfx::createVertexBuffer(packVertices<QuantizedVertexData>(points, [&](uint32_t p) {
+      return QuantizedVertexData{Q(p, 0), Q(p, 1), Q(p, 2), 0, packColor(C, p)};
+    }), quantizedLayout);
+  } else {
+    const auto& V = pointCloud->points;
+    handle = bgfx::createVertexBuffer(packVertices<VertexData>(points, [&](uint32_t p) {
+      return VertexData{V(p, 0), V(p, 1), V(p, 2), packColor(C, p)};
+    }), layout);
+  }
+  return {handle, uint32_t(points.size()), frame};
+}
+
+PointCloudView::NodeBuffer& PointCloudView::uploadNode(uint32_t node) const {
+  std::span<const uint32_t> points = octree->nodePoints(node);
+  residentPoints += points.size();
+  return residentNodes[node] = uploadPoints(points);
+}
+
+void PointCloudView::selectFlat(std::vector<NodeBuffer*>& buffers) const {
+  // Every stride-th point, at most the point budget, split into buffers of the upload budget.
+  const size_t size = pointCloud->size();
+  const size_t stride = std::max<size_t>(1, (size + PointBudget - 1) / PointBudget);
+  const size_t count = (size + stride - 1) / stride;
+  const size_t bufferCount = (count + UploadBudget - 1) / UploadBudget;
+  // The buffers handed out below are pointed to, so they are never moved by adding more.
+  flatBuffers.reserve(bufferCount);
+  for (size_t i = 0; i < bufferCount; i++) {
+    if (i == flatBuffers.size()) {
+      if (lastFrame.uploadedPoints > 0) {
+        lastFrame.deferredNodes += bufferCount - i;
+        break;
+      }
+      std::vector<uint32_t> points;
+      for (size_t k = i * UploadBudget; k < std::min(count, (i + 1) * UploadBudget); k++) {
+        points.push_back(uint32_t(k * stride));
+      }
+      flatBuffers.push_back(uploadPoints(points));
+      lastFrame.uploadedPoints += points.size();
+    }
+    buffers.push_back(&flatBuffers[i]);
+  }
+}
+
+void PointCloudView::evictNodes() const {
+  if (residentPoints <= ResidentBudget) return;
+  // Least recently drawn first, never anything drawn this frame.
+  std::vector<std::pair<uint64_t, uint32_t>> candidates;
+  for (const auto& [node, buffer] : residentNodes) {
+    if (buffer.lastDrawn < frame) candidates.push_back({buffer.lastDrawn, node});
+  }
+  std::sort(candidates.begin(), candidates.end());
+  for (const auto& [lastDrawn, node] : candidates) {
+    if (residentPoints <= ResidentBudget) break;
+    NodeBuffer& buffer = residentNodes.at(node);
+    bgfx::destroy(buffer.handle);
+    residentPoints -= buffer.count;
+    residentNodes.erase(node);
   }
 }
 
+void PointCloudView::releaseNodes() {
+  for (auto& [node, buffer] : residentNodes) {
+    bgfx::destroy(buffer.handle);
+  }
+  residentNodes.clear();
+  residentPoints = 0;
+  for (NodeBuffer& buffer : flatBuffers) {
+    bgfx::destroy(buffer.handle);
+  }
+  flatBuffers.clear();
+}
+
 void PointCloudView::loadPointCloud() {
   if (initialized) return;
-  packVertexData();
-  vertexBuffer = bgfx::createVertexBuffer(bgfx::makeRef(vertexData.data(), vertexData.size() * sizeof(VertexData)), layout);
-  indices.resize(vertexData.size());
-  // Could not figure out a way to draw unindexed in bgfx.
-  for (uint32_t i = 0; i < vertexData.size(); i++) {
-    indices[i] = i;
+  pointCloud = scene.getPointCloud();
+  octree = scene.getPointCloudOctree();
+
+  modelTransform = Matrix4f::Identity();
+  if (pointCloud->isQuantized()) {
+    const geometry::PositionQuantization& quantization = pointCloud->quantization;
+    modelTransform.block<3, 3>(0, 0) = (quantization.scale * geometry::PositionQuantization::Range).asDiagonal();
+    modelTransform.block<3, 1>(0, 3) = quantization.center;
   }
-  indexBuffer = bgfx::createIndexBuffer(bgfx::makeRef(indices.data(), indices.size() * sizeof(uint32_t)), BGFX_BUFFER_INDEX32);
 
-  program = shader_utils::loadProgram("vs_point_cloud", "fs_point_cloud");
+  if (!bgfx::isValid(program)) {
+    program = shader_utils::loadProgram("vs_point_cloud", "fs_point_cloud");
+  }
   initialized = true;
 }
 
@@ -50,9 +150,38 @@ void PointCloudView::changeSize(float diff) {
   scene.pointCloudPointSize = std::clamp(scene.pointCloudPointSize + diff, 1.0f, 10.0f);
 }
 
-Vector4f noValue(0.0, 0.0, 0.0, -1.0);
 void PointCloudView::render(const ViewContext3D& context) const {
   if (!initialized) return;
+  frame++;
+  lastFrame = {};
+
+  geometry::LODQuery query;
+  query.viewProjection = getProjection(context) * context.camera.getViewMatrix().matrix();
+  query.eye = context.camera.getPosition();
+  query.pixelsPerUnit = float(context.height) / (2.0f * std::tan(context.camera.fov * 0.5f * M_PI / 180.0f));
+  query.pointBudget = PointBudget;
+  query.maxScreenSpaceError = MaxScreenSpaceError;
+  std::vector<NodeBuffer*> buffers;
+  if (octree == nullptr) {
+    selectFlat(buffers);
+  } else {
+    for (uint32_t node : octree->select(query)) {
+      auto resident = residentNodes.find(node);
+      NodeBuffer* buffer = resident == residentNodes.end() ? nullptr : &resident->second;
+      if (buffer == nullptr) {
+        // Always upload at least one node per frame, however large.
+        size_t count = octree->getNodes()[node].count;
+        if (lastFrame.uploadedPoints > 0 && lastFrame.uploadedPoints + count > UploadBudget) {
+          lastFrame.deferredNodes++;
+          continue;
+        }
+        buffer = &uploadNode(node);
+        lastFrame.uploadedPoints += count;
+      }
+      buffers.push_back(buffer);
+    }
+  }
+
   Vector4f activePoint(0.0, 0.0, 0.0, 0.0);
   if (context.pointingAt.has_value()) {
     activePoint.head<3>() = context.pointingAt.value();
@@ -60,19 +189,34 @@ void PointCloudView::render(const ViewContext3D& context) const {
   } else {
     activePoint[3] = -1.0;
   }
-  bgfx::setUniform(u_activePoint, activePoint.data());
   setCameraTransform(context);
   unsigned int size = std::round(scene.pointCloudPointSize);
-  bgfx::setState(BGFX_STATE_DEFAULT | BGFX_STATE_PT_POINTS | BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A | BGFX_STATE_BLEND_ALPHA | BGFX_STATE_POINT_SIZE(size));
-  bgfx::setVertexBuffer(0, vertexBuffer);
-  bgfx::setIndexBuffer(indexBuffer);
-  bgfx::submit(viewId, program);
+  const uint64_t state = BGFX_STATE_DEFAULT | BGFX_STATE_PT_POINTS | BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A | BGFX_STATE_BLEND_ALPHA | BGFX_STATE_POINT_SIZE(size);
+
+  for (NodeBuffer* buffer : buffers) {
+    buffer->lastDrawn = frame;
+    lastFrame.nodes++;
+    lastFrame.points += buffer->count;
+
+    bgfx::setUniform(u_activePoint, activePoint.data());
+    bgfx::setTransform(modelTransform.data());
+    bgfx::setState(state);
+    bgfx::setVertexBuffer(0, buffer->handle);
+    // No index buffer, every vertex in the buffer is drawn as a point.
+    bgfx::submit(viewId, program);
+  }
+  evictNodes();
 }
 
 void PointCloudView::reload() {
   initialized = false;
-  bgfx::destroy(vertexBuffer);
-  bgfx::destroy(indexBuffer);
+  releaseNodes();
   loadPointCloud();
 }
+
+void PointCloudView::updateOctree() {
+  if (!initialized || octree != nullptr || scene.getPointCloud() != pointCloud) return;
+  octree = scene.getPointCloudOctree();
+  if (octree != nullptr) releaseNodes();
+}
 } // namespace views
@@ -1,3 +1,4 @@
+#include <utility>
 #include "views/rectangle_affordances.h"
 
 namespace views {
@@ -26,14 +27,14 @@ Vector3f intersectionLocal(const ViewContext3D& viewContext, const Rectangle& re
 RectangleAffordances::RectangleAffordances(SceneModel& sceneModel, Timeline& tl) : scene(sceneModel), timeline(tl) {}
 
 bool RectangleAffordances::leftButtonDown(const ViewContext3D& viewContext) {
-  for (auto& rect : scene.getRectangles()) {
+  for (const auto& rect : std::as_const(scene).getRectangles()) {
     auto hitType = hitTest(viewContext, rect);
     if (hitType > None) {
       auto point_R = intersectionLocal(viewContext, rect);
 
       if (viewContext.modifiers == ModAlt) {
         Rectangle newRect(rect);
-        newRect.id = IdFactory::nextId();
+        newRect.id = scene.newRectangleId();
         auto command = std::make_unique<commands::AddRectangleCommand>(newRect);
         timeline.pushCommand(std::move(command));
 
@@ -80,14 +81,14 @@ bool RectangleAffordances::mouseMoved(const ViewContext3D& viewContext) {
     scene.updateRectangle(d.newRectangle);
     return true;
   } else {
-    for (auto& rect : scene.getRectangles()) {
-      auto hitType = hitTest(viewContext, rect);
-      if (hitType > None) {
-        rect.rotateControl = true;
-      } else {
-        rect.rotateControl = false;
+    int hovered = -1;
+    for (const auto& rect : std::as_const(scene).getRectangles()) {
+      if (hitTest(viewContext, rect) > None) {
+        hovered = rect.id;
+        break;
       }
     }
+    scene.setHoveredRectangle(hovered);
   }
   return false;
 }
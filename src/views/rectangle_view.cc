@@ -17,7 +17,7 @@ static const float vertexData[] = {
    1.0f,  1.0f, 0.0f,
 };
 
-RectangleView::RectangleView(int id) : views::View3D(id) {
+RectangleView::RectangleView(int id) : views::View3D(id), instances(3) {
   vertexLayout.begin()
     .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
     .end();
@@ -25,7 +25,6 @@ RectangleView::RectangleView(int id) : views::View3D(id) {
   vertexBuffer = bgfx::createVertexBuffer(bgfx::makeRef(&vertexData[0], 4 * 3 * sizeof(float)), vertexLayout);
   indexBuffer = bgfx::createIndexBuffer(bgfx::makeRef(indices, 4 * 3 * sizeof(uint16_t)));
 
-  u_scale = bgfx::createUniform("u_scale", bgfx::UniformType::Vec4);
   program = shader_utils::loadProgram("vs_rectangle", "fs_rectangle");
 }
 
@@ -33,29 +32,27 @@ RectangleView::~RectangleView() {
   bgfx::destroy(indexBuffer);
   bgfx::destroy(vertexBuffer);
   bgfx::destroy(program);
-  bgfx::destroy(u_scale);
 }
 
-void RectangleView::render(const ViewContext3D& context, const Rectangle& rectangle) const {
-  setCameraTransform(context);
-  auto center = rectangle.center;
-  Eigen::Matrix4f transform = Matrix4f::Identity();
-  Eigen::Matrix3f rotation(rectangle.orientation);
-  transform.block<3, 3>(0, 0) = rotation;
-  transform.block<3, 1>(0, 3) = center;
-
-  // Canonical rectangle vertices are actually 2m x 2m.
-  float ratioX = rectangle.width() * 0.5f;
-  float ratioY = rectangle.height() * 0.5f;
-  Vector4f scale(ratioX, ratioY, 0.0f, -1.0f);
-  if (rectangle.rotateControl) {
-    scale[3] = 1.0f;
-  }
-  bgfx::setUniform(u_scale, scale.data(), 1);
+void RectangleView::render(const ViewContext3D& context, std::span<const Rectangle> rectangles, uint64_t revision,
+                           int hovered) const {
+  instances.update(revision, rectangles.size(), [&](uint32_t i, float* data) {
+    const Rectangle& rectangle = rectangles[i];
+    // Canonical rectangle vertices are actually 2m x 2m.
+    float ratioX = rectangle.width() * 0.5f;
+    float ratioY = rectangle.height() * 0.5f;
+    // One vec4 per column.
+    Map<Matrix<float, 4, 3>> instance(data);
+    instance.col(0) = rectangle.orientation.coeffs();
+    instance.col(1) << rectangle.center, 1.0f;
+    instance.col(2) << ratioX, ratioY, 0.0f, rectangle.id == hovered ? 1.0f : -1.0f;
+  });
+  if (instances.size() == 0) return;
 
-  bgfx::setTransform(transform.data());
+  setCameraTransform(context);
   bgfx::setVertexBuffer(0, vertexBuffer);
   bgfx::setIndexBuffer(indexBuffer);
+  instances.setInstances();
   bgfx::setState(BGFX_STATE_DEFAULT
       | BGFX_STATE_WRITE_RGB
       | BGFX_STATE_WRITE_A
@@ -9,10 +9,15 @@ bool View::hit(const ViewContext3D& ctx) const {
 }
 
 void View3D::setCameraTransform(const ViewContext3D& context) const {
-  const auto camera = context.camera;
-  float proj[16];
-  bx::mtxProj(proj, camera.fov, float(context.width) / float(context.height), 0.1f, 1000.0f, bgfx::getCaps()->homogeneousDepth, bx::Handness::Right);
-  bgfx::setViewTransform(viewId, camera.getViewMatrix().data(), proj);
+  Matrix4f proj = getProjection(context);
+  bgfx::setViewTransform(viewId, context.camera.getViewMatrix().data(), proj.data());
+}
+
+Matrix4f View3D::getProjection(const ViewContext3D& context) const {
+  // bx matrices are row major with row vectors, which is the same memory layout as column major with column vectors.
+  Matrix4f proj;
+  bx::mtxProj(proj.data(), context.camera.fov, float(context.width) / float(context.height), 0.1f, 1000.0f, bgfx::getCaps()->homogeneousDepth, bx::Handness::Right);
+  return proj;
 }
 
 } // namespace views
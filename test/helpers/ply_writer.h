@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <eigen3/Eigen/Dense>
+
+namespace test_helpers {
+
+struct PlyLayout {
+  size_t vertices = 0;
+  size_t faces = 0;
+  bool normals = false;
+  bool colors = false;
+  bool ascii = false;
+};
+
+class PlyWriter {
+  /*
+   * Writes .ply files for tests and benchmarks, binary little endian unless
+   * asked for ascii. Vertices have x, y and z, then nx, ny and nz, then red,
+   * green and blue, as set by the layout. Faces are triangles. Vertices and
+   * faces have to be added in that order, as many as the layout says. The
+   * file is complete once the writer is destroyed.
+   */
+private:
+  std::ofstream out;
+  PlyLayout layout;
+
+  template <typename T>
+  void write(const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+public:
+  PlyWriter(const std::filesystem::path& path, PlyLayout layout)
+      : out(path, layout.ascii ? std::ios::out : std::ios::binary), layout(layout) {
+    out << "ply\n"
+        << "format " << (layout.ascii ? "ascii" : "binary_little_endian") << " 1.0\n"
+        << "element vertex " << layout.vertices << "\n"
+        << "property float x\nproperty float y\nproperty float z\n";
+    if (layout.normals) out << "property float nx\nproperty float ny\nproperty float nz\n";
+    if (layout.colors) out << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    if (layout.faces > 0) {
+      out << "element face " << layout.faces << "\n"
+          << "property list uchar int vertex_indices\n";
+    }
+    out << "end_header\n";
+  }
+
+  // Colors are in [0, 1], anything outside is clamped.
+  void vertex(const Eigen::Vector3f& point, const Eigen::Vector3f& color = Eigen::Vector3f::Ones(),
+              const Eigen::Vector3f& normal = Eigen::Vector3f::UnitZ()) {
+    std::array<uint8_t, 3> rgb;
+    for (int i = 0; i < 3; i++) rgb[i] = uint8_t(std::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    if (layout.ascii) {
+      out << point[0] << " " << point[1] << " " << point[2];
+      if (layout.normals) out << " " << normal[0] << " " << normal[1] << " " << normal[2];
+      if (layout.colors) out << " " << int(rgb[0]) << " " << int(rgb[1]) << " " << int(rgb[2]);
+      out << "\n";
+      return;
+    }
+    for (int i = 0; i < 3; i++) write(point[i]);
+    if (layout.normals) {
+      for (int i = 0; i < 3; i++) write(normal[i]);
+    }
+    if (layout.colors) write(rgb);
+  }
+
+  void face(uint32_t a, uint32_t b, uint32_t c) {
+    if (layout.ascii) {
+      out << "3 " << a << " " << b << " " << c << "\n";
+      return;
+    }
+    write(uint8_t(3));
+    write(std::array<uint32_t, 3>{a, b, c});
+  }
+};
+
+// A point cloud of the points, with positions only.
+inline std::filesystem::path writePointCloud(const std::filesystem::path& path,
+                                             const std::vector<Eigen::Vector3f>& points) {
+  PlyWriter writer(path, {.vertices = points.size()});
+  for (const Eigen::Vector3f& point : points) writer.vertex(point);
+  return path;
+}
+
+} // namespace test_helpers
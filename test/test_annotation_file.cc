@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include "3rdparty/json.hpp"
+#include "utils/annotation_file.h"
+#include "utils/serialize.h"
+
+namespace fs = std::filesystem;
+namespace annotation_file = utils::annotation_file;
+
+struct Scene {
+  std::vector<Keypoint> keypoints;
+  std::vector<BBox> boundingBoxes;
+  std::vector<Rectangle> rectangles;
+  AnnotationIds nextIds;
+};
+
+Scene randomScene(int count) {
+  Scene scene;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+  auto vector = [&]() { return Vector3f(coordinate(rng), coordinate(rng), coordinate(rng)); };
+  for (int i = 0; i < count; i++) {
+    scene.keypoints.emplace_back(i + 1, i % 10, vector());
+    scene.boundingBoxes.push_back({.id = i + 1, .classId = i % 3, .position = vector(),
+                                   .orientation = Quaternionf::UnitRandom(), .dimensions = vector().cwiseAbs()});
+    scene.rectangles.emplace_back(i + 1, i % 5, vector(), Quaternionf::UnitRandom(), Vector2f(1.0f, 0.25f));
+  }
+  // Numbers that are formatted in special ways.
+  scene.keypoints.emplace_back(count + 1, 0, Vector3f(0.0f, -0.0f, 1.0f));
+  scene.keypoints.emplace_back(count + 2, 0, Vector3f(1e-7f, 3e20f, -123456789.0f));
+  scene.nextIds = {count + 3, count + 1, count + 7};
+  return scene;
+}
+
+std::string dumpDocument(const Scene& scene) {
+  // How annotations used to be saved.
+  nlohmann::json json = nlohmann::json::object();
+  if (!scene.keypoints.empty()) {
+    json["keypoints"] = nlohmann::json::array();
+    for (size_t i = 0; i < scene.keypoints.size(); i++) json["keypoints"][i] = utils::serialize::serialize(scene.keypoints[i]);
+  }
+  if (!scene.boundingBoxes.empty()) {
+    json["bounding_boxes"] = nlohmann::json::array();
+    for (size_t i = 0; i < scene.boundingBoxes.size(); i++) json["bounding_boxes"][i] = utils::serialize::serialize(scene.boundingBoxes[i]);
+  }
+  if (!scene.rectangles.empty()) {
+    json["rectangles"] = nlohmann::json::array();
+    for (size_t i = 0; i < scene.rectangles.size(); i++) json["rectangles"][i] = utils::serialize::serialize(scene.rectangles[i]);
+  }
+  json["next_ids"] = utils::serialize::serialize(scene.nextIds);
+  return json.dump(4);
+}
+
+std::string writeFile(const Scene& scene) {
+  fs::path path = fs::temp_directory_path() / "test_annotation_file.json";
+  annotation_file::write(path, scene.keypoints, scene.boundingBoxes, scene.rectangles, scene.nextIds);
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+TEST(TestAnnotationFile, SameAsDocument) {
+  Scene scene = randomScene(1000);
+  ASSERT_EQ(writeFile(scene), dumpDocument(scene));
+
+  Scene keypointsOnly;
+  keypointsOnly.keypoints.emplace_back(1, 2, Vector3f(0.5f, 0.25f, 2.0f));
+  ASSERT_EQ(writeFile(keypointsOnly), dumpDocument(keypointsOnly));
+  ASSERT_EQ(writeFile(Scene()), dumpDocument(Scene()));
+}
+
+TEST(TestAnnotationFile, RoundTrip) {
+  Scene scene = randomScene(100);
+  fs::path path = fs::temp_directory_path() / "test_annotation_file_round_trip.json";
+  annotation_file::write(path, scene.keypoints, scene.boundingBoxes, scene.rectangles, scene.nextIds);
+  annotation_file::Annotations read;
+  ASSERT_TRUE(annotation_file::read(path, read));
+  ASSERT_EQ(read.keypoints.size(), scene.keypoints.size());
+  ASSERT_EQ(read.boundingBoxes.size(), scene.boundingBoxes.size());
+  ASSERT_EQ(read.rectangles.size(), scene.rectangles.size());
+  for (size_t i = 0; i < scene.keypoints.size(); i++) {
+    ASSERT_EQ(read.keypoints[i].id, scene.keypoints[i].id);
+    ASSERT_EQ(read.keypoints[i].classId, scene.keypoints[i].classId);
+    ASSERT_EQ(read.keypoints[i].position, scene.keypoints[i].position);
+  }
+  for (size_t i = 0; i < scene.boundingBoxes.size(); i++) {
+    const BBox& bbox = read.boundingBoxes[i];
+    ASSERT_EQ(bbox.id, scene.boundingBoxes[i].id);
+    ASSERT_EQ(bbox.classId, scene.boundingBoxes[i].classId);
+    ASSERT_EQ(bbox.position, scene.boundingBoxes[i].position);
+    ASSERT_EQ(bbox.dimensions, scene.boundingBoxes[i].dimensions);
+    ASSERT_EQ(bbox.orientation.coeffs(), scene.boundingBoxes[i].orientation.coeffs());
+  }
+  for (size_t i = 0; i < scene.rectangles.size(); i++) {
+    const Rectangle& rectangle = read.rectangles[i];
+    ASSERT_EQ(rectangle.id, scene.rectangles[i].id);
+    ASSERT_EQ(rectangle.classId, scene.rectangles[i].classId);
+    ASSERT_EQ(rectangle.center, scene.rectangles[i].center);
+    ASSERT_EQ(rectangle.size, scene.rectangles[i].size);
+    ASSERT_EQ(rectangle.orientation.coeffs(), scene.rectangles[i].orientation.coeffs());
+  }
+  ASSERT_TRUE(read.nextIds.has_value());
+  ASSERT_EQ(read.nextIds->keypoints, scene.nextIds.keypoints);
+  ASSERT_EQ(read.nextIds->boundingBoxes, scene.nextIds.boundingBoxes);
+  ASSERT_EQ(read.nextIds->rectangles, scene.nextIds.rectangles);
+}
+
+TEST(TestAnnotationFile, Invalid) {
+  fs::path path = fs::temp_directory_path() / "test_annotation_file_invalid.json";
+  std::ofstream(path) << R"({"keypoints": [{"class_id": 1, "position": [1.0, 2.0)";
+  annotation_file::Annotations read;
+  ASSERT_FALSE(annotation_file::read(path, read));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <utility>
+#include "model/annotation_store.h"
+
+struct Annotation {
+  int id;
+  int value;
+};
+
+TEST(TestAnnotationStore, AddFindUpdate) {
+  model::AnnotationStore<Annotation> store;
+  for (int i = 0; i < 10; i++) {
+    store.add({store.nextId(), i});
+  }
+  ASSERT_EQ(store.size(), 10);
+  ASSERT_EQ(store.find(1)->value, 0);
+  ASSERT_EQ(store.find(10)->value, 9);
+  ASSERT_EQ(store.find(11), nullptr);
+
+  ASSERT_TRUE(store.update({5, 100}));
+  ASSERT_EQ(store.find(5)->value, 100);
+  ASSERT_FALSE(store.update({42, 0}));
+  ASSERT_FALSE(store.contains(42));
+}
+
+TEST(TestAnnotationStore, Remove) {
+  model::AnnotationStore<Annotation> store;
+  for (int i = 0; i < 5; i++) {
+    store.add({store.nextId(), i});
+  }
+  ASSERT_TRUE(store.remove(2));
+  ASSERT_FALSE(store.remove(2));
+  ASSERT_EQ(store.size(), 4);
+  ASSERT_FALSE(store.contains(2));
+  // Everything else can still be found by id.
+  for (int id : {1, 3, 4, 5}) {
+    ASSERT_EQ(store.find(id)->id, id);
+    ASSERT_EQ(store.find(id)->value, id - 1);
+  }
+  // Removing the last one as well as the only one.
+  ASSERT_TRUE(store.remove(store.all().back().id));
+  ASSERT_EQ(store.size(), 3);
+  while (!store.empty()) {
+    ASSERT_TRUE(store.remove(store[0].id));
+  }
+  ASSERT_EQ(store.find(1), nullptr);
+}
+
+TEST(TestAnnotationStore, Ids) {
+  model::AnnotationStore<Annotation> store;
+  int first = store.nextId();
+  store.add({first, 0});
+  store.remove(first);
+  ASSERT_NE(store.nextId(), first);
+
+  // Ids added from elsewhere are never handed out.
+  store.add({50, 0});
+  ASSERT_GT(store.nextId(), 50);
+
+  store.clear();
+  ASSERT_TRUE(store.empty());
+  ASSERT_EQ(store.nextId(), 1);
+}
+
+TEST(TestAnnotationStore, Snapshot) {
+  model::AnnotationStore<Annotation> store;
+  store.add({store.nextId(), 0});
+  store.add({store.nextId(), 1});
+  auto snapshot = store.snapshot();
+  // Shared until the store changes.
+  ASSERT_EQ(snapshot.get(), &std::as_const(store).all());
+
+  store.update({1, 10});
+  store.remove(2);
+  store.add({store.nextId(), 3});
+  ASSERT_EQ(snapshot->size(), 2);
+  ASSERT_EQ((*snapshot)[0].value, 0);
+  ASSERT_EQ((*snapshot)[1].value, 1);
+  ASSERT_EQ(store.find(1)->value, 10);
+  ASSERT_EQ(store.size(), 2);
+
+  // Without snapshots around, nothing is copied.
+  snapshot.reset();
+  const Annotation* first = &store.all()[0];
+  store.update({1, 11});
+  ASSERT_EQ(&store.all()[0], first);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include "scene_model.h"
+#include "timeline.h"
+#include "utils/autosave.h"
+#include "utils/annotation_file.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+fs::path annotationPath(const std::string& name) {
+  fs::path path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  return path;
+}
+
+// Moved on by the tests, the worker only sees the delays pass when told to.
+struct ManualClock {
+  std::atomic<utils::Autosave::Clock::time_point> time = utils::Autosave::Clock::time_point();
+  utils::AutosaveOptions options(std::chrono::milliseconds delay, std::chrono::milliseconds maxDelay) {
+    return {.delay = delay, .maxDelay = maxDelay, .now = [this]() { return time.load(); }};
+  }
+  void advance(utils::Autosave& autosave, std::chrono::milliseconds duration) {
+    time = time.load() + duration;
+    autosave.clockChanged();
+  }
+};
+
+size_t savedKeypoints(const fs::path& path) {
+  utils::annotation_file::Annotations annotations;
+  if (!fs::exists(path) || !utils::annotation_file::read(path, annotations)) return 0;
+  return annotations.keypoints.size();
+}
+
+TEST(TestAutosave, Debounce) {
+  fs::path path = annotationPath("test_autosave_debounce.json");
+  SceneModel scene;
+  ManualClock clock;
+  utils::Autosave autosave(clock.options(100ms, 10s));
+  autosave.markSaved(scene);
+  autosave.update(scene, path);
+  clock.advance(autosave, 150ms);
+  // Nothing changed, nothing to save.
+  ASSERT_EQ(autosave.saveCount(), 0);
+
+  // A burst of edits is saved once, after it is over.
+  for (int i = 0; i < 10; i++) {
+    scene.addKeypoint(Vector3f::Ones());
+    autosave.update(scene, path);
+    clock.advance(autosave, 50ms);
+  }
+  ASSERT_EQ(autosave.saveCount(), 0);
+  clock.advance(autosave, 50ms);
+  ASSERT_EQ(autosave.saveCount(), 1);
+  ASSERT_EQ(savedKeypoints(path), 10);
+  ASSERT_FALSE(fs::exists(fs::path(path.string() + ".tmp")));
+}
+
+TEST(TestAutosave, MaxDelay) {
+  fs::path path = annotationPath("test_autosave_max_delay.json");
+  SceneModel scene;
+  ManualClock clock;
+  utils::Autosave autosave(clock.options(100ms, 200ms));
+  autosave.markSaved(scene);
+  // Edits that keep coming are still saved, every 200 ms.
+  for (int i = 0; i < 40; i++) {
+    scene.addKeypoint(Vector3f::Ones());
+    autosave.update(scene, path);
+    clock.advance(autosave, 20ms);
+  }
+  ASSERT_EQ(autosave.saveCount(), 4);
+}
+
+TEST(TestAutosave, Flush) {
+  fs::path path = annotationPath("test_autosave_flush.json");
+  SceneModel scene;
+  utils::Autosave autosave({.delay = 10s, .maxDelay = 10s});
+  autosave.markSaved(scene);
+  auto keypoint = scene.addKeypoint(Vector3f::Ones());
+  autosave.update(scene, path);
+  // Later changes are not part of the snapshot.
+  scene.removeKeypoint(keypoint);
+  autosave.flush();
+  ASSERT_EQ(autosave.saveCount(), 1);
+  ASSERT_EQ(savedKeypoints(path), 1);
+
+  // Loaded annotations are not saved again.
+  scene.addKeypoint(Vector3f::Zero());
+  autosave.markSaved(scene);
+  autosave.update(scene, path);
+  autosave.flush();
+  ASSERT_EQ(autosave.saveCount(), 1);
+}
+
+TEST(TestAutosave, SaveOnExit) {
+  fs::path path = annotationPath("test_autosave_exit.json");
+  SceneModel scene;
+  {
+    utils::Autosave autosave({.delay = 10s, .maxDelay = 10s});
+    autosave.markSaved(scene);
+    scene.addKeypoint(Vector3f::Ones());
+    scene.addKeypoint(Vector3f::Zero());
+    autosave.update(scene, path);
+  }
+  ASSERT_EQ(savedKeypoints(path), 2);
+}
+
+TEST(TestAutosave, Save) {
+  fs::path path = annotationPath("test_autosave_save.json");
+  SceneModel scene;
+  ManualClock clock;
+  utils::Autosave autosave(clock.options(10ms, 10ms));
+  scene.addKeypoint(Vector3f::Ones());
+  autosave.update(scene, path);
+  scene.addKeypoint(Vector3f::Ones());
+  ASSERT_TRUE(autosave.save(scene, path));
+  clock.advance(autosave, 50ms);
+  // The older autosave never replaces what was saved by hand.
+  ASSERT_EQ(savedKeypoints(path), 2);
+}
+
+TEST(TestAutosave, UnreadableFile) {
+  fs::path path = annotationPath("test_autosave_unreadable.json");
+  {
+    std::ofstream file(path);
+    file << "{\"keypoints\": [";
+  }
+  // Not loaded, the scene is empty and must not replace the file.
+  SceneModel scene;
+  utils::Autosave autosave({.delay = 10s, .maxDelay = 10s});
+  Timeline timeline(scene);
+  bool loaded = timeline.load(path);
+  ASSERT_FALSE(loaded);
+  ASSERT_EQ(autosave.restore(scene, path, loaded), 0);
+  scene.addKeypoint(Vector3f::Ones());
+  autosave.update(scene, path);
+  autosave.flush();
+  ASSERT_FALSE(autosave.save(scene, path));
+  ASSERT_EQ(autosave.saveCount(), 0);
+  ASSERT_EQ(fs::file_size(path), 15);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include "model/dataset_index.h"
+#include "utils/dataset.h"
+
+namespace fs = std::filesystem;
+
+std::string datasetPath;
+
+// The fixture dataset with an image for each of the first frames, written out of order.
+fs::path makeDataset(int images) {
+  fs::path path = fs::temp_directory_path() / "test_dataset_index";
+  fs::remove_all(path);
+  fs::create_directories(path / "color");
+  fs::create_directories(path / "scene");
+  fs::copy_file(fs::path(datasetPath) / "camera_intrinsics.json", path / "camera_intrinsics.json");
+  fs::copy_file(fs::path(datasetPath) / "scene" / "trajectory.log", path / "scene" / "trajectory.log");
+  for (int i = images - 1; i >= 0; i--) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06d.jpg", i);
+    std::ofstream(path / "color" / name);
+  }
+  std::ofstream(path / "color" / ".DS_Store");
+  return path;
+}
+
+TEST(TestDatasetIndex, Frames) {
+  fs::path path = makeDataset(20);
+  model::DatasetIndex index(path);
+  ASSERT_EQ(index.size(), 20);
+  ASSERT_EQ(index.getCamera().imageWidth, 256);
+  ASSERT_EQ(index.imagePath(0).filename(), "000000.jpg");
+  ASSERT_EQ(index.imagePath(19).filename(), "000019.jpg");
+
+  // Parsed again, not read from the sidecar the index wrote.
+  auto poses = utils::dataset::getDatasetCameraTrajectory(path / "scene" / "trajectory.log", false);
+  for (size_t i = 0; i < index.size(); i++) {
+    ASSERT_TRUE(index.cameraPose(i).isApprox(poses[i]));
+  }
+
+  ASSERT_EQ(index.frameAt(0.0f), 0);
+  ASSERT_EQ(index.frameAt(0.5f), 10);
+  ASSERT_EQ(index.frameAt(1.0f), 19);
+  ASSERT_EQ(index.frameAt(2.0f), 19);
+}
+
+TEST(TestDatasetIndex, NoImages) {
+  fs::path path = makeDataset(0);
+  fs::remove_all(path / "color");
+  model::DatasetIndex index(path);
+  ASSERT_TRUE(index.empty());
+  ASSERT_EQ(index.frameAt(0.5f), 0);
+}
+
+TEST(TestDatasetIndex, TrajectoryCache) {
+  fs::path path = makeDataset(0) / "scene" / "trajectory.log";
+  fs::path cachePath = path.parent_path() / ".trajectory.log.bin";
+  auto parsed = utils::dataset::getDatasetCameraTrajectory(path, false);
+  ASSERT_EQ(parsed.size(), 474);
+  ASSERT_FALSE(fs::exists(cachePath));
+
+  auto written = utils::dataset::getDatasetCameraTrajectory(path);
+  ASSERT_TRUE(fs::exists(cachePath));
+  auto cached = utils::dataset::getDatasetCameraTrajectory(path);
+  ASSERT_EQ(written, parsed);
+  ASSERT_EQ(cached, parsed);
+
+  // Not used once the trajectory changes.
+  std::ofstream(path, std::ios::app) << "474 474 475\n1 0 0 1\n0 1 0 2\n0 0 1 3\n0 0 0 1\n";
+  auto extended = utils::dataset::getDatasetCameraTrajectory(path);
+  ASSERT_EQ(extended.size(), 475);
+  ASSERT_EQ(extended[474](2, 3), 3.0f);
+
+  ASSERT_TRUE(utils::dataset::getDatasetCameraTrajectory(path.parent_path() / "missing.log").empty());
+}
+
+TEST(TestDatasetIndex, ParseTrajectory) {
+  // Windows line endings, no newline at the end and a transform cut short.
+  std::string log = "0 0 1\r\n1 0 0 0.5\r\n0 1 0 -2e-3\r\n0 0 1 7\r\n0 0 0 1\r\n1 1 2\r\n1 0 0 0";
+  auto poses = utils::dataset::parseCameraTrajectory(log.data(), log.size());
+  ASSERT_EQ(poses.size(), 1);
+  ASSERT_EQ(poses[0](0, 3), 0.5f);
+  ASSERT_EQ(poses[0](1, 3), -2e-3f);
+  ASSERT_EQ(poses[0](2, 3), 7.0f);
+  ASSERT_EQ(poses[0](3, 3), 1.0f);
+
+  // Blank lines in between and at the end, as left by editors and scripts.
+  std::string blankLines = "0 0 1\n1 0 0 0.5\n0 1 0 0\n0 0 1 0\n0 0 0 1\n\n1 1 2\r\n1 0 0 0\r\n"
+                           "0 1 0 0.25\r\n \r\n0 0 1 0\r\n0 0 0 1\r\n\r\n\n";
+  poses = utils::dataset::parseCameraTrajectory(blankLines.data(), blankLines.size());
+  ASSERT_EQ(poses.size(), 2);
+  ASSERT_EQ(poses[0](0, 3), 0.5f);
+  ASSERT_EQ(poses[1](1, 3), 0.25f);
+  ASSERT_EQ(poses[1](3, 3), 1.0f);
+
+  // Long enough to be parsed in many chunks.
+  std::string longLog;
+  for (int i = 0; i < 20000; i++) {
+    longLog += std::to_string(i) + " " + std::to_string(i) + " " + std::to_string(i + 1) + "\n";
+    for (int row = 0; row < 4; row++) {
+      for (int column = 0; column < 4; column++) {
+        longLog += std::to_string(i * 16 + row * 4 + column) + (column < 3 ? " " : "\n");
+      }
+    }
+  }
+  poses = utils::dataset::parseCameraTrajectory(longLog.data(), longLog.size());
+  ASSERT_EQ(poses.size(), 20000);
+  for (int i = 0; i < 20000; i++) {
+    for (int row = 0; row < 4; row++) {
+      for (int column = 0; column < 4; column++) {
+        ASSERT_EQ(poses[i](row, column), float(i * 16 + row * 4 + column));
+      }
+    }
+  }
+  ASSERT_TRUE(utils::dataset::parseCameraTrajectory(nullptr, 0).empty());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  datasetPath = argv[1];
+  return RUN_ALL_TESTS();
+}
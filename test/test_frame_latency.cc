@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include "utils/frame_latency.h"
+
+using namespace std::chrono_literals;
+using Clock = utils::FrameLatency::Clock;
+
+TEST(TestFrameLatency, Latency) {
+  utils::FrameLatency latency;
+  Clock::time_point start = Clock::now();
+  // A frame without input, e.g. the first one.
+  latency.frameRendered(start);
+  ASSERT_EQ(latency.frameCount(), 1);
+  ASSERT_EQ(latency.meanLatency(), 0.0);
+
+  // The second event is shown by the same frame as the first.
+  latency.eventReceived(start + 10ms);
+  latency.eventReceived(start + 15ms);
+  latency.frameRendered(start + 30ms);
+  ASSERT_NEAR(latency.meanLatency(), 20.0, 1e-6);
+
+  latency.eventReceived(start + 40ms);
+  latency.frameRendered(start + 80ms);
+  ASSERT_EQ(latency.frameCount(), 3);
+  ASSERT_NEAR(latency.meanLatency(), 30.0, 1e-6);
+  ASSERT_NEAR(latency.maxLatency(), 40.0, 1e-6);
+}
+
+TEST(TestFrameLatency, IdleWaits) {
+  utils::FrameLatency latency;
+  latency.idleWait();
+  latency.idleWait();
+  ASSERT_EQ(latency.idleWaitCount(), 2);
+  ASSERT_EQ(latency.frameCount(), 0);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <bimg/bimg.h>
+#include "model/frame_prefetcher.h"
+
+namespace fs = std::filesystem;
+
+std::string datasetPath;
+
+// An uncompressed 24 bit TGA image of a single color.
+void writeImage(const fs::path& path, int width, int height, uint8_t value) {
+  uint8_t header[18] = {0, 0, 2};
+  header[12] = width & 0xff;
+  header[13] = width >> 8;
+  header[14] = height & 0xff;
+  header[15] = height >> 8;
+  header[16] = 24;
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  std::vector<char> pixels(width * height * 3, char(value));
+  file.write(pixels.data(), pixels.size());
+}
+
+// The fixture dataset with an image for each of its first frames.
+std::shared_ptr<const model::DatasetIndex> makeDataset(int images) {
+  fs::path path = fs::temp_directory_path() / "test_frame_prefetcher";
+  fs::remove_all(path);
+  fs::create_directories(path / "color");
+  fs::create_directories(path / "scene");
+  fs::copy_file(fs::path(datasetPath) / "camera_intrinsics.json", path / "camera_intrinsics.json");
+  fs::copy_file(fs::path(datasetPath) / "scene" / "trajectory.log", path / "scene" / "trajectory.log");
+  for (int i = 0; i < images; i++) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06d.tga", i);
+    writeImage(path / "color" / name, 32, 24, uint8_t(i));
+  }
+  return std::make_shared<model::DatasetIndex>(path);
+}
+
+TEST(TestFramePrefetcher, DecodesAhead) {
+  auto dataset = makeDataset(20);
+  model::FramePrefetcher frames(dataset, {.lookAhead = 4, .workers = 2});
+  texture_utils::ImagePtr image = frames.seek(0).get();
+  ASSERT_NE(image, nullptr);
+  ASSERT_EQ(image->container->m_width, 32);
+  ASSERT_EQ(image->container->m_height, 24);
+
+  // The current frame and the ones after it, nothing more.
+  ASSERT_EQ(frames.size(), 5);
+  frames.seek(4).get();
+  for (int i = 0; i < 1000 && !frames.isReady(8); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(frames.isReady(8));
+  ASSERT_FALSE(frames.isReady(0));
+  ASSERT_EQ(frames.size(), 5);
+
+  // The window ends with the dataset.
+  ASSERT_NE(frames.seek(19).get(), nullptr);
+  ASSERT_EQ(frames.size(), 1);
+  ASSERT_NE(frames.seek(100).get(), nullptr);
+}
+
+TEST(TestFramePrefetcher, MissingImage) {
+  auto dataset = makeDataset(3);
+  fs::remove(dataset->imagePath(1));
+  model::FramePrefetcher frames(dataset);
+  ASSERT_NE(frames.seek(0).get(), nullptr);
+  ASSERT_EQ(frames.seek(1).get(), nullptr);
+  ASSERT_NE(frames.seek(2).get(), nullptr);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  datasetPath = argv[1];
+  return RUN_ALL_TESTS();
+}
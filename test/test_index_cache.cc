@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include "geometry/index_cache.h"
+#include "geometry/ray_trace_cloud.h"
+#include "geometry/ray_trace_mesh.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+fs::path writeCloud(const std::string& name, float offset) {
+  std::vector<Eigen::Vector3f> points;
+  for (int i = 0; i < 100; i++) {
+    points.emplace_back(float(i % 10) * 0.1f + offset, float(i / 10) * 0.1f, 0.0f);
+  }
+  return test_helpers::writePointCloud(fs::temp_directory_path() / name, points);
+}
+
+TEST(TestIndexCache, RoundTrip) {
+  fs::path source = writeCloud("test_index_cache.ply", 0.0f);
+  geometry::IndexCache cache(source, geometry::IndexKind::PointCloud);
+  fs::remove(cache.path());
+  ASSERT_EQ(cache.path(), fs::temp_directory_path() / ".test_index_cache.ply.bvh");
+  ASSERT_FALSE(cache.load());
+
+  std::vector<uint32_t> values = {1, 2, 3, 4, 5};
+  std::string bytes = "kd-tree";
+  cache.setArray(geometry::IndexSection::BVHIndices, values);
+  cache.setSection(geometry::IndexSection::PointNormals, bytes.data(), bytes.size());
+  ASSERT_TRUE(cache.save());
+
+  geometry::IndexCache loaded(source, geometry::IndexKind::PointCloud);
+  ASSERT_TRUE(loaded.load());
+  auto loadedValues = loaded.getArray<uint32_t>(geometry::IndexSection::BVHIndices);
+  ASSERT_EQ(std::vector<uint32_t>(loadedValues.begin(), loadedValues.end()), values);
+  auto loadedBytes = loaded.getSection(geometry::IndexSection::PointNormals);
+  ASSERT_EQ(std::string(loadedBytes.begin(), loadedBytes.end()), bytes);
+  ASSERT_TRUE(loaded.getSection(geometry::IndexSection::BVHNodes).empty());
+
+  // A cache for another kind of geometry is not used.
+  geometry::IndexCache mesh(source, geometry::IndexKind::TriangleMesh);
+  ASSERT_FALSE(mesh.load());
+}
+
+TEST(TestIndexCache, Stale) {
+  fs::path source = writeCloud("test_index_cache_stale.ply", 0.0f);
+  geometry::IndexCache cache(source, geometry::IndexKind::PointCloud);
+  std::vector<uint32_t> values = {1, 2, 3};
+  cache.setArray(geometry::IndexSection::BVHIndices, values);
+  ASSERT_TRUE(cache.save());
+
+  // Same size, different content and modified later.
+  auto modified = fs::last_write_time(source);
+  writeCloud("test_index_cache_stale.ply", 1.0f);
+  fs::last_write_time(source, modified + std::chrono::seconds(1));
+  geometry::IndexCache stale(source, geometry::IndexKind::PointCloud);
+  ASSERT_FALSE(stale.load());
+
+  // Same size and modification time, but another header.
+  ASSERT_TRUE(cache.save());
+  modified = fs::last_write_time(source);
+  {
+    std::fstream file(source, std::ios::in | std::ios::out | std::ios::binary);
+    std::string header(64, '\0');
+    file.read(header.data(), header.size());
+    file.seekp(header.find("1.0"));
+    file << "1.1";
+  }
+  fs::last_write_time(source, modified);
+  ASSERT_FALSE(stale.load());
+}
+
+TEST(TestIndexCache, RayTraceCloud) {
+  fs::path source = writeCloud("test_index_cache_cloud.ply", 0.0f);
+  fs::remove(geometry::IndexCache(source, geometry::IndexKind::PointCloud).path());
+  auto pointCloud = std::make_shared<geometry::PointCloud>(source.string());
+  const Vector3f origin(0.5f, 0.5f, 1.0f);
+  const Vector3f direction(0.0f, 0.0f, -1.0f);
+
+  geometry::RayTraceCloud built(pointCloud, source);
+  built.build();
+  ASSERT_TRUE(fs::exists(geometry::IndexCache(source, geometry::IndexKind::PointCloud).path()));
+
+  geometry::RayTraceCloud cached(pointCloud, source);
+  cached.build();
+  auto builtHit = built.traceRayIntersection(origin, direction, 1.0f);
+  auto cachedHit = cached.traceRayIntersection(origin, direction, 1.0f);
+  ASSERT_TRUE(cachedHit.hit);
+  ASSERT_EQ(builtHit.point, cachedHit.point);
+  ASSERT_EQ(builtHit.normal, cachedHit.normal);
+}
+
+TEST(TestIndexCache, RayTraceMesh) {
+  // A tetrahedron with one face in the z = 0 plane.
+  fs::path source = fs::temp_directory_path() / "test_index_cache_mesh.ply";
+  {
+    test_helpers::PlyWriter writer(source, {.vertices = 5, .faces = 4, .ascii = true});
+    writer.vertex(Eigen::Vector3f(0.0f, 0.0f, 0.0f));
+    writer.vertex(Eigen::Vector3f(1.0f, 0.0f, 0.0f));
+    writer.vertex(Eigen::Vector3f(0.0f, 1.0f, 0.0f));
+    writer.vertex(Eigen::Vector3f(0.0f, 0.0f, 1.0f));
+    // Not part of any face.
+    writer.vertex(Eigen::Vector3f(5.0f, 5.0f, 5.0f));
+    writer.face(0, 2, 1);
+    writer.face(0, 1, 3);
+    writer.face(0, 3, 2);
+    writer.face(1, 2, 3);
+  }
+  fs::remove(geometry::IndexCache(source, geometry::IndexKind::TriangleMesh).path());
+
+  auto mesh = std::make_shared<geometry::Mesh>(source.string());
+  geometry::RayTraceMesh built(mesh, source);
+  fs::path cachePath = geometry::IndexCache(source, geometry::IndexKind::TriangleMesh).path();
+  ASSERT_TRUE(fs::exists(cachePath));
+  // Used as it is, not written again.
+  auto written = fs::last_write_time(cachePath) - std::chrono::hours(1);
+  fs::last_write_time(cachePath, written);
+  geometry::RayTraceMesh cached(mesh, source);
+  ASSERT_EQ(fs::last_write_time(cachePath), written);
+  const Vector3f origin(0.1f, 0.1f, -1.0f);
+  const Vector3f direction(0.0f, 0.0f, 1.0f);
+  auto hit = cached.traceRay(origin, direction);
+  ASSERT_TRUE(hit.has_value());
+  ASSERT_EQ(hit, built.traceRay(origin, direction));
+  ASSERT_NEAR((*hit)[2], 0.0f, 1e-6f);
+
+  // A scaled mesh does not match the cached hierarchy and gets its own.
+  auto scaled = std::make_shared<geometry::Mesh>(source.string(), Matrix4f::Identity(), 2.0f);
+  geometry::RayTraceMesh rebuilt(scaled, source);
+  ASSERT_TRUE(rebuilt.traceRay(Vector3f(1.5f, 0.1f, -1.0f), direction).has_value());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include "scene_model.h"
+#include "utils/journal.h"
+#include "utils/autosave.h"
+#include "utils/annotation_file.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+fs::path temporaryPath(const std::string& name) {
+  fs::path path = fs::temp_directory_path() / name;
+  fs::remove(path);
+  fs::remove(utils::journal::pathFor(path));
+  return path;
+}
+
+std::vector<AnnotationEdit> someEdits() {
+  BBox bbox{.id = 2, .classId = 3, .position = Vector3f(1.0f, 2.0f, 3.0f)};
+  bbox.orientation = Quaternionf(AngleAxisf(0.5f, Vector3f::UnitZ()));
+  Rectangle rectangle(4, 1, Vector3f(0.5f, 0.0f, -1.0f), Quaternionf::Identity(), Vector2f(2.0f, 1.0f));
+  return {{AnnotationEdit::SetKeypoint, 1, 1, Keypoint(1, 2, Vector3f(0.1f, 0.2f, 0.3f))},
+          {AnnotationEdit::SetBoundingBox, 2, 2, bbox},
+          {AnnotationEdit::SetRectangle, 3, 4, rectangle},
+          {AnnotationEdit::RemoveKeypoint, 4, 1, std::monostate()},
+          {AnnotationEdit::RemoveBoundingBox, 5, 2, std::monostate()},
+          {AnnotationEdit::RemoveRectangle, 6, 4, std::monostate()}};
+}
+
+TEST(TestJournal, RoundTrip) {
+  fs::path path = utils::journal::pathFor(temporaryPath("test_journal_round_trip.json"));
+  std::vector<AnnotationEdit> edits = someEdits();
+  ASSERT_TRUE(utils::journal::append(path, {edits.begin(), edits.begin() + 2}));
+  ASSERT_TRUE(utils::journal::append(path, {edits.begin() + 2, edits.end()}));
+
+  std::vector<AnnotationEdit> read = utils::journal::read(path);
+  ASSERT_EQ(read.size(), edits.size());
+  for (size_t i = 0; i < edits.size(); i++) {
+    ASSERT_EQ(read[i].kind, edits[i].kind);
+    ASSERT_EQ(read[i].id, edits[i].id);
+    ASSERT_EQ(read[i].revision, i + 1);
+  }
+  const Keypoint& keypoint = std::get<Keypoint>(read[0].annotation);
+  ASSERT_EQ(keypoint.classId, 2);
+  ASSERT_TRUE(keypoint.position.isApprox(Vector3f(0.1f, 0.2f, 0.3f)));
+  const BBox& bbox = std::get<BBox>(read[1].annotation);
+  ASSERT_EQ(bbox.classId, 3);
+  ASSERT_TRUE(bbox.orientation.isApprox(std::get<BBox>(edits[1].annotation).orientation));
+  ASSERT_TRUE(bbox.dimensions.isApprox(BBox().dimensions));
+  const Rectangle& rectangle = std::get<Rectangle>(read[2].annotation);
+  ASSERT_EQ(rectangle.classId, 1);
+  ASSERT_TRUE(rectangle.size.isApprox(Vector2f(2.0f, 1.0f)));
+
+  // Rewriting keeps only the given edits, without any the journal is gone.
+  ASSERT_TRUE(utils::journal::rewrite(path, {edits.back()}));
+  ASSERT_EQ(utils::journal::read(path).size(), 1);
+  ASSERT_TRUE(utils::journal::rewrite(path, {}));
+  ASSERT_FALSE(fs::exists(path));
+  ASSERT_TRUE(utils::journal::read(path).empty());
+}
+
+TEST(TestJournal, IncompleteRecord) {
+  fs::path path = utils::journal::pathFor(temporaryPath("test_journal_incomplete.json"));
+  std::vector<AnnotationEdit> edits = someEdits();
+  ASSERT_TRUE(utils::journal::append(path, edits));
+  // As if the process died while appending the last record.
+  fs::resize_file(path, fs::file_size(path) - 3);
+  ASSERT_EQ(utils::journal::read(path).size(), edits.size() - 1);
+
+  // A record that was not written completely fails its checksum.
+  fs::remove(path);
+  ASSERT_TRUE(utils::journal::append(path, {edits[0]}));
+  size_t size = fs::file_size(path);
+  ASSERT_TRUE(utils::journal::append(path, {edits[1]}));
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(size + 12);
+    file.put('\xff');
+  }
+  ASSERT_EQ(utils::journal::read(path).size(), 1);
+}
+
+TEST(TestJournal, Recover) {
+  fs::path path = temporaryPath("test_journal_recover.json");
+  fs::path crashedPath = temporaryPath("test_journal_recover_crashed.json");
+  fs::path journalPath = utils::journal::pathFor(path);
+  SceneModel scene;
+  std::atomic<utils::Autosave::Clock::time_point> time = utils::Autosave::Clock::time_point();
+  utils::Autosave autosave({.delay = 10s, .maxDelay = 10s, .now = [&]() { return time.load(); }});
+  ASSERT_EQ(autosave.restore(scene, path, true), 0);
+
+  Keypoint keypoint = scene.addKeypoint(Vector3f::Ones());
+  scene.addKeypoint(Vector3f::Zero());
+  scene.removeKeypoint(keypoint);
+  BBox bbox{.id = -1, .classId = 1, .position = Vector3f::Ones()};
+  scene.addBoundingBox(bbox);
+  bbox.dimensions = Vector3f::Ones();
+  scene.updateBoundingBox(bbox);
+  autosave.update(scene, path);
+  // Edits reach the journal long before the file is saved.
+  time = time.load() + 1s;
+  autosave.clockChanged();
+  ASSERT_TRUE(fs::exists(journalPath));
+  ASSERT_EQ(autosave.saveCount(), 0);
+  ASSERT_FALSE(fs::exists(path));
+
+  // What would be left behind if the app crashed now.
+  fs::copy_file(journalPath, utils::journal::pathFor(crashedPath));
+  SceneModel recovered;
+  utils::Autosave recovering;
+  ASSERT_EQ(recovering.restore(recovered, crashedPath, true), 5);
+  ASSERT_EQ(recovered.getKeypoints().size(), 1);
+  ASSERT_EQ(recovered.getKeypoints()[0].id, scene.getKeypoints()[0].id);
+  ASSERT_TRUE(recovered.getBoundingBox(bbox.id)->dimensions.isApprox(Vector3f::Ones()));
+  // Recovered edits are saved to the file, which replaces the journal.
+  ASSERT_FALSE(fs::exists(utils::journal::pathFor(crashedPath)));
+  utils::annotation_file::Annotations saved;
+  ASSERT_TRUE(utils::annotation_file::read(crashedPath, saved));
+  ASSERT_EQ(saved.keypoints.size(), 1);
+  ASSERT_EQ(saved.boundingBoxes.size(), 1);
+
+  // Saving the file compacts the journal.
+  autosave.flush();
+  ASSERT_EQ(autosave.saveCount(), 1);
+  ASSERT_FALSE(fs::exists(journalPath));
+}
+
+TEST(TestJournal, UnreadableFile) {
+  fs::path path = temporaryPath("test_journal_unreadable.json");
+  fs::path journalPath = utils::journal::pathFor(path);
+  {
+    std::ofstream file(path);
+    file << "{\"keypoints\": [";
+  }
+  std::vector<AnnotationEdit> edits = someEdits();
+  ASSERT_TRUE(utils::journal::append(journalPath, edits));
+
+  // The edits cannot be applied without the file they were made to.
+  SceneModel scene;
+  utils::Autosave autosave;
+  bool loaded = scene.load(path);
+  ASSERT_FALSE(loaded);
+  ASSERT_EQ(autosave.restore(scene, path, loaded), 0);
+  ASSERT_TRUE(scene.getKeypoints().empty());
+  scene.addKeypoint(Vector3f::Ones());
+  autosave.update(scene, path);
+  ASSERT_FALSE(autosave.save(scene, path));
+  autosave.flush();
+  ASSERT_EQ(autosave.saveCount(), 0);
+  ASSERT_EQ(fs::file_size(path), 15);
+  ASSERT_EQ(utils::journal::read(journalPath).size(), edits.size());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -23,6 +23,8 @@ TEST(TestAddKeypointTool, BasicCase) {
   context.mousePositionY = 430;
   context.width = 500;
   context.height = 500;
+  // View controllers trace the cursor once and share the result with the tools.
+  context.pointingAt = sceneModel.traceRay(context.camera.getPosition(), context.rayWorld());
   view.mouseMoved(context);
   bool added = view.leftButtonUp(context);
   ASSERT_TRUE(added);
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include "geometry/point_cloud.h"
+#include "geometry/mesh.h"
+#include "geometry/ply_reader.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+std::string datasetPath;
+
+const float Vertices[4][3] = {
+    {0.0f, 0.0f, 0.0f},
+    {1.0f, 0.0f, 0.0f},
+    {0.0f, 1.0f, 0.0f},
+    {0.0f, 0.0f, 1.0f}};
+const uint8_t Colors[4][3] = {
+    {255, 0, 0},
+    {0, 255, 0},
+    {0, 0, 255},
+    {10, 20, 30}};
+const uint32_t Faces[4][3] = {
+    {0, 2, 1},
+    {0, 1, 3},
+    {0, 3, 2},
+    {1, 2, 3}};
+
+fs::path writeTetrahedron(const fs::path& path, bool ascii) {
+  test_helpers::PlyWriter writer(path, {.vertices = 4, .faces = 4, .colors = true, .ascii = ascii});
+  for (int i = 0; i < 4; i++) {
+    Eigen::Vector3f color = Eigen::Vector3f(Colors[i][0], Colors[i][1], Colors[i][2]) / 255.0f;
+    writer.vertex(Eigen::Vector3f(Vertices[i][0], Vertices[i][1], Vertices[i][2]), color);
+  }
+  for (int i = 0; i < 4; i++) {
+    writer.face(Faces[i][0], Faces[i][1], Faces[i][2]);
+  }
+  return path;
+}
+
+fs::path writeBinary() {
+  return writeTetrahedron(fs::temp_directory_path() / "test_ply_reader_binary.ply", false);
+}
+
+fs::path writeAscii() {
+  return writeTetrahedron(fs::temp_directory_path() / "test_ply_reader_ascii.ply", true);
+}
+
+TEST(TestPlyReader, Header) {
+  geometry::PlyReader reader(writeBinary());
+  ASSERT_TRUE(reader.isBinaryLittleEndian());
+  ASSERT_EQ(reader.getElement("vertex")->count, 4);
+  ASSERT_EQ(reader.getElement("vertex")->stride, 15);
+  ASSERT_EQ(reader.getElement("face")->stride, 0);
+  ASSERT_TRUE(reader.hasProperty("vertex", "red"));
+  ASSERT_FALSE(reader.hasProperty("vertex", "nx"));
+
+  geometry::PlyReader asciiReader(writeAscii());
+  ASSERT_FALSE(asciiReader.isBinaryLittleEndian());
+}
+
+fs::path writeRaw(const std::string& name, const std::string& contents) {
+  fs::path path = fs::temp_directory_path() / name;
+  std::ofstream(path, std::ios::binary) << contents;
+  return path;
+}
+
+TEST(TestPlyReader, HeaderEnd) {
+  // Only a line of its own ends the header, not the same text in the body.
+  const std::string header = "ply\nformat binary_little_endian 1.0\nelement vertex 1\nproperty float x\n";
+  ASSERT_THROW(geometry::PlyReader(writeRaw("test_ply_reader_no_end.ply", header + "\x01\x02" "end_header\n")),
+               std::runtime_error);
+  ASSERT_THROW(geometry::PlyReader(writeRaw("test_ply_reader_unended.ply", header + "end_header")), std::runtime_error);
+  geometry::PlyReader reader(writeRaw("test_ply_reader_crlf.ply", "ply\r\nformat binary_little_endian 1.0\r\n"
+                                                                  "element vertex 1\r\nproperty float x\r\nend_header\r\n"
+                                                                  "\x00\x00\x80\x3f"));
+  ASSERT_EQ(reader.getElement("vertex")->count, 1);
+}
+
+TEST(TestPlyReader, TruncatedList) {
+  // Faces come first, the second is missing, so finding the vertices runs into the end of the file.
+  std::string contents = "ply\nformat binary_little_endian 1.0\n"
+                         "element face 2\nproperty list uchar int vertex_indices\n"
+                         "element vertex 1\nproperty float x\nproperty float y\nproperty float z\nend_header\n";
+  contents += std::string("\x03", 1) + std::string(12, '\0');
+  geometry::PlyReader reader(writeRaw("test_ply_reader_truncated.ply", contents));
+  geometry::RowMatrixf points;
+  ASSERT_THROW(reader.readColumns("vertex", {"x", "y", "z"}, points), std::runtime_error);
+}
+
+TEST(TestPlyReader, BinaryMatchesAscii) {
+  geometry::PointCloud binary(writeBinary().string());
+  geometry::PointCloud ascii(writeAscii().string());
+  ASSERT_EQ(binary.points.rows(), 4);
+  ASSERT_EQ(binary.points, ascii.points);
+  ASSERT_EQ(binary.colors, ascii.colors);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 3; j++) {
+      ASSERT_EQ(binary.points(i, j), Vertices[i][j]);
+      ASSERT_EQ(binary.colors(i, j), Colors[i][j]);
+    }
+  }
+}
+
+TEST(TestPlyReader, QuantizedPositions) {
+  geometry::PointCloud binary(writeBinary().string(), true);
+  geometry::PointCloud ascii(writeAscii().string(), true);
+  ASSERT_TRUE(binary.isQuantized());
+  ASSERT_EQ(binary.size(), 4);
+  ASSERT_EQ(binary.quantizedPoints, ascii.quantizedPoints);
+  ASSERT_EQ(binary.colors, ascii.colors);
+  for (int i = 0; i < 4; i++) {
+    // All vertices are on the corners of the bounding box, which quantize exactly.
+    Vector3f vertex(Vertices[i][0], Vertices[i][1], Vertices[i][2]);
+    ASSERT_LE((binary.point(i) - vertex).cwiseAbs().maxCoeff(), 1e-6f);
+  }
+}
+
+TEST(TestPlyReader, Mesh) {
+  geometry::Mesh binary(writeBinary().string(), Matrix4f::Identity(), 2.0f);
+  geometry::Mesh ascii(writeAscii().string(), Matrix4f::Identity(), 2.0f);
+  ASSERT_TRUE(binary.colorsFromFile);
+  ASSERT_EQ(binary.faces().rows(), 4);
+  ASSERT_EQ(binary.faces(), ascii.faces());
+  ASSERT_EQ(binary.vertices(), ascii.vertices());
+  ASSERT_EQ(binary.getVertexColors(), ascii.getVertexColors());
+  ASSERT_EQ(binary.vertices()(1, 0), 2.0f);
+  ASSERT_EQ(binary.faces()(3, 2), 3);
+}
+
+TEST(TestPlyReader, DatasetMesh) {
+  fs::path path = fs::path(datasetPath) / "scene" / "integrated.ply";
+  geometry::Mesh mesh(path.string());
+  ASSERT_GT(mesh.vertices().rows(), 0);
+  ASSERT_GT(mesh.faces().rows(), 0);
+  ASSERT_LT(mesh.faces().maxCoeff(), mesh.vertices().rows());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  datasetPath = argv[1];
+  return RUN_ALL_TESTS();
+}
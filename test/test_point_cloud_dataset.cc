@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include "model/point_cloud_dataset.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+const int CloudCount = 6;
+
+fs::path writeClouds() {
+  fs::path directory = fs::temp_directory_path() / "test_point_cloud_dataset";
+  fs::remove_all(directory);
+  fs::create_directories(directory);
+  for (int i = 0; i < CloudCount; i++) {
+    // Cloud i has i + 1 points, all at x = i, which identifies it.
+    std::vector<Eigen::Vector3f> points;
+    for (int j = 0; j < i + 1; j++) {
+      points.emplace_back(float(i), float(j), 0.0f);
+    }
+    test_helpers::writePointCloud(directory / ("cloud_" + std::to_string(i) + ".ply"), points);
+  }
+  return directory;
+}
+
+bool waitUntilCached(const model::PointCloudDataset& dataset, int index) {
+  for (int i = 0; i < 500; i++) {
+    if (dataset.isCached(index)) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return false;
+}
+
+int cloudId(const model::DatasetPointCloudFuture& future) {
+  return int(future.get().pointCloud->points(0, 0));
+}
+
+TEST(TestPointCloudDataset, Navigation) {
+  fs::path directory = writeClouds();
+  model::PointCloudDataset dataset(directory / "cloud_2.ply");
+  ASSERT_EQ(dataset.size(), CloudCount);
+  ASSERT_EQ(cloudId(dataset.getCurrentCloud()), 2);
+  ASSERT_EQ(dataset.nextPath(), directory / "cloud_3.ply");
+  ASSERT_EQ(dataset.previousPath(), directory / "cloud_1.ply");
+
+  ASSERT_EQ(cloudId(dataset.next()), 3);
+  ASSERT_EQ(dataset.currentPath(), directory / "cloud_3.ply");
+  ASSERT_EQ(cloudId(dataset.previous()), 2);
+  ASSERT_EQ(cloudId(dataset.previous()), 1);
+  ASSERT_EQ(cloudId(dataset.previous()), 0);
+  // Wraps around in both directions.
+  ASSERT_EQ(cloudId(dataset.previous()), 5);
+  ASSERT_EQ(cloudId(dataset.next()), 0);
+  ASSERT_EQ(cloudId(dataset.seek(4)), 4);
+  ASSERT_EQ(dataset.getCurrentCloud().get().pointCloud->points.rows(), 5);
+}
+
+TEST(TestPointCloudDataset, Prefetch) {
+  fs::path directory = writeClouds();
+  model::PointCloudDataset dataset(directory / "cloud_2.ply", {.lookAhead = 2, .lookBehind = 1});
+  dataset.getCurrentCloud().wait();
+  ASSERT_TRUE(waitUntilCached(dataset, 3));
+  ASSERT_TRUE(waitUntilCached(dataset, 4));
+  ASSERT_TRUE(waitUntilCached(dataset, 1));
+  ASSERT_FALSE(dataset.isCached(5));
+
+  // Clouds stay cached after leaving the window, as long as they fit the budget.
+  dataset.seek(5).wait();
+  ASSERT_TRUE(waitUntilCached(dataset, 0));
+  ASSERT_TRUE(dataset.isCached(2));
+  ASSERT_TRUE(dataset.isCached(1));
+}
+
+TEST(TestPointCloudDataset, MemoryBudget) {
+  fs::path directory = writeClouds();
+  model::PointCloudDataset dataset(directory / "cloud_0.ply", {.lookAhead = 1, .lookBehind = 0, .memoryBudget = 0});
+  for (int i = 0; i < CloudCount; i++) {
+    ASSERT_EQ(cloudId(dataset.next()), (i + 1) % CloudCount);
+  }
+  // Only the current cloud is ever kept when the budget is exhausted. Its
+  // acceleration structures count too, once built.
+  model::DatasetPointCloud current = dataset.getCurrentCloud().get();
+  ASSERT_LE(dataset.cacheSizeInBytes(), current.pointCloud->sizeInBytes() + current.rayTraceCloud->sizeInBytes());
+}
+
+TEST(TestPointCloudDataset, FailedLoad) {
+  fs::path directory = writeClouds();
+  fs::path corrupt = directory / "cloud_3.ply";
+  std::ofstream(corrupt) << "not a point cloud";
+  model::PointCloudDataset dataset(directory / "cloud_2.ply", {.lookAhead = 1, .lookBehind = 0});
+  ASSERT_EQ(cloudId(dataset.getCurrentCloud()), 2);
+  const int shownIndex = dataset.getCurrentIndex();
+  ASSERT_THROW(dataset.next().get(), std::exception);
+  ASSERT_FALSE(dataset.isCached(3));
+  ASSERT_EQ(dataset.currentPath(), corrupt);
+
+  // The failure is not kept, the cloud loads once it can be read.
+  test_helpers::writePointCloud(corrupt, {Eigen::Vector3f(3.0f, 0.0f, 0.0f)});
+  // Seeking back to the cloud still shown, stepping on does not skip the one that failed.
+  ASSERT_EQ(cloudId(dataset.seek(shownIndex)), 2);
+  ASSERT_EQ(dataset.currentPath(), directory / "cloud_2.ply");
+  ASSERT_EQ(cloudId(dataset.next()), 3);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <filesystem>
+#include <eigen3/Eigen/Dense>
+#include "geometry/point_cloud_octree.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+using namespace Eigen;
+
+const int PointCount = 50000;
+
+std::shared_ptr<geometry::PointCloud> randomCloud() {
+  // Points on the faces of the unit cube around the origin.
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coordinate(-0.5f, 0.5f);
+  std::vector<Vector3f> points;
+  for (int i = 0; i < PointCount; i++) {
+    Vector3f point(coordinate(rng), coordinate(rng), coordinate(rng));
+    point[i % 3] = i % 2 == 0 ? -0.5f : 0.5f;
+    points.push_back(point);
+  }
+  fs::path path = test_helpers::writePointCloud(fs::temp_directory_path() / "test_point_cloud_octree.ply", points);
+  return std::make_shared<geometry::PointCloud>(path.string());
+}
+
+geometry::LODQuery lookAt(const Vector3f& eye, const Vector3f& target, size_t pointBudget = 1000000) {
+  const float fov = 30.0f * M_PI / 180.0f;
+  const float near = 0.1f;
+  const float far = 1000.0f;
+  const float focal = 1.0f / std::tan(fov / 2.0f);
+  Matrix4f projection = Matrix4f::Zero();
+  projection(0, 0) = focal;
+  projection(1, 1) = focal;
+  projection(2, 2) = (far + near) / (near - far);
+  projection(2, 3) = 2.0f * far * near / (near - far);
+  projection(3, 2) = -1.0f;
+
+  Vector3f forward = (target - eye).normalized();
+  Vector3f right = forward.cross(Vector3f::UnitY()).normalized();
+  Vector3f up = right.cross(forward);
+  Matrix4f view = Matrix4f::Identity();
+  view.block<1, 3>(0, 0) = right.transpose();
+  view.block<1, 3>(1, 0) = up.transpose();
+  view.block<1, 3>(2, 0) = -forward.transpose();
+  view.block<3, 1>(0, 3) = -view.block<3, 3>(0, 0) * eye;
+
+  geometry::LODQuery query;
+  query.viewProjection = projection * view;
+  query.eye = eye;
+  query.pixelsPerUnit = 600.0f / (2.0f * std::tan(fov / 2.0f));
+  query.pointBudget = pointBudget;
+  return query;
+}
+
+size_t selectedPoints(const geometry::PointCloudOctree& octree, const std::vector<uint32_t>& selected) {
+  size_t points = 0;
+  for (uint32_t node : selected) {
+    points += octree.getNodes()[node].count;
+  }
+  return points;
+}
+
+TEST(TestPointCloudOctree, Partition) {
+  auto cloud = randomCloud();
+  geometry::PointCloudOctree octree(*cloud, {.nodeCapacity = 1000});
+  const auto& nodes = octree.getNodes();
+  ASSERT_GT(nodes.size(), 8);
+
+  // Every point is in exactly one node.
+  std::vector<uint32_t> order = octree.getOrder();
+  std::sort(order.begin(), order.end());
+  for (int i = 0; i < PointCount; i++) {
+    ASSERT_EQ(order[i], i);
+  }
+
+  size_t total = 0;
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    const geometry::OctreeNode& node = nodes[i];
+    ASSERT_LE(node.count, 1000);
+    total += node.count;
+    for (uint32_t point : octree.nodePoints(i)) {
+      Vector3f offset = (cloud->point(point) - node.center).cwiseAbs();
+      ASSERT_LE(offset.maxCoeff(), node.halfSize * 1.0001f);
+    }
+    for (int32_t child : node.children) {
+      if (child < 0) continue;
+      ASSERT_EQ(nodes[child].depth, node.depth + 1);
+      ASSERT_FLOAT_EQ(nodes[child].halfSize, 0.5f * node.halfSize);
+    }
+  }
+  ASSERT_EQ(total, PointCount);
+  ASSERT_LE(octree.maxNodeSize(), 1000);
+}
+
+TEST(TestPointCloudOctree, SelectAll) {
+  auto cloud = randomCloud();
+  geometry::PointCloudOctree octree(*cloud, {.nodeCapacity = 1000});
+  geometry::LODQuery query = lookAt(Vector3f(0.0f, 0.0f, 5.0f), Vector3f::Zero());
+  query.maxScreenSpaceError = 0.0f;
+  std::vector<uint32_t> selected = octree.select(query);
+  ASSERT_EQ(selected.size(), octree.getNodes().size());
+  ASSERT_EQ(selected[0], 0);
+  ASSERT_EQ(selectedPoints(octree, selected), PointCount);
+}
+
+TEST(TestPointCloudOctree, LevelOfDetail) {
+  auto cloud = randomCloud();
+  geometry::PointCloudOctree octree(*cloud, {.nodeCapacity = 1000});
+  size_t near = selectedPoints(octree, octree.select(lookAt(Vector3f(0.0f, 0.0f, 3.0f), Vector3f::Zero())));
+  size_t far = selectedPoints(octree, octree.select(lookAt(Vector3f(0.0f, 0.0f, 300.0f), Vector3f::Zero())));
+  ASSERT_GT(far, 0);
+  ASSERT_LT(far, near);
+  // Far enough away, the root alone is detailed enough.
+  ASSERT_EQ(octree.select(lookAt(Vector3f(0.0f, 0.0f, 300.0f), Vector3f::Zero())).size(), 1);
+}
+
+TEST(TestPointCloudOctree, FrustumCulling) {
+  auto cloud = randomCloud();
+  geometry::PointCloudOctree octree(*cloud, {.nodeCapacity = 1000});
+  // Looking away from the cloud.
+  ASSERT_TRUE(octree.select(lookAt(Vector3f(0.0f, 0.0f, 3.0f), Vector3f(0.0f, 0.0f, 6.0f))).empty());
+
+  // Looking at one corner from up close skips the nodes outside of the view.
+  geometry::LODQuery query = lookAt(Vector3f(0.45f, 0.45f, 0.6f), Vector3f(0.45f, 0.45f, 0.0f));
+  query.maxScreenSpaceError = 0.0f;
+  std::vector<uint32_t> selected = octree.select(query);
+  ASSERT_FALSE(selected.empty());
+  ASSERT_LT(selected.size(), octree.getNodes().size());
+}
+
+TEST(TestPointCloudOctree, PointBudget) {
+  auto cloud = randomCloud();
+  geometry::PointCloudOctree octree(*cloud, {.nodeCapacity = 1000});
+  geometry::LODQuery query = lookAt(Vector3f(0.0f, 0.0f, 2.0f), Vector3f::Zero(), 5000);
+  query.maxScreenSpaceError = 0.0f;
+  std::vector<uint32_t> selected = octree.select(query);
+  ASSERT_LE(selectedPoints(octree, selected), 5000);
+  ASSERT_GT(selectedPoints(octree, selected), 4000);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
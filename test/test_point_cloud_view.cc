@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <bgfx/bgfx.h>
+#include "scene_model.h"
+#include "view_context_3d.h"
+#include "views/point_cloud_view.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+TEST(TestPointCloudView, FlatBuffers) {
+  // More points than fit in two uploads, drawn without an octree.
+  const size_t pointCount = 1200000;
+  fs::path path = fs::temp_directory_path() / "test_point_cloud_view.ply";
+  {
+    test_helpers::PlyWriter writer(path, {.vertices = pointCount});
+    for (size_t i = 0; i < pointCount; i++) {
+      writer.vertex(Eigen::Vector3f(float(i % 1000) * 0.01f, float(i / 1000) * 0.01f, 0.0f));
+    }
+  }
+  auto cloud = std::make_shared<geometry::PointCloud>(path.string());
+  SceneModel scene;
+  // An unbuilt ray tracer, the octree is built in the background but never handed to the view.
+  scene.setPointCloud(cloud, std::make_shared<geometry::RayTraceCloud>(cloud));
+  views::PointCloudView view(scene, 0);
+  view.loadPointCloud();
+
+  ViewContext3D context;
+  context.width = 640;
+  context.height = 480;
+  // One buffer is uploaded per frame, while the ones uploaded before are drawn.
+  for (size_t frame = 1; frame <= 3; frame++) {
+    view.render(context);
+    bgfx::frame();
+    ASSERT_EQ(view.getLastFrameStats().nodes, frame);
+    ASSERT_EQ(view.getLastFrameStats().deferredNodes, 3 - frame);
+  }
+  view.render(context);
+  bgfx::frame();
+  ASSERT_EQ(view.getLastFrameStats().points, pointCount);
+  ASSERT_EQ(view.getLastFrameStats().uploadedPoints, 0);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  bgfx::Init init;
+  init.type = bgfx::RendererType::Noop;
+  bgfx::init(init);
+  int result = RUN_ALL_TESTS();
+  bgfx::shutdown();
+  return result;
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "geometry/ray_trace_cloud.h"
+#include "helpers/ply_writer.h"
+
+namespace fs = std::filesystem;
+
+const int GridSize = 20;
+const float GridSpacing = 0.1f;
+
+std::shared_ptr<geometry::PointCloud> gridCloud(bool withNormals = false, bool quantize = false) {
+  // A flat grid of points in the z = 0 plane.
+  fs::path path = fs::temp_directory_path() / "test_ray_trace_cloud.ply";
+  {
+    test_helpers::PlyWriter writer(path, {.vertices = GridSize * GridSize, .normals = withNormals});
+    for (int i = 0; i < GridSize; i++) {
+      for (int j = 0; j < GridSize; j++) {
+        // Deliberately not the geometric normal, to tell them apart.
+        writer.vertex(Eigen::Vector3f(i * GridSpacing, j * GridSpacing, 0.0f), Eigen::Vector3f::Ones(),
+                      Eigen::Vector3f::UnitX());
+      }
+    }
+  }
+  return std::make_shared<geometry::PointCloud>(path.string(), quantize);
+}
+
+TEST(TestRayTraceCloud, FallbackMatchesBVH) {
+  auto cloud = gridCloud();
+  geometry::RayTraceCloud rayTraceCloud(cloud);
+  ASSERT_FALSE(rayTraceCloud.isReady());
+
+  std::vector<Vector3f> origins;
+  for (int i = 0; i < GridSize; i += 3) {
+    origins.push_back(Vector3f(i * GridSpacing + 0.001f, (GridSize - i - 1) * GridSpacing, 1.0f));
+  }
+  origins.push_back(Vector3f(-1.0f, -1.0f, 1.0f));
+  const Vector3f direction(0.0f, 0.0f, -1.0f);
+
+  std::vector<std::optional<Vector3f>> fallbackHits;
+  for (const Vector3f& origin : origins) {
+    fallbackHits.push_back(rayTraceCloud.traceRay(origin, direction, 1.0f));
+  }
+  rayTraceCloud.build();
+  ASSERT_TRUE(rayTraceCloud.isReady());
+
+  for (size_t i = 0; i < origins.size(); i++) {
+    auto hit = rayTraceCloud.traceRay(origins[i], direction, 1.0f);
+    ASSERT_EQ(hit.has_value(), fallbackHits[i].has_value());
+    if (hit.has_value()) {
+      ASSERT_EQ(*hit, *fallbackHits[i]);
+      ASSERT_NEAR((*hit - Vector3f(origins[i][0], origins[i][1], 0.0f)).norm(), 0.001f, 1e-5f);
+    }
+  }
+  ASSERT_FALSE(fallbackHits.back().has_value());
+}
+
+TEST(TestRayTraceCloud, Intersection) {
+  geometry::RayTraceCloud rayTraceCloud(gridCloud());
+  const Vector3f origin(0.5f, 0.5f, 1.0f);
+  const Vector3f direction(0.0f, 0.0f, -1.0f);
+  auto before = rayTraceCloud.traceRayIntersection(origin, direction, 1.0f);
+  rayTraceCloud.build();
+  auto after = rayTraceCloud.traceRayIntersection(origin, direction, 1.0f);
+  ASSERT_TRUE(before.hit);
+  ASSERT_TRUE(after.hit);
+  ASSERT_EQ(before.point, after.point);
+  // The grid is flat, so the estimated normal is along the z axis.
+  ASSERT_NEAR(std::abs(after.normal[2]), 1.0f, 1e-4f);
+}
+
+TEST(TestRayTraceCloud, TraceRays) {
+  geometry::RayTraceCloud rayTraceCloud(gridCloud());
+  std::vector<geometry::Ray> rays;
+  for (int i = -2; i < GridSize + 2; i++) {
+    for (int j = -2; j < GridSize + 2; j++) {
+      Vector3f origin(i * GridSpacing + 0.002f, j * GridSpacing - 0.001f, 1.0f);
+      rays.push_back({origin, Vector3f(0.0f, 0.0f, -1.0f)});
+    }
+  }
+
+  for (bool built : {false, true}) {
+    if (built) rayTraceCloud.build();
+    std::vector<geometry::Intersection> intersections = rayTraceCloud.traceRays(rays, 1.0f);
+    ASSERT_EQ(intersections.size(), rays.size());
+    int hits = 0;
+    for (size_t i = 0; i < rays.size(); i++) {
+      auto single = rayTraceCloud.traceRayIntersection(rays[i].origin, rays[i].direction, 1.0f);
+      ASSERT_EQ(intersections[i].hit, single.hit);
+      if (single.hit) {
+        ASSERT_EQ(intersections[i].point, single.point);
+        ASSERT_EQ(intersections[i].normal, single.normal);
+        hits++;
+      }
+    }
+    ASSERT_EQ(hits, GridSize * GridSize);
+  }
+}
+
+TEST(TestRayTraceCloud, EstimateNormals) {
+  auto cloud = gridCloud();
+  ASSERT_FALSE(cloud->hasNormals());
+  cloud->estimateNormals();
+  ASSERT_TRUE(cloud->hasNormals());
+  for (int i = 0; i < cloud->normals.rows(); i++) {
+    ASSERT_NEAR(std::abs(cloud->normals(i, 2)), 1.0f, 1e-4f);
+  }
+}
+
+TEST(TestRayTraceCloud, NormalsFromFile) {
+  auto cloud = gridCloud(true);
+  ASSERT_TRUE(cloud->hasNormals());
+  geometry::RayTraceCloud rayTraceCloud(cloud);
+  rayTraceCloud.build();
+  auto hit = rayTraceCloud.traceRayIntersection(Vector3f(0.5f, 0.5f, 1.0f), Vector3f(0.0f, 0.0f, -1.0f), 1.0f);
+  ASSERT_TRUE(hit.hit);
+  ASSERT_NEAR(std::abs(hit.normal[0]), 1.0f, 1e-6f);
+}
+
+TEST(TestRayTraceCloud, DegenerateNormalsFromFile) {
+  fs::path path = fs::temp_directory_path() / "test_ray_trace_cloud_degenerate.ply";
+  {
+    test_helpers::PlyWriter writer(path, {.vertices = GridSize * GridSize, .normals = true});
+    for (int i = 0; i < GridSize * GridSize; i++) {
+      // Every other normal is too long, the others have no direction.
+      Eigen::Vector3f normal = i % 2 == 0 ? Eigen::Vector3f(3.0f, 0.0f, 0.0f) : Eigen::Vector3f::Zero();
+      writer.vertex(Eigen::Vector3f((i / GridSize) * GridSpacing, (i % GridSize) * GridSpacing, 0.0f),
+                    Eigen::Vector3f::Ones(), normal);
+    }
+  }
+  auto cloud = std::make_shared<geometry::PointCloud>(path.string());
+  ASSERT_FALSE(cloud->hasNormals());
+  ASSERT_TRUE(cloud->normals.row(0).isApprox(Eigen::RowVector3f::UnitX()));
+
+  geometry::RayTraceCloud rayTraceCloud(cloud);
+  rayTraceCloud.build();
+  ASSERT_TRUE(cloud->hasNormals());
+  for (int i = 0; i < cloud->normals.rows(); i++) {
+    if (i % 2 == 0) {
+      ASSERT_TRUE(cloud->normals.row(i).isApprox(Eigen::RowVector3f::UnitX()));
+    } else {
+      ASSERT_NEAR(std::abs(cloud->normals(i, 2)), 1.0f, 1e-4f);
+    }
+  }
+}
+
+TEST(TestRayTraceCloud, QuantizedPositions) {
+  auto cloud = gridCloud();
+  auto quantized = gridCloud(false, true);
+  ASSERT_TRUE(quantized->isQuantized());
+  ASSERT_EQ(quantized->points.rows(), 0);
+  ASSERT_EQ(quantized->size(), cloud->size());
+  // Three 16 bit coordinates and three 8 bit color channels per point.
+  ASSERT_EQ(quantized->sizeInBytes(), cloud->size() * 9);
+  const float step = (GridSize - 1) * GridSpacing / 65534.0f;
+  for (size_t i = 0; i < cloud->size(); i++) {
+    ASSERT_LE((quantized->point(i) - cloud->point(i)).cwiseAbs().maxCoeff(), step);
+  }
+  ASSERT_LE((quantized->getMean() - cloud->getMean()).norm(), 1e-4f);
+  ASSERT_LE((quantized->getStd() - cloud->getStd()).norm(), 1e-4f);
+
+  geometry::RayTraceCloud rayTraceCloud(quantized);
+  std::vector<geometry::Ray> rays;
+  for (int i = 0; i < GridSize; i++) {
+    rays.push_back({Vector3f(i * GridSpacing, (GridSize - i - 1) * GridSpacing, 1.0f), Vector3f(0.0f, 0.0f, -1.0f)});
+  }
+  auto before = rayTraceCloud.traceRays(rays, 1.0f);
+  rayTraceCloud.build();
+  auto after = rayTraceCloud.traceRays(rays, 1.0f);
+  for (size_t i = 0; i < rays.size(); i++) {
+    ASSERT_TRUE(after[i].hit);
+    ASSERT_EQ(before[i].point, after[i].point);
+    ASSERT_LE((after[i].point - Vector3f(rays[i].origin[0], rays[i].origin[1], 0.0f)).norm(), 2.0f * step);
+    ASSERT_NEAR(std::abs(after[i].normal[2]), 1.0f, 1e-4f);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
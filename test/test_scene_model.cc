@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "scene_model.h"
 #include "utils/dataset.h"
+#include "utils/main_loop.h"
+#include "helpers/ply_writer.h"
 
 std::string datasetPath;
 
@@ -19,10 +21,19 @@ TEST(TestAddKeypointAddRemove, BasicCase) {
   ASSERT_EQ(model.getKeypoints().size(), 3);
 
   model.removeKeypoint(kp1);
+  ASSERT_EQ(model.getKeypoints().size(), 2);
+  ASSERT_FALSE(model.getKeypoint(kp1.id).has_value());
+  ASSERT_EQ(model.getKeypoint(kp3.id).value().id, kp3.id);
   model.removeKeypoint(kp2);
   model.removeKeypoint(kp3);
   ASSERT_EQ(model.getKeypoints().size(), 0);
-  ASSERT_EQ(model.getKeypoints()[1].id, 3);
+
+  // Ids of removed keypoints are not reused.
+  auto kp4 = model.addKeypoint(Vector3f::Zero());
+  ASSERT_NE(kp4.id, kp1.id);
+  ASSERT_NE(kp4.id, kp2.id);
+  ASSERT_NE(kp4.id, kp3.id);
+  model.removeKeypoint(kp4);
 
   BBox bbox = {.id = -1, .position = Vector3f::Ones()};
   model.addBoundingBox(bbox);
@@ -51,10 +62,188 @@ TEST(TestUpdateKeypoint, BasicCase) {
   ASSERT_EQ(model.getKeypoint(kp1.id).value().classId, 3);
 }
 
+TEST(SceneModelTest, AnnotationRevision) {
+  SceneModel model;
+  uint64_t revision = model.getAnnotationRevision();
+  auto expectChanged = [&]() {
+    ASSERT_GT(model.getAnnotationRevision(), revision);
+    revision = model.getAnnotationRevision();
+  };
+  auto keypoint = model.addKeypoint(Vector3f::Ones());
+  expectChanged();
+  model.setKeypoint(Keypoint(keypoint.id, Vector3f::Zero()));
+  expectChanged();
+
+  BBox bbox = {.id = -1, .position = Vector3f::Ones()};
+  model.addBoundingBox(bbox);
+  expectChanged();
+  bbox.dimensions = Vector3f::Constant(2.0f);
+  model.updateBoundingBox(bbox);
+  expectChanged();
+
+  Rectangle rectangle(1, 0, Vector3f::Zero(), Quaternionf::Identity(), Vector2f::Ones());
+  model.addRectangle(rectangle);
+  expectChanged();
+  model.removeRectangle(rectangle.id);
+  expectChanged();
+
+  // Reading does not change anything.
+  model.getKeypoints();
+  model.getBoundingBoxes();
+  model.getKeypoint(keypoint.id);
+  ASSERT_EQ(model.getAnnotationRevision(), revision);
+
+  model.reset();
+  expectChanged();
+}
+
+TEST(SceneModelTest, HoveredRectangle) {
+  SceneModel model;
+  model.recordEdits(true);
+  Rectangle rectangle(1, 0, Vector3f::Zero(), Quaternionf::Identity(), Vector2f::Ones());
+  model.addRectangle(rectangle);
+  model.takeEdits();
+  const uint64_t revision = model.getAnnotationRevision();
+  const uint64_t displayRevision = model.getDisplayRevision();
+  // Hovering is drawn, but is not an edit.
+  model.setHoveredRectangle(rectangle.id);
+  ASSERT_EQ(model.getHoveredRectangle(), rectangle.id);
+  ASSERT_GT(model.getDisplayRevision(), displayRevision);
+  ASSERT_EQ(model.getAnnotationRevision(), revision);
+  ASSERT_TRUE(model.takeEdits().empty());
+  // The display revision does not go back once hovering stops.
+  model.setHoveredRectangle(-1);
+  ASSERT_GT(model.getDisplayRevision(), displayRevision + 1);
+  // Edits change both.
+  model.removeRectangle(rectangle.id);
+  ASSERT_GT(model.getAnnotationRevision(), revision);
+  ASSERT_GT(model.getDisplayRevision(), displayRevision + 2);
+}
+
+TEST(SceneModelTest, StableIds) {
+  fs::path path = fs::temp_directory_path() / "test_scene_model_annotations.json";
+  {
+    SceneModel model;
+    auto kp1 = model.addKeypoint(Vector3f::Zero());
+    auto kp2 = model.addKeypoint(Vector3f::Ones());
+    ASSERT_EQ(kp2.id, kp1.id + 1);
+    auto kp3 = model.addKeypoint(Vector3f::Ones());
+    model.removeKeypoint(kp3);
+    // A removed id is not handed out again.
+    auto kp4 = model.addKeypoint(Vector3f::Ones());
+    ASSERT_NE(kp4.id, kp3.id);
+    model.removeKeypoint(kp4);
+
+    BBox bbox = {.id = -1, .position = Vector3f::Ones()};
+    model.addBoundingBox(bbox);
+    Rectangle first(-1, 0, Vector3f::Zero(), Quaternionf::Identity(), Vector2f::Ones());
+    Rectangle second(-1, 1, Vector3f::Ones(), Quaternionf::Identity(), Vector2f::Ones());
+    model.addRectangle(first);
+    model.addRectangle(second);
+    ASSERT_GT(first.id, 0);
+    ASSERT_NE(first.id, second.id);
+    // Taken ids are replaced.
+    Rectangle copy(first);
+    model.addRectangle(copy);
+    ASSERT_NE(copy.id, first.id);
+    model.save(path);
+  }
+
+  SceneModel loaded;
+  loaded.load(path);
+  ASSERT_EQ(loaded.getKeypoints().size(), 2);
+  ASSERT_EQ(loaded.getKeypoint(1).value().position, Vector3f::Zero());
+  ASSERT_EQ(loaded.getKeypoint(2).value().position, Vector3f::Ones());
+  ASSERT_EQ(loaded.getBoundingBoxes().size(), 1);
+  ASSERT_EQ(loaded.getRectangles().size(), 3);
+  // Ids of annotations removed before saving are not reused either.
+  auto keypoint = loaded.addKeypoint(Vector3f::Zero());
+  ASSERT_EQ(keypoint.id, 5);
+}
+
+std::shared_ptr<geometry::PointCloud> planeCloud(float z) {
+  // A 10 x 10 grid of points in a plane at height z.
+  std::vector<Vector3f> points;
+  for (int i = 0; i < 100; i++) {
+    points.emplace_back((i / 10) * 0.1f, (i % 10) * 0.1f, z);
+  }
+  fs::path path = test_helpers::writePointCloud(fs::temp_directory_path() / "test_scene_model.ply", points);
+  return std::make_shared<geometry::PointCloud>(path.string());
+}
+
+TEST(SceneModelTest, TraceRayCache) {
+  SceneModel model;
+  model.activeView = active_view::PointCloudView;
+  model.setPointCloud(planeCloud(0.0f));
+  const Vector3f origin(0.5f, 0.5f, 1.0f);
+  const Vector3f direction(0.0f, 0.0f, -1.0f);
+  auto first = model.traceRayIntersection(origin, direction);
+  ASSERT_TRUE(first.hit);
+  ASSERT_NEAR(first.point[2], 0.0f, 0.05f);
+  auto again = model.traceRayIntersection(origin, direction);
+  ASSERT_EQ(again.point, first.point);
+  ASSERT_EQ(model.traceRay(origin, direction).value(), first.point);
+
+  // Replacing the cloud invalidates the previous result.
+  model.setPointCloud(planeCloud(-0.5f));
+  auto moved = model.traceRayIntersection(origin, direction);
+  ASSERT_TRUE(moved.hit);
+  ASSERT_NEAR(moved.point[2], -0.5f, 0.05f);
+
+  // So does looking at the mesh instead, of which there is none.
+  model.activeView = active_view::MeshView;
+  ASSERT_FALSE(model.traceRayIntersection(origin, direction).hit);
+}
+
+TEST(SceneModelTest, TraceRayAfterBuild) {
+  SceneModel model;
+  model.activeView = active_view::PointCloudView;
+  auto pointCloud = planeCloud(0.0f);
+  auto rayTraceCloud = std::make_shared<geometry::RayTraceCloud>(pointCloud);
+  model.setPointCloud(pointCloud, rayTraceCloud);
+  const Vector3f origin(0.2f, 0.5f, 1.0f);
+  const Vector3f direction = Vector3f(0.3f, 0.0f, -1.0f).normalized();
+  // Without the ray tracer, the normal is the direction of the ray.
+  auto before = model.traceRayIntersection(origin, direction);
+  ASSERT_TRUE(before.hit);
+  ASSERT_TRUE(before.normal.isApprox(direction));
+
+  // Once it is built, the same ray hits the plane with its normal.
+  rayTraceCloud->build();
+  auto after = model.traceRayIntersection(origin, direction);
+  ASSERT_TRUE(after.hit);
+  ASSERT_NEAR(std::abs(after.normal[2]), 1.0f, 1e-3f);
+}
+
+TEST(SceneModelTest, GeometryBuilds) {
+  SceneModel model;
+  std::atomic<int> wakes = 0;
+  utils::main_loop::setWake([&]() { wakes++; });
+  ASSERT_FALSE(model.buildingGeometry());
+  // Replacing the cloud leaves the build of the previous one running.
+  model.setPointCloud(planeCloud(0.0f));
+  model.setPointCloud(planeCloud(-0.5f));
+  ASSERT_TRUE(model.buildingGeometry());
+  // The octree is handed over on the main thread.
+  ASSERT_EQ(model.getPointCloudOctree(), nullptr);
+  bool finished = false;
+  while (model.buildingGeometry()) {
+    finished = model.updateGeometryBuilds() || finished;
+    std::this_thread::yield();
+  }
+  ASSERT_TRUE(finished);
+  ASSERT_FALSE(model.updateGeometryBuilds());
+  ASSERT_NE(model.getPointCloudOctree(), nullptr);
+  // Once for the octree and once for the ray tracer of each cloud.
+  ASSERT_EQ(wakes, 4);
+  utils::main_loop::setWake(nullptr);
+}
+
 TEST(SceneModelTest, Camera) {
   SceneModel model;
   fs::path path(datasetPath);
-  auto trajectory = utils::dataset::getDatasetCameraTrajectory((path / "scene" / "trajectory.log"));
+  // Without writing the binary sidecar into the fixture.
+  auto trajectory = utils::dataset::getDatasetCameraTrajectory(path / "scene" / "trajectory.log", false);
   ASSERT_EQ(trajectory.size(), 474);
   ASSERT_EQ(trajectory[0], Matrix4f::Identity());
   ASSERT_NE(trajectory[1], Matrix4f::Identity());
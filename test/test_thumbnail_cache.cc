@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include <filesystem>
+#include <bimg/bimg.h>
+#include "model/thumbnail_cache.h"
+
+namespace fs = std::filesystem;
+
+std::string datasetPath;
+
+// An uncompressed 24 bit TGA image of a single color.
+void writeImage(const fs::path& path, int width, int height, uint8_t value) {
+  uint8_t header[18] = {0, 0, 2};
+  header[12] = width & 0xff;
+  header[13] = width >> 8;
+  header[14] = height & 0xff;
+  header[15] = height >> 8;
+  header[16] = 24;
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  std::vector<char> pixels(width * height * 3, char(value));
+  file.write(pixels.data(), pixels.size());
+}
+
+// The fixture dataset with an image for each of its first frames.
+std::shared_ptr<const model::DatasetIndex> makeDataset(int images) {
+  fs::path path = fs::temp_directory_path() / "test_thumbnail_cache";
+  fs::remove_all(path);
+  fs::create_directories(path / "color");
+  fs::create_directories(path / "scene");
+  fs::copy_file(fs::path(datasetPath) / "camera_intrinsics.json", path / "camera_intrinsics.json");
+  fs::copy_file(fs::path(datasetPath) / "scene" / "trajectory.log", path / "scene" / "trajectory.log");
+  for (int i = 0; i < images; i++) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06d.tga", i);
+    writeImage(path / "color" / name, 64, 48, uint8_t(i * 10));
+  }
+  return std::make_shared<model::DatasetIndex>(path);
+}
+
+// Next to the dataset, so that tests stay out of the cache directory of the user.
+fs::path cachePath(const model::DatasetIndex& dataset) {
+  return dataset.getPath().parent_path() / "test_thumbnail_cache.bin";
+}
+
+TEST(TestThumbnailCache, GenerateAndRead) {
+  auto dataset = makeDataset(5);
+  fs::remove(dataset->imagePath(3));
+  fs::path path = cachePath(*dataset);
+  fs::remove(path);
+  ASSERT_EQ(model::ThumbnailCache::open(path, *dataset), nullptr);
+  ASSERT_TRUE(model::ThumbnailCache::generate(*dataset, path, {.maxWidth = 20, .compress = false}));
+  ASSERT_FALSE(fs::exists(path.string() + ".tmp"));
+
+  auto thumbnails = model::ThumbnailCache::open(path, *dataset);
+  ASSERT_NE(thumbnails, nullptr);
+  ASSERT_EQ(thumbnails->size(), 5);
+  ASSERT_EQ(thumbnails->textureFormat(), bgfx::TextureFormat::RGBA8);
+  // Halved until at most 20 pixels wide.
+  ASSERT_EQ(thumbnails->width(0), 16);
+  ASSERT_EQ(thumbnails->height(0), 12);
+  ASSERT_FALSE(thumbnails->contains(3));
+  ASSERT_EQ(thumbnails->image(3), nullptr);
+  for (int frame : {0, 1, 2, 4}) {
+    ASSERT_TRUE(thumbnails->contains(frame));
+    texture_utils::ImagePtr image = thumbnails->image(frame);
+    ASSERT_NE(image, nullptr);
+    ASSERT_EQ(image->container->m_width, 16);
+    ASSERT_EQ(image->container->m_height, 12);
+    ASSERT_EQ(image->container->m_size, 16 * 12 * 4);
+    const uint8_t* pixels = static_cast<const uint8_t*>(image->container->m_data);
+    ASSERT_EQ(pixels[0], frame * 10);
+    ASSERT_EQ(pixels[3], 255);
+  }
+}
+
+TEST(TestThumbnailCache, Compressed) {
+  auto dataset = makeDataset(3);
+  fs::path path = cachePath(*dataset);
+  ASSERT_TRUE(model::ThumbnailCache::generate(*dataset, path, {.maxWidth = 20}));
+  auto thumbnails = model::ThumbnailCache::open(path, *dataset);
+  ASSERT_NE(thumbnails, nullptr);
+  ASSERT_EQ(thumbnails->textureFormat(), bgfx::TextureFormat::BC1);
+  for (int frame = 0; frame < 3; frame++) {
+    texture_utils::ImagePtr image = thumbnails->image(frame);
+    ASSERT_NE(image, nullptr);
+    ASSERT_EQ(image->container->m_width, 16);
+    ASSERT_EQ(image->container->m_height, 12);
+    // 4 by 3 blocks of 8 bytes.
+    ASSERT_EQ(image->container->m_size, 4 * 3 * 8);
+    // A single color, so both end points are that color in 5:6:5 bits.
+    const uint8_t* block = static_cast<const uint8_t*>(image->container->m_data);
+    const uint16_t value = uint16_t(frame * 10);
+    const uint16_t color = uint16_t(((value * 31 + 127) / 255) << 11 | ((value * 63 + 127) / 255) << 5 |
+                                    (value * 31 + 127) / 255);
+    ASSERT_EQ(block[0] | block[1] << 8, color);
+    ASSERT_EQ(block[2] | block[3] << 8, color);
+  }
+}
+
+TEST(TestThumbnailCache, PathFor) {
+  auto dataset = makeDataset(1);
+  fs::path cache = fs::temp_directory_path() / "test_thumbnail_cache_home";
+  setenv("XDG_CACHE_HOME", cache.c_str(), 1);
+  fs::path path = model::ThumbnailCache::pathFor(*dataset);
+  ASSERT_EQ(path.parent_path(), cache / "stray" / "thumbnails");
+  ASSERT_EQ(path.filename().string().rfind("test_thumbnail_cache-", 0), 0);
+  // Another dataset with the same name is cached elsewhere.
+  fs::path other = fs::temp_directory_path() / "other" / "test_thumbnail_cache";
+  fs::create_directories(other);
+  fs::copy(dataset->getPath(), other, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+  ASSERT_NE(model::ThumbnailCache::pathFor(model::DatasetIndex(other)), path);
+
+  ASSERT_TRUE(model::ThumbnailCache::generate(*dataset, path));
+  ASSERT_NE(model::ThumbnailCache::open(path, *dataset), nullptr);
+  fs::remove_all(cache);
+  fs::remove_all(other.parent_path());
+}
+
+TEST(TestThumbnailCache, Invalid) {
+  auto dataset = makeDataset(3);
+  // The same dataset with a frame added.
+  auto larger = makeDataset(4);
+  fs::path path = cachePath(*dataset);
+  ASSERT_TRUE(model::ThumbnailCache::generate(*dataset, path));
+  ASSERT_NE(model::ThumbnailCache::open(path, *dataset), nullptr);
+  ASSERT_EQ(model::ThumbnailCache::open(path, *larger), nullptr);
+
+  fs::resize_file(path, fs::file_size(path) - 1);
+  ASSERT_EQ(model::ThumbnailCache::open(path, *dataset), nullptr);
+  std::ofstream(path, std::ios::binary) << "not a cache";
+  ASSERT_EQ(model::ThumbnailCache::open(path, *dataset), nullptr);
+}
+
+TEST(TestThumbnailCache, ReplacedImages) {
+  auto dataset = makeDataset(3);
+  fs::path path = cachePath(*dataset);
+  ASSERT_TRUE(model::ThumbnailCache::generate(*dataset, path));
+  ASSERT_NE(model::ThumbnailCache::open(path, *dataset), nullptr);
+  // The dataset recorded again, with as many frames.
+  writeImage(dataset->imagePath(1), 32, 24, 0);
+  ASSERT_EQ(model::ThumbnailCache::open(path, *dataset), nullptr);
+
+  // An image that was missing when the cache was generated.
+  fs::remove(dataset->imagePath(2));
+  ASSERT_TRUE(model::ThumbnailCache::generate(*dataset, path));
+  ASSERT_NE(model::ThumbnailCache::open(path, *dataset), nullptr);
+  writeImage(dataset->imagePath(2), 64, 48, 0);
+  ASSERT_EQ(model::ThumbnailCache::open(path, *dataset), nullptr);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  datasetPath = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include "scene_model.h"
+#include "timeline.h"
+#include "commands/move_keypoint_command.h"
+
+namespace fs = std::filesystem;
+
+fs::path writeAnnotations() {
+  fs::path path = fs::temp_directory_path() / "test_timeline_annotations.json";
+  std::ofstream file(path);
+  file << R"({
+    "keypoints": [
+      {"id": 3, "class_id": 1, "position": [1.0, 2.0, 3.0]},
+      {"id": 7, "class_id": 2, "position": [0.0, 0.0, 0.0]}
+    ],
+    "bounding_boxes": [
+      {"id": 1, "class_id": 4, "position": [0.0, 0.0, 0.0],
+       "orientation": {"w": 1.0, "x": 0.0, "y": 0.0, "z": 0.0}, "dimensions": [1.0, 1.0, 1.0]},
+      {"classId": 5, "position": [1.0, 0.0, 0.0],
+       "orientation": {"w": 1.0, "x": 0.0, "y": 0.0, "z": 0.0}, "dimensions": [1.0, 1.0, 1.0]}
+    ],
+    "rectangles": [
+      {"class_id": 6, "center": [0.0, 0.0, 0.0],
+       "orientation": {"w": 1.0, "x": 0.0, "y": 0.0, "z": 0.0}, "size": [1.0, 2.0]}
+    ],
+    "next_ids": {"keypoints": 10, "bounding_boxes": 2, "rectangles": 1}
+  })";
+  return path;
+}
+
+TEST(TestTimeline, Load) {
+  SceneModel model;
+  Timeline timeline(model);
+  timeline.load(writeAnnotations());
+  // One checkpoint, not a command per annotation.
+  ASSERT_EQ(timeline.size(), 1);
+
+  ASSERT_EQ(model.getKeypoints().size(), 2);
+  ASSERT_EQ(model.getKeypoint(3).value().classId, 1);
+  ASSERT_EQ(model.getKeypoint(3).value().position, Vector3f(1.0f, 2.0f, 3.0f));
+  ASSERT_EQ(model.getKeypoint(7).value().classId, 2);
+
+  ASSERT_EQ(model.getBoundingBoxes().size(), 2);
+  ASSERT_EQ(model.getBoundingBox(1).value().classId, 4);
+  // Boxes without an id get a new one, both spellings of the class id are read.
+  ASSERT_EQ(model.getBoundingBox(2).value().classId, 5);
+
+  ASSERT_EQ(model.getRectangles().size(), 1);
+  ASSERT_EQ(model.getRectangles()[0].classId, 6);
+  ASSERT_GT(model.getRectangles()[0].id, 0);
+
+  auto added = model.addKeypoint(Vector3f::Zero());
+  ASSERT_EQ(added.id, 10);
+  model.removeKeypoint(added);
+
+  // Undoing the load keeps the loaded annotations.
+  timeline.undoCommand();
+  timeline.undoCommand();
+  ASSERT_EQ(model.getKeypoints().size(), 2);
+  ASSERT_EQ(model.getBoundingBoxes().size(), 2);
+}
+
+TEST(TestTimeline, LoadMissingFile) {
+  SceneModel model;
+  Timeline timeline(model);
+  timeline.load(fs::temp_directory_path() / "test_timeline_missing.json");
+  ASSERT_EQ(timeline.size(), 0);
+  ASSERT_TRUE(model.getKeypoints().empty());
+}
+
+Keypoint moved(const Keypoint& keypoint, float x) {
+  Keypoint result = keypoint;
+  result.position[0] = x;
+  return result;
+}
+
+TEST(TestTimeline, Redo) {
+  SceneModel model;
+  Timeline timeline(model, {.mergeWindow = std::chrono::milliseconds(0)});
+  timeline.pushCommand(std::make_unique<AddKeypointCommand>(Keypoint(Vector3f::Zero())));
+  Keypoint keypoint = model.getKeypoints()[0];
+  timeline.pushCommand(std::make_unique<MoveKeypointCommand>(keypoint, moved(keypoint, 1.0f)));
+
+  timeline.undoCommand();
+  timeline.undoCommand();
+  ASSERT_TRUE(model.getKeypoints().empty());
+  ASSERT_EQ(timeline.redoSize(), 2);
+  timeline.redoCommand();
+  timeline.redoCommand();
+  // The keypoint comes back with the same id, so that the move applies to it.
+  ASSERT_EQ(model.getKeypoint(keypoint.id).value().position[0], 1.0f);
+  ASSERT_EQ(timeline.redoSize(), 0);
+
+  // A new command forgets what was undone.
+  timeline.undoCommand();
+  timeline.pushCommand(std::make_unique<AddKeypointCommand>(Keypoint(Vector3f::Ones())));
+  ASSERT_EQ(timeline.redoSize(), 0);
+  timeline.redoCommand();
+  ASSERT_EQ(model.getKeypoint(keypoint.id).value().position[0], 0.0f);
+}
+
+TEST(TestTimeline, RedoAfterLoad) {
+  SceneModel model;
+  Timeline timeline(model);
+  timeline.load(writeAnnotations());
+  timeline.undoCommand();
+  timeline.redoCommand();
+  // Loading is never undone, so it is not redone either.
+  ASSERT_EQ(timeline.size(), 1);
+  ASSERT_EQ(model.getKeypoints().size(), 2);
+}
+
+TEST(TestTimeline, MergeDrags) {
+  SceneModel model;
+  Timeline timeline(model, {.mergeWindow = std::chrono::hours(1)});
+  Keypoint first = model.addKeypoint(Vector3f::Zero());
+  Keypoint second = model.addKeypoint(Vector3f::Zero());
+  for (int i = 1; i <= 10; i++) {
+    Keypoint current = model.getKeypoint(first.id).value();
+    timeline.pushCommand(std::make_unique<MoveKeypointCommand>(current, moved(current, float(i))));
+  }
+  ASSERT_EQ(timeline.size(), 1);
+  // Dragging another keypoint is a separate edit.
+  timeline.pushCommand(std::make_unique<MoveKeypointCommand>(second, moved(second, 1.0f)));
+  ASSERT_EQ(timeline.size(), 2);
+
+  timeline.undoCommand();
+  timeline.undoCommand();
+  ASSERT_EQ(model.getKeypoint(first.id).value().position[0], 0.0f);
+  timeline.redoCommand();
+  ASSERT_EQ(model.getKeypoint(first.id).value().position[0], 10.0f);
+}
+
+TEST(TestTimeline, LimitHistory) {
+  SceneModel model;
+  Timeline timeline(model, {.maxCommands = 100, .mergeWindow = std::chrono::milliseconds(0)});
+  for (int i = 0; i < 1000; i++) {
+    timeline.pushCommand(std::make_unique<AddKeypointCommand>(Keypoint(Vector3f::Zero())));
+  }
+  ASSERT_EQ(timeline.size(), 100);
+  ASSERT_EQ(timeline.memoryUsage(), 100 * sizeof(AddKeypointCommand));
+
+  Timeline small(model, {.maxBytes = 10 * sizeof(AddKeypointCommand), .mergeWindow = std::chrono::milliseconds(0)});
+  for (int i = 0; i < 100; i++) {
+    small.pushCommand(std::make_unique<AddKeypointCommand>(Keypoint(Vector3f::Zero())));
+  }
+  ASSERT_EQ(small.size(), 10);
+  for (int i = 0; i < 20; i++) {
+    small.undoCommand();
+  }
+  ASSERT_EQ(model.getKeypoints().size(), 1090);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}